@@ -55,7 +55,32 @@ public:
         }
     }
 
+    // 每纳秒的cpu周期数(rdtsc), 用于将rdtsc差值换算成时间
+    static double CyclesPerNanosecond() {
+        if (self().fast_)
+            return self().cycle_;
+
+        static double cycle = Calibrate();
+        return cycle;
+    }
+
+    inline static uint64_t rdtsc() {
+        uint32_t high, low;
+        __asm__ __volatile__(
+                "rdtsc" : "=a" (low), "=d" (high)
+                );
+        return ((uint64_t)high << 32) | low;
+    }
+
 private:
+    static double Calibrate() {
+        auto tp = base_clock_t::now();
+        uint64_t tsc = rdtsc();
+        while (base_clock_t::now() - tp < std::chrono::milliseconds(2)) ;
+        long dur = (std::max<long>)((base_clock_t::now() - tp).count(), 1);
+        return (double)(rdtsc() - tsc) / dur;
+    }
+
     struct Data {
         struct CheckPoint {
             time_point tp_;
@@ -72,13 +97,6 @@ private:
         static Data obj;
         return obj;
     }
-    inline static uint64_t rdtsc() {
-        uint32_t high, low;
-        __asm__ __volatile__(
-                "rdtsc" : "=a" (low), "=d" (high)
-                );
-        return ((uint64_t)high << 32) | low;
-    }
 };
 
 } // namespace co
@@ -11,6 +11,9 @@
 
 #include "../scheduler/ref.h"
 #include "../cls/co_local_storage.h"
+#if defined(LIBGO_SYS_Unix)
+#include "../netio/unix/reactor_element.h"
+#endif
 
 namespace co {
 
@@ -25,11 +28,17 @@ static int staticInitialize()
     TaskRefInit(Affinity);
     TaskRefInit(Location);
     TaskRefInit(DebugInfo);
-    TaskRefInit(SuspendId);
+    TaskRefInit(Deadline);
+    TaskRefInit(Cancel);
 
     // cls
     TaskRefInit(ClsMap);
 
+#if defined(LIBGO_SYS_Unix)
+    // hook
+    TaskRefInit(PollCache);
+#endif
+
 #if defined(LIBGO_SYS_Linux)
     initHook();
 #endif
@@ -135,6 +135,25 @@ struct CoroutineOptions
     // ̵߳ĴƵ(λ΢)
     uint32_t dispatcher_thread_cycle_us = 1000; 
 
+    // ߳(P)гʱ(λ)˳, ֱ߳䵽StartʱminThreadNumber.
+    // ʱչ߳̿Խ˻. 0ʾ.
+    uint32_t processer_idle_retire_ms = 60 * 1000;
+
+    // ЭʽռʱƬ(λ΢): Э̱гʱ, ִеco::preempt_check()ʱóCPU.
+    // 0ʾռ
+    uint32_t preempt_timeslice_us = 10 * 1000;
+
+    // ѵ߳(P)󶨵CPU, CPUɽԶ͵Э(ͬˡͬLLCͬNUMAڵ㡢Զ).
+    // Scheduler::Startǰ. ҲScheduler::SetCpuListָCPUб.
+    bool enable_cpu_affinity = false;
+
+    // CPUĿ¼(sysfsʽ), ָģڲ
+    std::string cpu_topology_path = "/sys/devices/system/cpu";
+
+    // ȼ: Эִ̿еĵȼôֺ, ǿƵһ.
+    // Ϊ0ʾϸȼ(ȼܱ)
+    uint32_t priority_starvation_limit = 16;
+
     // ջñڴεڴҳ(linuxЧ)(ĬΪ0, :)
     // ջڴǰҳΪprotect.
     // Կѡʱ, stack_sizeprotect_stack_page+1ҳ
@@ -46,6 +46,24 @@ std::string co_error_category::message(int v) const
 
         case (int)eCoErrorCode::ec_disabled_multi_thread:
             return "Unsupport multiply threads. If you want use multiply threads, please cmake libgo without DISABLE_MULTI_THREAD option.";
+
+        case (int)eCoErrorCode::ec_too_many_metrics:
+            return "too many metrics, the limit is MetricShard::kMaxMetrics.";
+
+        case (int)eCoErrorCode::ec_overloaded:
+            return "scheduler overloaded, coroutine rejected by admission control.";
+
+        case (int)eCoErrorCode::ec_promise_already_satisfied:
+            return "promise already satisfied";
+
+        case (int)eCoErrorCode::ec_future_already_retrieved:
+            return "future already retrieved";
+
+        case (int)eCoErrorCode::ec_broken_promise:
+            return "broken promise";
+
+        case (int)eCoErrorCode::ec_future_interrupted:
+            return "future wait interrupted by deadline or cancellation";
     }
 
     return "";
@@ -19,6 +19,12 @@ enum class eCoErrorCode : int
     ec_protect_stack_failed,
     ec_std_thread_link_error,
     ec_disabled_multi_thread,
+    ec_too_many_metrics,
+    ec_overloaded,
+    ec_promise_already_satisfied,
+    ec_future_already_retrieved,
+    ec_broken_promise,
+    ec_future_interrupted,
 };
 
 class co_error_category
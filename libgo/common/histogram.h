@@ -0,0 +1,156 @@
+#pragma once
+#include "config.h"
+#include <limits>
+
+namespace co
+{
+
+// HDR风格的对数-线性直方图
+// 每个2的幂次区间再等分成2^kSubBits个桶, 相对误差不超过1/2^kSubBits.
+// 只允许一个线程写入(无锁、无原子RMW), 其他线程可以随时读取(读到的是近似快照).
+class Histogram
+{
+public:
+    static const int kSubBits = 4;
+    static const int kSubCount = 1 << kSubBits;
+
+    // 可记录的最大值为2^kMaxBits-1, 超过的记入最后一个桶
+    static const int kMaxBits = 40;
+    static const int kBuckets = (kMaxBits - kSubBits + 1) * kSubCount;
+
+    Histogram() { Reset(); }
+
+    Histogram(Histogram const& other) { Reset(); Merge(other); }
+
+    Histogram& operator=(Histogram const& other)
+    {
+        if (this != &other) {
+            Reset();
+            Merge(other);
+        }
+        return *this;
+    }
+
+    // 单线程写入
+    ALWAYS_INLINE void Record(uint64_t value)
+    {
+        int idx = BucketIndex(value);
+        Inc(counts_[idx], 1);
+        Inc(count_, 1);
+        Inc(sum_, value);
+        if (value > max_.load(std::memory_order_relaxed))
+            max_.store(value, std::memory_order_relaxed);
+        if (value < min_.load(std::memory_order_relaxed))
+            min_.store(value, std::memory_order_relaxed);
+    }
+
+    // 合并其他直方图(合并的结果只允许当前线程继续写入)
+    void Merge(Histogram const& other)
+    {
+        for (int i = 0; i < kBuckets; ++i) {
+            uint64_t c = other.counts_[i].load(std::memory_order_relaxed);
+            if (c) Inc(counts_[i], c);
+        }
+        Inc(count_, other.count_.load(std::memory_order_relaxed));
+        Inc(sum_, other.sum_.load(std::memory_order_relaxed));
+        max_.store((std::max)(max_.load(std::memory_order_relaxed),
+                    other.max_.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+        min_.store((std::min)(min_.load(std::memory_order_relaxed),
+                    other.min_.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+    }
+
+    void Reset()
+    {
+        for (int i = 0; i < kBuckets; ++i)
+            counts_[i].store(0, std::memory_order_relaxed);
+        count_.store(0, std::memory_order_relaxed);
+        sum_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+        min_.store((std::numeric_limits<uint64_t>::max)(), std::memory_order_relaxed);
+    }
+
+    uint64_t Count() const { return count_.load(std::memory_order_relaxed); }
+
+    uint64_t Sum() const { return sum_.load(std::memory_order_relaxed); }
+
+    uint64_t Max() const { return max_.load(std::memory_order_relaxed); }
+
+    uint64_t Min() const { return Count() ? min_.load(std::memory_order_relaxed) : 0; }
+
+    double Mean() const
+    {
+        uint64_t c = Count();
+        return c ? (double)Sum() / c : 0;
+    }
+
+    // 百分位数(0~100), 返回所在桶的上界(不超过Max)
+    uint64_t Percentile(double p) const
+    {
+        uint64_t total = 0;
+        for (int i = 0; i < kBuckets; ++i)
+            total += counts_[i].load(std::memory_order_relaxed);
+        if (!total) return 0;
+
+        uint64_t rank = (uint64_t)(p / 100.0 * total + 0.5);
+        if (rank < 1) rank = 1;
+        if (rank > total) rank = total;
+
+        uint64_t acc = 0;
+        for (int i = 0; i < kBuckets; ++i) {
+            acc += counts_[i].load(std::memory_order_relaxed);
+            if (acc >= rank)
+                return (std::min)(BucketUpperBound(i), Max());
+        }
+        return Max();
+    }
+
+    // 每个桶的计数, 用于导出
+    uint64_t BucketCount(int idx) const { return counts_[idx].load(std::memory_order_relaxed); }
+
+    // 桶内的最大值
+    static uint64_t BucketUpperBound(int idx)
+    {
+        if (idx < kSubCount) return idx;
+        int exp = idx / kSubCount + kSubBits - 1;
+        uint64_t sub = idx % kSubCount;
+        return ((kSubCount + sub + 1) << (exp - kSubBits)) - 1;
+    }
+
+    // 可读的摘要, 单位由调用者决定(@div: 输出时除以div)
+    std::string ToString(double div = 1.0, const char* unit = "") const
+    {
+        char buf[256];
+        snprintf(buf, sizeof(buf), "count=%lu min=%.1f%s mean=%.1f%s p50=%.1f%s p90=%.1f%s "
+                "p99=%.1f%s p999=%.1f%s max=%.1f%s",
+                (unsigned long)Count(),
+                Min() / div, unit, Mean() / div, unit,
+                Percentile(50) / div, unit, Percentile(90) / div, unit,
+                Percentile(99) / div, unit, Percentile(99.9) / div, unit,
+                Max() / div, unit);
+        return buf;
+    }
+
+    ALWAYS_INLINE static int BucketIndex(uint64_t value)
+    {
+        if (value < (uint64_t)kSubCount) return (int)value;
+        if (value >> kMaxBits) return kBuckets - 1;
+        int exp = 63 - __builtin_clzll(value);
+        int sub = (int)((value >> (exp - kSubBits)) & (kSubCount - 1));
+        return (exp - kSubBits + 1) * kSubCount + sub;
+    }
+
+private:
+    ALWAYS_INLINE static void Inc(std::atomic<uint64_t> & v, uint64_t n)
+    {
+        v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> counts_[kBuckets];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+    std::atomic<uint64_t> min_;
+};
+
+} // namespace co
@@ -0,0 +1,288 @@
+#include "metrics.h"
+#include "error.h"
+
+namespace co
+{
+
+MetricShard::MetricShard()
+{
+    for (int i = 0; i < kMaxMetrics; ++i) {
+        values_[i].store(0, std::memory_order_relaxed);
+        histograms_[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+MetricShard::~MetricShard()
+{
+    for (int i = 0; i < kMaxMetrics; ++i)
+        delete histograms_[i].load(std::memory_order_relaxed);
+}
+
+// 线程退出时把分片交还给注册表
+struct MetricShardHolder
+{
+    MetricShard* shard_ = nullptr;
+
+    ~MetricShardHolder()
+    {
+        if (shard_) {
+            Metrics::LocalShardPtr() = nullptr;
+            Metrics::getInstance().RetireShard(shard_);
+        }
+    }
+};
+
+Metrics& Metrics::getInstance()
+{
+    // 不析构: 进程退出时其他线程可能还在写分片
+    static Metrics *obj = new Metrics;
+    return *obj;
+}
+
+MetricShard* & Metrics::LocalShardPtr()
+{
+    static thread_local MetricShard* shard = nullptr;
+    return shard;
+}
+
+Metrics::Metrics()
+{
+    memset(retiredValues_, 0, sizeof(retiredValues_));
+
+    struct {
+        eMetric metric;
+        const char* name;
+        const char* help;
+    } builtins[] = {
+        {eMetric::tasks_created, "libgo_tasks_created_total", "Coroutines created."},
+        {eMetric::tasks_finished, "libgo_tasks_finished_total", "Coroutines finished."},
+        {eMetric::task_switches, "libgo_task_switches_total", "Coroutine swap-ins."},
+        {eMetric::steals, "libgo_steals_total", "Work stealing operations that moved at least one coroutine."},
+        {eMetric::stolen_tasks, "libgo_stolen_tasks_total", "Coroutines moved by work stealing."},
+        {eMetric::timers_started, "libgo_timers_started_total", "Timers started."},
+        {eMetric::timers_fired, "libgo_timers_fired_total", "Timers fired."},
+        {eMetric::channel_sends, "libgo_channel_sends_total", "Successful channel pushes."},
+        {eMetric::channel_recvs, "libgo_channel_recvs_total", "Successful channel pops."},
+        {eMetric::hook_io_waits, "libgo_hook_io_waits_total", "Hooked io calls that suspended the coroutine."},
+        {eMetric::hook_sleeps, "libgo_hook_sleeps_total", "Hooked sleep calls."},
+        {eMetric::async_pool_posts, "libgo_async_pool_posts_total", "Tasks posted to AsyncCoroutinePool."},
+        {eMetric::connection_pool_creates, "libgo_connection_pool_creates_total", "Connections created by ConnectionPool."},
+        {eMetric::connection_pool_waits, "libgo_connection_pool_waits_total", "ConnectionPool::Get calls that had to wait."},
+        {eMetric::preemptions, "libgo_preemptions_total", "Coroutines preempted at co::preempt_check()."},
+    };
+    static_assert(sizeof(builtins) / sizeof(builtins[0]) == (int)eMetric::builtin_count,
+            "builtin metric description missing");
+
+    for (auto & b : builtins) {
+        Desc desc;
+        desc.type_ = eMetricType::counter;
+        desc.name_ = b.name;
+        desc.help_ = b.help;
+        desc.idx_ = (int)b.metric;
+        descs_.push_back(desc);
+    }
+    nextIdx_ = (int)eMetric::builtin_count;
+}
+
+MetricShard* Metrics::NewShard()
+{
+    static thread_local MetricShardHolder holder;
+    MetricShard* shard = new MetricShard;
+    holder.shard_ = shard;
+
+    std::unique_lock<std::mutex> lock(mtx_);
+    shards_.push_back(shard);
+    return shard;
+}
+
+void Metrics::RetireShard(MetricShard* shard)
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    shards_.remove(shard);
+    for (int i = 0; i < nextIdx_; ++i) {
+        retiredValues_[i] += shard->values_[i].load(std::memory_order_relaxed);
+        Histogram* h = shard->histograms_[i].load(std::memory_order_acquire);
+        if (h)
+            retiredHistograms_[i].Merge(*h);
+    }
+    delete shard;
+}
+
+int Metrics::AddShardedMetric(eMetricType type, std::string const& name,
+        std::string const& help, std::string const& labels)
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (nextIdx_ >= MetricShard::kMaxMetrics)
+        ThrowError(eCoErrorCode::ec_too_many_metrics);
+
+    Desc desc;
+    desc.type_ = type;
+    desc.name_ = name;
+    desc.help_ = help;
+    desc.labels_ = labels;
+    desc.idx_ = nextIdx_++;
+    descs_.push_back(desc);
+    return desc.idx_;
+}
+
+Metrics::Counter Metrics::NewCounter(std::string const& name, std::string const& help,
+        std::string const& labels)
+{
+    return Counter(AddShardedMetric(eMetricType::counter, name, help, labels));
+}
+
+Metrics::Gauge Metrics::NewGauge(std::string const& name, std::string const& help,
+        std::string const& labels)
+{
+    return Gauge(AddShardedMetric(eMetricType::gauge, name, help, labels));
+}
+
+Metrics::HistogramMetric Metrics::NewHistogram(std::string const& name,
+        std::string const& help, std::string const& labels)
+{
+    return HistogramMetric(AddShardedMetric(eMetricType::histogram, name, help, labels));
+}
+
+void Metrics::RegisterFunc(eMetricType type, std::string const& name,
+        std::string const& help, std::string const& labels, ValueFunc const& fn)
+{
+    Desc desc;
+    desc.type_ = type;
+    desc.name_ = name;
+    desc.help_ = help;
+    desc.labels_ = labels;
+    desc.idx_ = -1;
+    desc.fn_ = fn;
+
+    std::unique_lock<std::mutex> lock(mtx_);
+    descs_.push_back(desc);
+}
+
+void Metrics::RegisterHistogramFunc(std::string const& name, std::string const& help,
+        std::string const& labels, HistogramFunc const& fn)
+{
+    Desc desc;
+    desc.type_ = eMetricType::histogram;
+    desc.name_ = name;
+    desc.help_ = help;
+    desc.labels_ = labels;
+    desc.idx_ = -1;
+    desc.histogramFn_ = fn;
+
+    std::unique_lock<std::mutex> lock(mtx_);
+    descs_.push_back(desc);
+}
+
+int64_t Metrics::GetValue(int idx)
+{
+    if (idx < 0 || idx >= MetricShard::kMaxMetrics) return 0;
+
+    std::unique_lock<std::mutex> lock(mtx_);
+    int64_t value = retiredValues_[idx];
+    for (MetricShard* shard : shards_)
+        value += shard->values_[idx].load(std::memory_order_relaxed);
+    return value;
+}
+
+Histogram Metrics::GetHistogram(int idx)
+{
+    Histogram result;
+    if (idx < 0 || idx >= MetricShard::kMaxMetrics) return result;
+
+    std::unique_lock<std::mutex> lock(mtx_);
+    auto it = retiredHistograms_.find(idx);
+    if (it != retiredHistograms_.end())
+        result.Merge(it->second);
+    for (MetricShard* shard : shards_) {
+        Histogram* h = shard->histograms_[idx].load(std::memory_order_acquire);
+        if (h)
+            result.Merge(*h);
+    }
+    return result;
+}
+
+static const char* MetricTypeName(eMetricType type)
+{
+    switch (type) {
+        case eMetricType::counter: return "counter";
+        case eMetricType::gauge: return "gauge";
+        case eMetricType::histogram: return "histogram";
+    }
+    return "untyped";
+}
+
+static void AppendSample(std::string & s, std::string const& name,
+        std::string const& labels, std::string const& extraLabel, double value)
+{
+    s += name;
+    if (!labels.empty() || !extraLabel.empty()) {
+        s += "{";
+        s += labels;
+        if (!labels.empty() && !extraLabel.empty())
+            s += ",";
+        s += extraLabel;
+        s += "}";
+    }
+    char buf[64];
+    snprintf(buf, sizeof(buf), " %.17g\n", value);
+    s += buf;
+}
+
+// 按2的幂次区间输出累计桶, 直到覆盖最大值
+static void AppendHistogram(std::string & s, std::string const& name,
+        std::string const& labels, Histogram const& h)
+{
+    uint64_t acc = 0;
+    uint64_t max = h.Max();
+    for (int i = 0; i < Histogram::kBuckets && h.Count(); ++i) {
+        acc += h.BucketCount(i);
+        if (i % Histogram::kSubCount != Histogram::kSubCount - 1) continue;
+
+        uint64_t le = Histogram::BucketUpperBound(i);
+        AppendSample(s, name + "_bucket", labels, "le=\"" + std::to_string(le) + "\"", (double)acc);
+        if (le >= max) break;
+    }
+    AppendSample(s, name + "_bucket", labels, "le=\"+Inf\"", (double)h.Count());
+    AppendSample(s, name + "_sum", labels, "", (double)h.Sum());
+    AppendSample(s, name + "_count", labels, "", (double)h.Count());
+}
+
+std::string Metrics::ExportPrometheus()
+{
+    std::vector<Desc> descs;
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        descs = descs_;
+    }
+
+    // 同名指标按注册顺序归入同一个指标族
+    std::vector<std::string> names;
+    std::map<std::string, std::vector<Desc*>> families;
+    for (auto & desc : descs) {
+        auto & family = families[desc.name_];
+        if (family.empty())
+            names.push_back(desc.name_);
+        family.push_back(&desc);
+    }
+
+    std::string s;
+    for (auto & name : names) {
+        auto & family = families[name];
+        Desc* first = family.front();
+        s += "# HELP " + name + " " + first->help_ + "\n";
+        s += "# TYPE " + name + " " + MetricTypeName(first->type_) + "\n";
+
+        for (Desc* desc : family) {
+            if (desc->type_ == eMetricType::histogram) {
+                Histogram h = desc->histogramFn_ ? desc->histogramFn_() : GetHistogram(desc->idx_);
+                AppendHistogram(s, name, desc->labels_, h);
+            } else {
+                double value = desc->fn_ ? desc->fn_() : (double)GetValue(desc->idx_);
+                AppendSample(s, name, desc->labels_, "", value);
+            }
+        }
+    }
+    return s;
+}
+
+} // namespace co
@@ -0,0 +1,202 @@
+#pragma once
+#include "config.h"
+#include "histogram.h"
+
+namespace co
+{
+
+// libgo内置的计数器(固定下标, 热路径上直接按下标累加)
+enum class eMetric : int
+{
+    tasks_created,          // 创建的协程数
+    tasks_finished,         // 执行完毕的协程数
+    task_switches,          // 协程切入次数
+    steals,                 // 偷协程的次数
+    stolen_tasks,           // 被偷走的协程数
+    timers_started,         // 启动的定时器数
+    timers_fired,           // 到期执行的定时器数
+    channel_sends,          // channel写入成功次数
+    channel_recvs,          // channel读取成功次数
+    hook_io_waits,          // hook的IO调用挂起等待的次数
+    hook_sleeps,            // hook的sleep类调用次数
+    async_pool_posts,       // 投递到AsyncCoroutinePool的任务数
+    connection_pool_creates,// ConnectionPool新建的连接数
+    connection_pool_waits,  // ConnectionPool因连接数达到上限而等待的次数
+    preemptions,            // 协程在co::preempt_check()处被抢占的次数
+
+    builtin_count,
+};
+
+enum class eMetricType : uint8_t
+{
+    counter,
+    gauge,
+    histogram,
+};
+
+// 指标分片
+// 每个线程一个, 只有所属线程写入(relaxed load + store, 无原子RMW, 无竞争),
+// 导出时汇总所有分片. 线程退出时分片的值合并到注册表中后释放.
+struct MetricShard
+{
+    static const int kMaxMetrics = 256;
+
+    std::atomic<int64_t> values_[kMaxMetrics];
+
+    // 直方图按需创建
+    std::atomic<Histogram*> histograms_[kMaxMetrics];
+
+    MetricShard();
+    ~MetricShard();
+
+    ALWAYS_INLINE void Add(int idx, int64_t n)
+    {
+        values_[idx].store(values_[idx].load(std::memory_order_relaxed) + n,
+                std::memory_order_relaxed);
+    }
+
+    ALWAYS_INLINE void Record(int idx, uint64_t value)
+    {
+        Histogram* h = histograms_[idx].load(std::memory_order_relaxed);
+        if (UNLIKELY(!h)) {
+            h = new Histogram;
+            histograms_[idx].store(h, std::memory_order_release);
+        }
+        h->Record(value);
+    }
+};
+
+// 指标注册表, 导出Prometheus文本格式
+//
+// 三类指标:
+//   1.内置计数器(eMetric), 由libgo各模块在热路径上累加.
+//   2.用户通过NewCounter/NewGauge/NewHistogram注册的分片指标.
+//   3.通过RegisterFunc/RegisterHistogramFunc注册的回调, 导出时调用(用于已有的状态值,
+//     如协程数、定时器数、reactor统计等).
+// 同名指标可以注册多次(labels不同), 导出时合并为一个指标族.
+class Metrics
+{
+public:
+    typedef std::function<double()> ValueFunc;
+    typedef std::function<Histogram()> HistogramFunc;
+
+    // 分片计数器/仪表盘/直方图的句柄, 可以随意拷贝
+    class Counter
+    {
+    public:
+        Counter() : idx_(-1) {}
+        explicit Counter(int idx) : idx_(idx) {}
+        ALWAYS_INLINE void Inc(int64_t n = 1) const { LocalShard().Add(idx_, n); }
+        int64_t Value() const { return getInstance().GetValue(idx_); }
+    private:
+        int idx_;
+    };
+
+    class Gauge
+    {
+    public:
+        Gauge() : idx_(-1) {}
+        explicit Gauge(int idx) : idx_(idx) {}
+        ALWAYS_INLINE void Add(int64_t n) const { LocalShard().Add(idx_, n); }
+        ALWAYS_INLINE void Sub(int64_t n) const { LocalShard().Add(idx_, -n); }
+        int64_t Value() const { return getInstance().GetValue(idx_); }
+    private:
+        int idx_;
+    };
+
+    class HistogramMetric
+    {
+    public:
+        HistogramMetric() : idx_(-1) {}
+        explicit HistogramMetric(int idx) : idx_(idx) {}
+        ALWAYS_INLINE void Record(uint64_t value) const { LocalShard().Record(idx_, value); }
+        Histogram Value() const { return getInstance().GetHistogram(idx_); }
+    private:
+        int idx_;
+    };
+
+    static Metrics& getInstance();
+
+    // 当前线程的分片
+    ALWAYS_INLINE static MetricShard& LocalShard()
+    {
+        MetricShard* & shard = LocalShardPtr();
+        if (UNLIKELY(!shard))
+            shard = getInstance().NewShard();
+        return *shard;
+    }
+
+    ALWAYS_INLINE static void Inc(eMetric metric, int64_t n = 1)
+    {
+        LocalShard().Add((int)metric, n);
+    }
+
+    // 注册分片指标, 超过MetricShard::kMaxMetrics时抛出异常
+    // @name: 指标名, 如 "myapp_requests_total"
+    // @labels: 标签, 如 "method=\"get\"", 可以为空
+    Counter NewCounter(std::string const& name, std::string const& help,
+            std::string const& labels = "");
+
+    Gauge NewGauge(std::string const& name, std::string const& help,
+            std::string const& labels = "");
+
+    HistogramMetric NewHistogram(std::string const& name, std::string const& help,
+            std::string const& labels = "");
+
+    // 注册回调指标
+    void RegisterFunc(eMetricType type, std::string const& name, std::string const& help,
+            std::string const& labels, ValueFunc const& fn);
+
+    void RegisterHistogramFunc(std::string const& name, std::string const& help,
+            std::string const& labels, HistogramFunc const& fn);
+
+    // 汇总所有分片的值
+    int64_t GetValue(eMetric metric) { return GetValue((int)metric); }
+    int64_t GetValue(int idx);
+    Histogram GetHistogram(int idx);
+
+    // 导出Prometheus文本格式(text/plain; version=0.0.4)
+    std::string ExportPrometheus();
+
+private:
+    Metrics();
+    Metrics(Metrics const&) = delete;
+    Metrics& operator=(Metrics const&) = delete;
+
+    static MetricShard* & LocalShardPtr();
+
+    MetricShard* NewShard();
+
+    // 线程退出时调用
+    void RetireShard(MetricShard* shard);
+
+    int AddShardedMetric(eMetricType type, std::string const& name,
+            std::string const& help, std::string const& labels);
+
+    friend struct MetricShardHolder;
+
+private:
+    struct Desc
+    {
+        eMetricType type_;
+        std::string name_;
+        std::string help_;
+        std::string labels_;
+
+        // 分片指标的下标, 回调指标为-1
+        int idx_;
+        ValueFunc fn_;
+        HistogramFunc histogramFn_;
+    };
+
+    std::mutex mtx_;
+    std::vector<Desc> descs_;
+    int nextIdx_;
+    std::list<MetricShard*> shards_;
+
+    // 已退出线程的分片合并到这里
+    int64_t retiredValues_[MetricShard::kMaxMetrics];
+    std::map<int, Histogram> retiredHistograms_;
+};
+
+} // namespace co
@@ -9,6 +9,13 @@ enum {
     opt_stack_size,
     opt_dispatch,
     opt_affinity,
+    opt_priority,
+    opt_group,
+    opt_affinity_group,
+    opt_batch,
+    opt_deadline,
+    opt_cancel,
+    opt_light,
 };
 
 template <int OptType>
@@ -36,6 +43,58 @@ struct __go_option<opt_affinity>
     explicit __go_option(bool affinity) : affinity_(affinity) {}
 };
 
+template <>
+struct __go_option<opt_priority>
+{
+    int priority_;
+    explicit __go_option(int priority) : priority_(priority) {}
+};
+
+template <>
+struct __go_option<opt_group>
+{
+    SchedulingGroup* group_;
+    explicit __go_option(SchedulingGroup* group) : group_(group) {}
+    explicit __go_option(SchedulingGroup& group) : group_(&group) {}
+};
+
+template <>
+struct __go_option<opt_affinity_group>
+{
+    uint64_t key_;
+    explicit __go_option(uint64_t key) : key_(key) {}
+};
+
+template <>
+struct __go_option<opt_batch>
+{
+    std::size_t n_;
+    explicit __go_option(std::size_t n) : n_(n) {}
+};
+
+template <>
+struct __go_option<opt_deadline>
+{
+    FastSteadyClock::time_point deadline_;
+    explicit __go_option(FastSteadyClock::time_point deadline) : deadline_(deadline) {}
+};
+
+template <>
+struct __go_option<opt_cancel>
+{
+    CancelToken token_;
+    explicit __go_option(CancelToken const& token) : token_(token) {}
+};
+
+template <>
+struct __go_option<opt_light>
+{
+    bool light_;
+    explicit __go_option(bool light) : light_(light) {}
+};
+
+struct __go_batch;
+
 struct __go
 {
     __go(const char* file, int lineno)
@@ -71,10 +130,91 @@ struct __go
         return *this;
     }
 
+    ALWAYS_INLINE __go& operator-(__go_option<opt_priority> const& opt)
+    {
+        opt_.priority_ = opt.priority_;
+        return *this;
+    }
+
+    ALWAYS_INLINE __go& operator-(__go_option<opt_group> const& opt)
+    {
+        opt_.group_ = opt.group_;
+        return *this;
+    }
+
+    ALWAYS_INLINE __go& operator-(__go_option<opt_affinity_group> const& opt)
+    {
+        opt_.affinityKey_ = opt.key_;
+        return *this;
+    }
+
+    ALWAYS_INLINE __go& operator-(__go_option<opt_deadline> const& opt)
+    {
+        opt_.deadline_ = opt.deadline_;
+        return *this;
+    }
+
+    ALWAYS_INLINE __go& operator-(__go_option<opt_cancel> const& opt)
+    {
+        opt_.cancel_ = opt.token_;
+        return *this;
+    }
+
+    ALWAYS_INLINE __go& operator-(__go_option<opt_light> const& opt)
+    {
+        opt_.light_ = opt.light_;
+        return *this;
+    }
+
+    ALWAYS_INLINE __go_batch operator-(__go_option<opt_batch> const& opt);
+
     TaskOpt opt_;
     Scheduler* scheduler_;
 };
 
+// 批量创建: 执行函数接收协程序号(0 ~ n-1)
+struct __go_batch
+{
+    __go_batch(__go const& go, std::size_t n) : go_(go), n_(n) {}
+
+    template <typename Function>
+    ALWAYS_INLINE void operator-(Function const& f)
+    {
+        Scheduler* scheduler = go_.scheduler_;
+        if (!scheduler) scheduler = Processer::GetCurrentScheduler();
+        if (!scheduler) scheduler = &Scheduler::getInstance();
+        scheduler->CreateTasks(n_, [&](std::size_t i) { return TaskF([f, i]{ f(i); }); }, go_.opt_);
+    }
+
+    template <int OptType>
+    ALWAYS_INLINE __go_batch& operator-(__go_option<OptType> const& opt)
+    {
+        go_ - opt;
+        return *this;
+    }
+
+    __go go_;
+    std::size_t n_;
+};
+
+ALWAYS_INLINE __go_batch __go::operator-(__go_option<opt_batch> const& opt)
+{
+    return __go_batch(*this, opt.n_);
+}
+
+// 轻量任务: 经过同样的可执行队列调度, 但不分配栈, 由P在自己的线程栈上直接调用fn.
+// 适合只执行几微秒、从不阻塞的小函数, 创建和调度的开销远小于协程.
+// fn中不能挂起: 对外表现为原生线程(IsCoroutine()为false, co_yield什么都不做),
+// 调用阻塞操作(hook的IO和sleep、Channel等)会阻塞整个P线程, 此时打印错误, debug版本断言失败.
+ALWAYS_INLINE void post(TaskF const& fn, Scheduler* scheduler = nullptr)
+{
+    if (!scheduler) scheduler = Processer::GetCurrentScheduler();
+    if (!scheduler) scheduler = &Scheduler::getInstance();
+    TaskOpt opt;
+    opt.light_ = true;
+    scheduler->CreateTask(fn, opt);
+}
+
 //template <typename R>
 //struct __async_wait
 //{
@@ -6,6 +6,7 @@
 #include "spinlock.h"
 #include "util.h"
 #include "dbg_timer.h"
+#include "metrics.h"
 
 namespace co
 {
@@ -33,6 +34,7 @@ public:
             std::unique_lock<LFLock> lock(active_, std::defer_lock);
             if (!lock.try_lock()) return ;
             slot_ = nullptr;
+            Metrics::Inc(eMetric::timers_fired);
             cb_();
         }
 
@@ -84,6 +86,9 @@ public:
 
     std::size_t GetPoolSize();
 
+    // 时间轮中等待触发的定时器数量(近似值)
+    std::size_t GetPendingCount();
+
     // 设置定时器
     TimerId StartTimer(FastSteadyClock::duration dur, F const& cb);
     TimerId StartTimer(FastSteadyClock::time_point tp, F const& cb);
@@ -197,12 +202,23 @@ typename Timer<F>::TimerId Timer<F>::StartTimer(FastSteadyClock::time_point tp,
 {
     Element* element = NewElement();
     element->init(cb, tp);
+    Metrics::Inc(eMetric::timers_started);
     TimerId timerId(element);
 
     Dispatch(element, false);
     return timerId;
 }
 
+template <typename F>
+std::size_t Timer<F>::GetPendingCount()
+{
+    std::size_t n = completeSlot_.count_;
+    for (int i = 0; i < 8; ++i)
+        for (int j = 0; j < 256; ++j)
+            n += slots_[i][j].count_;
+    return n;
+}
+
 template <typename F>
 void Timer<F>::ThreadRun()
 {
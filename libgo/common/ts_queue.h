@@ -6,6 +6,23 @@
 namespace co
 {
 
+// 元素在队列(TSQueue/SList)中时是否由队列持有一个引用计数.
+// 默认RefObject的派生类持有; 生命周期由其他方式保证的类型可以特化为false,
+// 进出队列时就不再有引用计数的原子操作.
+template <typename T>
+struct TSQueueHoldsRef : public std::is_base_of<RefObject, T> {};
+
+template <typename T>
+ALWAYS_INLINE void QueueIncrementRef(T* ptr)
+{
+    if (TSQueueHoldsRef<T>::value) IncrementRef(ptr);
+}
+template <typename T>
+ALWAYS_INLINE void QueueDecrementRef(T* ptr)
+{
+    if (TSQueueHoldsRef<T>::value) DecrementRef(ptr);
+}
+
 // 侵入式数据结构Hook基类
 struct TSQueueHook
 {
@@ -165,9 +182,7 @@ public:
         else tail_ = (T*)tail_->prev;
         ptr->prev = ptr->next = nullptr;
         -- count_;
-//        printf("SList.erase ptr=%p, use_count=%ld\n", ptr, ptr->use_count());
-        DecrementRef(ptr);
-//        printf("SList.erase done\n");
+        QueueDecrementRef(ptr);
     }
     std::size_t size() const
     {
@@ -186,6 +201,27 @@ public:
         count_ = 0;
     }
 
+    // 取出头部元素(不修改引用计数)
+    T* pop_front()
+    {
+        T* ptr = head_;
+        if (!ptr) return nullptr;
+        head_ = (T*)ptr->next;
+        if (head_) ptr->unlink(head_);
+        else tail_ = nullptr;
+        -- count_;
+        return ptr;
+    }
+
+    // 追加到尾部(不修改引用计数)
+    void push_back(T* ptr)
+    {
+        if (tail_) tail_->link(ptr);
+        else head_ = ptr;
+        tail_ = ptr;
+        ++ count_;
+    }
+
     ALWAYS_INLINE TSQueueHook* head() { return head_; }
     ALWAYS_INLINE TSQueueHook* tail() { return tail_; }
 };
@@ -222,7 +258,7 @@ public:
         LockGuard lock(lock_);
         while (head_ != tail_) {
             TSQueueHook *prev = tail_->prev;
-            DecrementRef((T*)tail_);
+            QueueDecrementRef((T*)tail_);
             tail_ = prev;
         }
         delete head_;
@@ -279,7 +315,7 @@ public:
         hook->next = nullptr;
         hook->check_ = check_;
         ++ count_;
-        IncrementRef(element);
+        QueueIncrementRef(element);
     }
 
     ALWAYS_INLINE T* pop()
@@ -294,7 +330,7 @@ public:
         ptr->prev = ptr->next = nullptr;
         ptr->check_ = nullptr;
         -- count_;
-        DecrementRef((T*)ptr);
+        QueueDecrementRef((T*)ptr);
         return (T*)ptr;
     }
 
@@ -302,6 +338,11 @@ public:
     {
         if (elements.empty()) return ;
         LockGuard lock(lock_);
+        pushWithoutLock(std::move(elements));
+    }
+    ALWAYS_INLINE void pushWithoutLock(SList<T> && elements)
+    {
+        if (elements.empty()) return ;
         assert(elements.head_->prev == nullptr);
         assert(elements.tail_->next == nullptr);
         TSQueueHook* listHead = elements.head_;
@@ -396,6 +437,42 @@ public:
         return eraseWithoutLock(hook, check);
     }
 
+    // 轮转: 把hook之前的元素整体移动到队尾, 使hook成为队首. O(1)
+    ALWAYS_INLINE void rotateWithoutLock(T* hook)
+    {
+        TSQueueHook* first = head_->next;
+        TSQueueHook* newFirst = static_cast<TSQueueHook*>(hook);
+        if (first == newFirst) return ;
+        TSQueueHook* last = newFirst->prev;
+        last->unlink(newFirst);
+        head_->unlink(first);
+        head_->link(newFirst);
+        tail_->link(first);
+        tail_ = last;
+    }
+
+    // 取出所有满足条件的元素(引用计数随元素转移给返回的SList). O(n)
+    template <typename Pred>
+    ALWAYS_INLINE SList<T> pop_ifWithoutLock(Pred const& pred)
+    {
+        SList<T> out;
+        TSQueueHook* pos = head_->next;
+        while (pos) {
+            TSQueueHook* next = pos->next;
+            if (pred((T*)pos)) {
+                pos->prev->next = next;
+                if (next) next->prev = pos->prev;
+                else tail_ = pos->prev;
+                pos->prev = pos->next = nullptr;
+                pos->check_ = nullptr;
+                -- count_;
+                out.push_back((T*)pos);
+            }
+            pos = next;
+        }
+        return out;
+    }
+
     ALWAYS_INLINE bool eraseWithoutLock(T* hook, bool check = false)
     {
         if (check && hook->check_ != check_) return false;
@@ -410,7 +487,7 @@ public:
         hook->prev = hook->next = nullptr;
         hook->check_ = nullptr;
         -- count_;
-        DecrementRef((T*)hook);
+        QueueDecrementRef((T*)hook);
         return true;
     }
 
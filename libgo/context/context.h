@@ -10,6 +10,9 @@ public:
     Context(fn_t fn, intptr_t vp, std::size_t stackSize)
         : fn_(fn), vp_(vp), stackSize_(stackSize)
     {
+        // 轻量任务没有自己的栈, 在P的线程栈上直接执行
+        if (!stackSize_) return ;
+
         stack_ = (char*)StackTraits::MallocFunc()(stackSize_);
         DebugPrint(dbg_task, "valloc stack. size=%u ptr=%p",
                 stackSize_, stack_);
@@ -5,14 +5,20 @@
 #include "sync/channel.h"
 #include "sync/co_mutex.h"
 #include "sync/co_rwmutex.h"
+#include "sync/future.h"
 #include "timer/timer.h"
 #include "scheduler/processer.h"
 #include "cls/co_local_storage.h"
 #include "pool/connection_pool.h"
 #include "pool/async_coroutine_pool.h"
+#include "pool/parallel.h"
 #include "defer/defer.h"
 #include "debug/listener.h"
 #include "debug/debugger.h"
+#include "debug/tracer.h"
+#include "debug/profiler.h"
+#include "debug/watchdog.h"
+#include "debug/debug_server.h"
 
 #define LIBGO_VERSION 300
 
@@ -22,9 +28,31 @@
 // create coroutine options
 #define co_stack(size) ::co::__go_option<::co::opt_stack_size>{size}-
 #define co_scheduler(pScheduler) ::co::__go_option<::co::opt_scheduler>{pScheduler}-
+// 优先级: co::priority_high, co::priority_normal(默认), co::priority_low
+#define co_priority(n) ::co::__go_option<::co::opt_priority>{n}-
+// 调度组: co::SchedulingGroup::Create创建的组
+#define co_group(pGroup) ::co::__go_option<::co::opt_group>{pGroup}-
+// 亲和组: key相同(非0)的协程尽量放在同一个P上执行, 偷协程时整组一起移动
+#define co_affinity_group(key) ::co::__go_option<::co::opt_affinity_group>{(uint64_t)(key)}-
+// 截止时间: 新协程的阻塞操作最多等待到截止时间(见co::set_deadline)
+#define co_deadline(timepoint) ::co::__go_option<::co::opt_deadline>{timepoint}-
+// 继承当前协程的截止时间
+#define co_inherit_deadline co_deadline(::co::get_deadline())
+// 取消令牌: co::CancelToken::Create()创建, Cancel时立即唤醒新协程的挂起
+#define co_cancel(token) ::co::__go_option<::co::opt_cancel>{token}-
+// 继承当前协程的取消令牌
+#define co_inherit_cancel co_cancel(::co::CancelToken::Current())
 
 #define go_stack(size) go co_stack(size)
 
+// 轻量任务(见co::post): 不分配栈, 在P的线程栈上执行, 不能挂起
+#define co_light ::co::__go_option<::co::opt_light>{true}-
+#define go_fn go co_light
+
+// 批量创建n个协程: go_batch(n) [](std::size_t i){ ... };
+#define co_batch(n) ::co::__go_option<::co::opt_batch>{(std::size_t)(n)}-
+#define go_batch(n) go co_batch(n)
+
 #define co_yield do { ::co::Processer::StaticCoYield(); } while (0)
 
 // coroutine sleep, never blocks current thread if run in coroutine.
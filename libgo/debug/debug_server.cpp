@@ -0,0 +1,230 @@
+#include "debug_server.h"
+#include "../coroutine.h"
+#if defined(LIBGO_SYS_Unix)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+namespace co
+{
+
+DebugServer& DebugServer::getInstance()
+{
+    static DebugServer obj;
+    return obj;
+}
+
+DebugServer::DebugServer()
+{
+    Handle("/snapshot", []{ return CoDebugger::getInstance().GetSnapshot(); });
+    Handle("/trace", []{ return Tracer::getInstance().DumpChromeTrace(); });
+    Handle("/profile", []{ return Profiler::getInstance().GetCallSiteReport(); }, "text/plain");
+    Handle("/metrics", []{ return Metrics::getInstance().ExportPrometheus(); },
+            "text/plain; version=0.0.4");
+    Handle("/blocking", []{ return BlockingWatchdog::getInstance().GetReport(); }, "text/plain");
+}
+
+void DebugServer::Handle(std::string const& path, Handler const& handler,
+        std::string const& contentType)
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    routes_[path] = Route{handler, contentType};
+}
+
+#if defined(LIBGO_SYS_Unix)
+bool DebugServer::Start(std::string const& addr)
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (listenFd_ >= 0) return false;
+
+    int fd = Listen(addr);
+    if (fd < 0) return false;
+    listenFd_ = fd;
+
+    if (!scheduler_) {
+        scheduler_ = Scheduler::Create();
+        Scheduler* scheduler = scheduler_;
+        std::thread([=]{
+                    scheduler->Start(1, 1);
+                }).detach();
+    }
+
+    go co_scheduler(scheduler_) [=]{
+        this->AcceptLoop(fd);
+    };
+    return true;
+}
+
+void DebugServer::Stop()
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (listenFd_ < 0) return ;
+
+    // 唤醒阻塞在accept上的协程, 由它负责close
+    ::shutdown(listenFd_, SHUT_RDWR);
+    listenFd_ = -1;
+    port_ = 0;
+    if (!unixPath_.empty()) {
+        ::unlink(unixPath_.c_str());
+        unixPath_.clear();
+    }
+}
+
+int DebugServer::Listen(std::string const& addr)
+{
+    int fd = -1;
+    if (addr.compare(0, 5, "unix:") == 0) {
+        std::string path = addr.substr(5);
+        struct sockaddr_un sun;
+        memset(&sun, 0, sizeof(sun));
+        if (path.empty() || path.size() >= sizeof(sun.sun_path)) {
+            errno = EINVAL;
+            return -1;
+        }
+
+        sun.sun_family = AF_UNIX;
+        memcpy(sun.sun_path, path.c_str(), path.size());
+        ::unlink(path.c_str());
+
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        if (::bind(fd, (struct sockaddr*)&sun, sizeof(sun)) != 0 || ::listen(fd, 64) != 0) {
+            ErrnoStore es;
+            ::close(fd);
+            return -1;
+        }
+        unixPath_ = path;
+        port_ = 0;
+        return fd;
+    }
+
+    std::size_t pos = addr.rfind(':');
+    if (pos == std::string::npos) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct sockaddr_in sin;
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons((uint16_t)atoi(addr.c_str() + pos + 1));
+    std::string ip = addr.substr(0, pos);
+    if (ip.empty()) ip = "127.0.0.1";
+    if (inet_pton(AF_INET, ip.c_str(), &sin.sin_addr) != 1) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    int reuse = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (::bind(fd, (struct sockaddr*)&sin, sizeof(sin)) != 0 || ::listen(fd, 64) != 0) {
+        ErrnoStore es;
+        ::close(fd);
+        return -1;
+    }
+
+    socklen_t len = sizeof(sin);
+    ::getsockname(fd, (struct sockaddr*)&sin, &len);
+    port_ = ntohs(sin.sin_port);
+    return fd;
+}
+
+void DebugServer::AcceptLoop(int fd)
+{
+    for (;;) {
+        int cfd = ::accept(fd, nullptr, nullptr);
+        if (cfd < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == ECONNABORTED)
+                continue;
+            break;
+        }
+
+        go co_scheduler(scheduler_) [=]{
+            this->OnConnection(cfd);
+        };
+    }
+
+    DebugPrint(dbg_debugger, "DebugServer stop accept. fd=%d errno=%d", fd, errno);
+    ::close(fd);
+}
+
+void DebugServer::OnConnection(int fd)
+{
+    // 防止客户端不发送请求一直占用连接
+    struct timeval tv = {5, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    std::string request;
+    char buf[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n <= 0) break;
+        request.append(buf, n);
+    }
+
+    // 请求行: METHOD PATH VERSION
+    std::string method, path;
+    std::size_t sp1 = request.find(' ');
+    std::size_t sp2 = sp1 == std::string::npos ? sp1 : request.find(' ', sp1 + 1);
+    if (sp2 != std::string::npos) {
+        method = request.substr(0, sp1);
+        path = request.substr(sp1 + 1, sp2 - sp1 - 1);
+        std::size_t q = path.find('?');
+        if (q != std::string::npos)
+            path.resize(q);
+    }
+
+    Route route;
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        auto it = routes_.find(path);
+        if (it != routes_.end())
+            route = it->second;
+    }
+
+    const char* status = "200 OK";
+    std::string body;
+    if (method != "GET") {
+        status = "405 Method Not Allowed";
+    } else if (!route.handler_) {
+        status = "404 Not Found";
+        body = "routes:";
+        std::unique_lock<std::mutex> lock(mtx_);
+        for (auto & kv : routes_)
+            body += " " + kv.first;
+        body += "\n";
+        route.contentType_ = "text/plain";
+    } else {
+        body = route.handler_();
+    }
+
+    char header[256];
+    int len = snprintf(header, sizeof(header), "HTTP/1.0 %s\r\nContent-Type: %s\r\n"
+            "Content-Length: %lu\r\nConnection: close\r\n\r\n", status,
+            route.contentType_.empty() ? "text/plain" : route.contentType_.c_str(),
+            (unsigned long)body.size());
+    std::string response(header, len);
+    response += body;
+
+    std::size_t pos = 0;
+    while (pos < response.size()) {
+        ssize_t n = ::send(fd, response.data() + pos, response.size() - pos, MSG_NOSIGNAL);
+        if (n <= 0) break;
+        pos += n;
+    }
+    ::close(fd);
+}
+#else
+bool DebugServer::Start(std::string const&) { return false; }
+void DebugServer::Stop() {}
+int DebugServer::Listen(std::string const&) { return -1; }
+void DebugServer::AcceptLoop(int) {}
+void DebugServer::OnConnection(int) {}
+#endif
+
+} // namespace co
@@ -0,0 +1,68 @@
+#pragma once
+#include "../common/config.h"
+#include "../common/spinlock.h"
+
+namespace co
+{
+
+class Scheduler;
+
+// 运行时状态查询服务(简易HTTP)
+// 在独立的调度器和线程中用协程处理连接, 业务调度器卡住时仍然可以访问.
+// 内置路由:
+//   /snapshot  运行时状态快照(JSON, 见CoDebugger::GetSnapshot)
+//   /trace     协程事件追踪(Chrome trace格式, 需先开启Tracer)
+//   /profile   CPU采样报告(按go语句位置聚合, 需先开启Profiler)
+//   /metrics   运行时指标(Prometheus文本格式, 见Metrics)
+//   /blocking  阻塞检测报告(按调用点聚合, 需先开启BlockingWatchdog)
+// 例如: curl http://127.0.0.1:9999/snapshot
+//       curl --unix-socket /tmp/libgo.sock http://localhost/snapshot
+class DebugServer
+{
+public:
+    typedef std::function<std::string()> Handler;
+
+    static DebugServer& getInstance();
+
+    // 启动服务
+    // @addr: "ip:port" 监听TCP(port为0时随机分配), 或 "unix:/path" 监听unix socket.
+    // @return: 已经启动或监听失败时返回false
+    bool Start(std::string const& addr);
+
+    // 停止监听, 已经建立的连接处理完后关闭
+    void Stop();
+
+    // 实际监听的TCP端口(unix socket返回0)
+    int Port() const { return port_; }
+
+    // 注册路由, 可以覆盖内置路由
+    void Handle(std::string const& path, Handler const& handler,
+            std::string const& contentType = "application/json");
+
+private:
+    DebugServer();
+    DebugServer(DebugServer const&) = delete;
+    DebugServer& operator=(DebugServer const&) = delete;
+
+    int Listen(std::string const& addr);
+
+    void AcceptLoop(int fd);
+
+    void OnConnection(int fd);
+
+private:
+    struct Route {
+        Handler handler_;
+        std::string contentType_;
+    };
+
+    std::mutex mtx_;
+    std::map<std::string, Route> routes_;
+
+    Scheduler* scheduler_ = nullptr;
+    int listenFd_ = -1;
+    int port_ = 0;
+    std::string unixPath_;
+};
+
+} // namespace co
@@ -4,6 +4,7 @@
 #include "../scheduler/processer.h"
 #include "../task/task.h"
 #include "../netio/unix/reactor.h"
+#include "../netio/unix/hook_helper.h"
 
 namespace co
 {
@@ -55,6 +56,149 @@ std::string CoDebugger::GetAllInfo()
 
     return s;
 }
+static void JsonString(std::string & s, const char* str)
+{
+    s += '"';
+    for (; str && *str; ++str) {
+        char c = *str;
+        switch (c) {
+        case '"': s += "\\\""; break;
+        case '\\': s += "\\\\"; break;
+        case '\n': s += "\\n"; break;
+        case '\r': s += "\\r"; break;
+        case '\t': s += "\\t"; break;
+        default:
+            if ((unsigned char)c < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", (int)c);
+                s += buf;
+            } else {
+                s += c;
+            }
+        }
+    }
+    s += '"';
+}
+
+static void JsonKV(std::string & s, const char* key, uint64_t value, bool comma = true)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "\"%s\":%lu", key, (unsigned long)value);
+    if (comma) s += ',';
+    s += buf;
+}
+
+static void JsonKV(std::string & s, const char* key, bool value, bool comma = true)
+{
+    if (comma) s += ',';
+    s += '"';
+    s += key;
+    s += value ? "\":true" : "\":false";
+}
+
+std::string CoDebugger::GetSnapshot()
+{
+    std::string s;
+    s.reserve(4096);
+    s += '{';
+    JsonKV(s, "timestamp_us", (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count(), false);
+
+    s += ",\"schedulers\":[";
+    std::size_t si = 0;
+    Scheduler::ForeachScheduler([&](Scheduler* sched) {
+        if (si) s += ',';
+        s += '{';
+        JsonKV(s, "id", (uint64_t)si, false);
+        JsonKV(s, "is_default", sched == &Scheduler::getInstance());
+        JsonKV(s, "task_count", (uint64_t)sched->TaskCount());
+        JsonKV(s, "min_thread_number", (uint64_t)sched->minThreadNumber_);
+        JsonKV(s, "max_thread_number", (uint64_t)sched->maxThreadNumber_);
+        JsonKV(s, "alone_timer", sched->timer_ != nullptr);
+        JsonKV(s, "timer_pending", (uint64_t)sched->GetTimer().GetPendingCount());
+
+        // 按状态和创建位置分类的协程数
+        std::map<std::pair<std::string, SourceLocation>, std::size_t> tasks;
+
+        s += ",\"processers\":[";
+        std::size_t pcount = sched->processers_.size();
+        for (std::size_t i = 0; i < pcount; ++i) {
+            Processer* p = sched->processers_[i];
+            uint64_t runningTaskId = 0;
+            std::size_t runnable = 0, wait = 0, newCount = 0;
+
+            auto collect = [&](Processer::TaskQueue & queue, const char* state, std::size_t & count) {
+                std::unique_lock<Processer::TaskQueue::lock_t> lock(queue.LockRef());
+                for (TSQueueHook* pos = queue.head_->next; pos; pos = pos->next) {
+                    Task* tk = (Task*)pos;
+                    if (tk == p->runningTask_ && p->swapInTsc_)
+                        runningTaskId = tk->id_;
+                    ++tasks[std::make_pair(std::string(state), TaskRefLocation(tk))];
+                    ++count;
+                }
+            };
+            for (int prio = 0; prio < priority_count; ++prio)
+                collect(p->runnableQueues_[prio], "Runnable", runnable);
+            collect(p->waitQueue_, "Block", wait);
+            collect(p->newQueue_, "New", newCount);
+
+            if (i) s += ',';
+            s += '{';
+            JsonKV(s, "id", (uint64_t)p->id_, false);
+            JsonKV(s, "active", (bool)p->active_);
+            JsonKV(s, "retired", (bool)p->retired_);
+            JsonKV(s, "waiting", (bool)p->waiting_);
+            JsonKV(s, "blocking", p->IsBlocking());
+            JsonKV(s, "switch_count", (uint64_t)p->switchCount_);
+            JsonKV(s, "running_task", runningTaskId);
+            JsonKV(s, "runnable", (uint64_t)runnable);
+            JsonKV(s, "wait", (uint64_t)wait);
+            JsonKV(s, "new", (uint64_t)newCount);
+            s += '}';
+        }
+        s += ']';
+
+        s += ",\"tasks\":[";
+        bool first = true;
+        for (auto & kv : tasks) {
+            if (!first) s += ',';
+            first = false;
+            s += "{\"state\":";
+            JsonString(s, kv.first.first.c_str());
+            s += ",\"file\":";
+            JsonString(s, kv.first.second.file_ ? kv.first.second.file_ : "");
+            JsonKV(s, "line", (uint64_t)kv.first.second.lineno_);
+            JsonKV(s, "count", (uint64_t)kv.second);
+            s += '}';
+        }
+        s += "]}";
+        ++si;
+    });
+    s += ']';
+
+#if defined(LIBGO_SYS_Unix)
+    s += ",\"reactors\":[";
+    std::vector<Reactor::Stat> stats = Reactor::GetStats();
+    for (std::size_t i = 0; i < stats.size(); ++i) {
+        if (i) s += ',';
+        s += '{';
+        JsonKV(s, "loops", stats[i].loops_, false);
+        JsonKV(s, "events", stats[i].events_);
+        JsonKV(s, "ctls", stats[i].ctls_);
+        s += '}';
+    }
+    s += ']';
+
+    s += ",\"fds\":{";
+    JsonKV(s, "socket", (uint64_t)HookHelper::getInstance().GetFdCount(eFdType::eSocket), false);
+    JsonKV(s, "pipe", (uint64_t)HookHelper::getInstance().GetFdCount(eFdType::ePipe));
+    s += '}';
+#endif
+
+    s += '}';
+    return s;
+}
+
 int CoDebugger::TaskCount()
 {
 #if ENABLE_DEBUGGER
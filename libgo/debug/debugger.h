@@ -70,6 +70,12 @@ public:
     // 获取当前所有信息
     std::string GetAllInfo();
 
+    // 获取运行时状态快照(JSON格式)
+    // 包括各调度器、调度线程、队列长度、按状态和创建位置分类的协程数、定时器、reactor、fd数量等.
+    // 逐个队列短暂加锁统计, 不会停止调度; 正在被迁移(steal)中的协程可能不计入.
+    // 不依赖ENABLE_DEBUGGER.
+    std::string GetSnapshot();
+
     // 当前协程总数量
     int TaskCount();
 
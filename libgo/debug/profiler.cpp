@@ -0,0 +1,321 @@
+#include "profiler.h"
+#include "../scheduler/processer.h"
+#include "../scheduler/ref.h"
+#include <sys/time.h>
+#include <execinfo.h>
+#include <dlfcn.h>
+#include <cxxabi.h>
+#include <fstream>
+
+namespace co
+{
+
+// 样本环形缓冲区
+struct SampleRing
+{
+    Profiler::Sample* samples_;
+
+    // 各样本的写入序号(顺序锁): 奇数表示正在写入, 读取前后序号一致且为偶数时样本完整
+    std::atomic<uint64_t>* seqs_;
+
+    std::size_t capacity_;
+
+    explicit SampleRing(std::size_t capacity)
+        : samples_(new Profiler::Sample[capacity]),
+        seqs_(new std::atomic<uint64_t>[capacity]),
+        capacity_(capacity)
+    {
+        for (std::size_t i = 0; i < capacity; ++i)
+            seqs_[i].store(0, std::memory_order_relaxed);
+    }
+};
+
+// 信号处理函数中使用的全局状态
+// 信号处理函数只读取一次s_ring. Stop之后其他线程上已经进入的信号处理函数可能仍在写入旧的缓冲区,
+// 所以换成其他大小的缓冲区时旧的缓冲区只作废, 不释放.
+static std::atomic<SampleRing*> s_ring{nullptr};
+static std::vector<SampleRing*> s_retiredRings;
+static std::atomic<std::size_t> s_index{0};
+static std::atomic<std::size_t> s_dropped{0};
+static volatile bool s_active = false;
+
+Profiler& Profiler::getInstance()
+{
+    static Profiler obj;
+    return obj;
+}
+
+void Profiler::OnSignal(int signum, siginfo_t* info, void* ucontext)
+{
+    (void)signum, (void)info, (void)ucontext;
+    if (!s_active) return ;
+
+    SampleRing* ring = s_ring.load(std::memory_order_acquire);
+    if (!ring) return ;
+
+    int savedErrno = errno;
+
+    std::size_t idx = s_index.fetch_add(1, std::memory_order_relaxed);
+    if (idx >= ring->capacity_)
+        ++s_dropped;
+
+    std::size_t slot = idx % ring->capacity_;
+    std::atomic<uint64_t> & seq = ring->seqs_[slot];
+    seq.store((uint64_t)idx * 2 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    Sample & sample = ring->samples_[slot];
+    sample.taskId_ = 0;
+    sample.location_ = SourceLocation();
+
+    Task* tk = Processer::GetCurrentTask();
+    if (tk) {
+        sample.taskId_ = tk->id_;
+        sample.location_ = TaskRefLocation(tk);
+    }
+
+    sample.depth_ = CaptureSignalStack(sample.pcs_, kMaxDepth);
+    seq.store((uint64_t)idx * 2 + 2, std::memory_order_release);
+
+    errno = savedErrno;
+}
+
+bool Profiler::Start(int hz, std::size_t maxSamples)
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (running_) return false;
+
+    if (hz <= 0) hz = 100;
+    if (hz > 1000000) hz = 1000000;
+    periodUs_ = 1000000 / hz;
+
+    // 缓冲区大小改变时换一个新的缓冲区, 旧样本丢弃
+    if (!maxSamples) maxSamples = 1;
+    SampleRing* ring = s_ring.load(std::memory_order_relaxed);
+    if (!ring || ring->capacity_ != maxSamples) {
+        if (ring)
+            s_retiredRings.push_back(ring);
+        s_index = 0;
+        s_dropped = 0;
+        s_ring.store(new SampleRing(maxSamples), std::memory_order_release);
+    }
+
+    WarmUpBacktrace();
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = &Profiler::OnSignal;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGPROF, &sa, &oldAction_) != 0)
+        return false;
+
+    s_active = true;
+    running_ = true;
+
+    struct itimerval timer;
+    timer.it_interval.tv_sec = periodUs_ / 1000000;
+    timer.it_interval.tv_usec = periodUs_ % 1000000;
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+        s_active = false;
+        running_ = false;
+        sigaction(SIGPROF, &oldAction_, nullptr);
+        return false;
+    }
+    return true;
+}
+
+void Profiler::Stop()
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (!running_) return ;
+
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, nullptr);
+
+    // 不恢复成默认处理(默认行为是终止进程), 以免已经投递的SIGPROF杀掉进程.
+    s_active = false;
+    running_ = false;
+}
+
+void Profiler::Clear()
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (running_) return ;
+    s_index = 0;
+    s_dropped = 0;
+}
+
+std::size_t Profiler::SampleCount()
+{
+    SampleRing* ring = s_ring.load(std::memory_order_acquire);
+    return ring ? (std::min)(s_index.load(std::memory_order_relaxed), ring->capacity_) : 0;
+}
+
+std::size_t Profiler::DroppedCount()
+{
+    return s_dropped;
+}
+
+std::vector<Profiler::Sample> Profiler::Copy()
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    std::vector<Sample> out;
+    SampleRing* ring = s_ring.load(std::memory_order_acquire);
+    if (!ring) return out;
+
+    std::size_t end = s_index.load(std::memory_order_relaxed);
+    std::size_t begin = end > ring->capacity_ ? end - ring->capacity_ : 0;
+    out.reserve(end - begin);
+    Sample sample;
+    for (std::size_t i = begin; i < end; ++i) {
+        std::size_t slot = i % ring->capacity_;
+        uint64_t seq = ring->seqs_[slot].load(std::memory_order_acquire);
+        memcpy(&sample, &ring->samples_[slot], sizeof(sample));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // 正在写入或拷贝期间被覆盖的样本
+        if (!seq || (seq & 1) || seq != ring->seqs_[slot].load(std::memory_order_relaxed))
+            continue;
+        out.push_back(sample);
+    }
+    return out;
+}
+
+static std::string LocationName(SourceLocation const& loc)
+{
+    if (!loc.file_) return "(not in coroutine)";
+    return std::string(loc.file_) + ":" + std::to_string(loc.lineno_);
+}
+
+std::string Profiler::SymbolName(void* pc)
+{
+    Dl_info info;
+    if (dladdr(pc, &info) && info.dli_sname) {
+        int status = 0;
+        char* realname = abi::__cxa_demangle(info.dli_sname, 0, 0, &status);
+        std::string name(status == 0 && realname ? realname : info.dli_sname);
+        free(realname);
+        return name;
+    }
+
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%p", pc);
+    return buf;
+}
+
+void Profiler::WarmUpBacktrace()
+{
+    // backtrace首次调用时会加载libgcc_s(会分配内存), 先在信号处理函数外预热
+    void* warm[4];
+    backtrace(warm, 4);
+}
+
+// 本函数、信号处理函数和内核信号帧占用的栈帧数
+static const int kSkipFrames = 3;
+
+__attribute__((noinline)) int Profiler::CaptureSignalStack(void** pcs, int maxDepth)
+{
+    // backtrace不是异步信号安全的: 依赖WarmUpBacktrace提前加载好libgcc_s,
+    // 之后的调用只遍历栈帧, 不再分配内存或加锁.
+    void* buf[kMaxDepth + kSkipFrames];
+    maxDepth = (std::min)(maxDepth, (int)kMaxDepth);
+    int depth = backtrace(buf, maxDepth + kSkipFrames);
+    depth = (std::max)(depth - kSkipFrames, 0);
+    memcpy(pcs, buf + kSkipFrames, depth * sizeof(void*));
+    return depth;
+}
+
+std::string Profiler::GetCallSiteReport()
+{
+    std::vector<Sample> samples = Copy();
+
+    std::map<SourceLocation, std::size_t> counts;
+    for (auto & sample : samples)
+        ++counts[sample.location_];
+
+    std::vector<std::pair<std::size_t, SourceLocation>> sorted;
+    for (auto & kv : counts)
+        sorted.emplace_back(kv.second, kv.first);
+    std::sort(sorted.begin(), sorted.end(),
+            [](std::pair<std::size_t, SourceLocation> const& lhs,
+                std::pair<std::size_t, SourceLocation> const& rhs) {
+                return lhs.first > rhs.first;
+            });
+
+    std::string s;
+    char buf[64];
+    snprintf(buf, sizeof(buf), "Samples: %lu, Dropped: %lu\n",
+            (unsigned long)samples.size(), (unsigned long)DroppedCount());
+    s += buf;
+    for (auto & kv : sorted) {
+        snprintf(buf, sizeof(buf), "%10lu  %6.2f%%  ", (unsigned long)kv.first,
+                samples.empty() ? 0.0 : 100.0 * kv.first / samples.size());
+        s += buf;
+        s += LocationName(kv.second);
+        s += "\n";
+    }
+    return s;
+}
+
+bool Profiler::DumpPprof(const char* filename)
+{
+    std::vector<Sample> samples = Copy();
+
+    std::map<std::vector<void*>, uintptr_t> stacks;
+    for (auto & sample : samples)
+        ++stacks[std::vector<void*>(sample.pcs_, sample.pcs_ + sample.depth_)];
+
+    std::vector<uintptr_t> words;
+    // header: 0, 头部长度, 版本号, 采样周期(微秒), 保留
+    words.insert(words.end(), {0, 3, 0, (uintptr_t)periodUs_, 0});
+    for (auto & kv : stacks) {
+        words.push_back(kv.second);
+        words.push_back(kv.first.size());
+        for (void* pc : kv.first)
+            words.push_back((uintptr_t)pc);
+    }
+    // trailer
+    words.insert(words.end(), {0, 1, 0});
+
+    std::ofstream ofs(filename, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!ofs) return false;
+    ofs.write((const char*)words.data(), words.size() * sizeof(uintptr_t));
+
+    // 符号化需要的内存映射信息
+    std::ifstream maps("/proc/self/maps");
+    ofs << maps.rdbuf();
+    return !!ofs;
+}
+
+std::string Profiler::DumpCollapsed()
+{
+    std::vector<Sample> samples = Copy();
+
+    std::map<void*, std::string> symbols;
+    std::map<std::string, std::size_t> stacks;
+    for (auto & sample : samples) {
+        std::string line = LocationName(sample.location_);
+        for (int i = sample.depth_ - 1; i >= 0; --i) {
+            void* pc = sample.pcs_[i];
+            auto it = symbols.find(pc);
+            if (it == symbols.end())
+                it = symbols.insert(std::make_pair(pc, SymbolName(pc))).first;
+            line += ";";
+            line += it->second;
+        }
+        ++stacks[line];
+    }
+
+    std::string s;
+    for (auto & kv : stacks) {
+        s += kv.first;
+        s += " ";
+        s += std::to_string(kv.second);
+        s += "\n";
+    }
+    return s;
+}
+
+} // namespace co
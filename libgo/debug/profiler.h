@@ -0,0 +1,93 @@
+#pragma once
+#include "../common/config.h"
+#include "../common/util.h"
+#include <signal.h>
+
+namespace co
+{
+
+// 协程感知的CPU采样分析器
+// 基于setitimer(ITIMER_PROF) + SIGPROF, 按进程消耗的CPU时间周期性采样.
+// 每个样本记录当前正在运行的协程ID、创建协程的go语句位置(TaskRefLocation)以及调用栈.
+// 信号处理函数中不分配内存、不加锁, 样本写入预分配的环形缓冲区, 写满后覆盖最旧的样本,
+// 内存有上限且始终保留最近的样本, 可以在线上以100Hz长期开启.
+class Profiler
+{
+public:
+    // 每个样本最多记录的栈帧数
+    static const int kMaxDepth = 64;
+
+    struct Sample
+    {
+        uint64_t taskId_;   // 0表示不在协程中
+        SourceLocation location_;
+        int depth_;
+        void* pcs_[kMaxDepth];
+    };
+
+    static Profiler& getInstance();
+
+    // 开始采样
+    // @hz: 每秒采样次数(按CPU时间计)
+    // @maxSamples: 环形缓冲区可容纳的样本数
+    // @return: 已经在采样中或安装信号处理函数失败时返回false
+    bool Start(int hz = 100, std::size_t maxSamples = 64 * 1024);
+
+    // 停止采样, 保留已采集的样本
+    void Stop();
+
+    bool IsRunning() const { return running_; }
+
+    // 清空已采集的样本(仅在停止状态下有效)
+    void Clear();
+
+    // 缓冲区中的样本数
+    std::size_t SampleCount();
+
+    // 缓冲区写满后被新样本覆盖的样本数
+    std::size_t DroppedCount();
+
+    // 按go语句位置聚合的采样报告(文本)
+    std::string GetCallSiteReport();
+
+    // 导出pprof兼容的CPU profile(gperftools的legacy二进制格式), 可以用
+    //     pprof --text <binary> <file>  或  go tool pprof <binary> <file>
+    // 打开. 该格式不支持标签, 按go语句位置的聚合请使用DumpCollapsed.
+    bool DumpPprof(const char* filename);
+
+    // 导出折叠栈格式(每行 "栈帧;栈帧;... 样本数"), 栈底为go语句位置,
+    // 可以直接交给flamegraph.pl或speedscope生成火焰图.
+    // 可执行文件内的函数需要以-rdynamic链接才能解析出符号名, 否则输出地址.
+    std::string DumpCollapsed();
+
+    // 把指令地址解析为函数名(demangle后), 解析不到时返回地址
+    static std::string SymbolName(void* pc);
+
+    // 预热backtrace, 在安装调用CaptureSignalStack的信号处理函数之前调用
+    static void WarmUpBacktrace();
+
+    // 采集被信号打断处的调用栈, 跳过信号处理函数自身的栈帧; 必须由信号处理函数直接调用
+    // @returns: 写入pcs的栈帧数
+    static int CaptureSignalStack(void** pcs, int maxDepth);
+
+private:
+    Profiler() = default;
+    Profiler(Profiler const&) = delete;
+    Profiler& operator=(Profiler const&) = delete;
+
+    static void OnSignal(int signum, siginfo_t* info, void* ucontext);
+
+    // 拷贝出已采集的样本
+    std::vector<Sample> Copy();
+
+private:
+    std::mutex mtx_;
+
+    volatile bool running_ = false;
+
+    int periodUs_ = 0;
+
+    struct sigaction oldAction_;
+};
+
+} // namespace co
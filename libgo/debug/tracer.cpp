@@ -0,0 +1,201 @@
+#include "tracer.h"
+#include "../scheduler/processer.h"
+#include <fstream>
+
+namespace co
+{
+
+volatile bool Tracer::s_enabled_ = false;
+
+const char* GetTraceEventName(eTraceEvent event)
+{
+    switch (event) {
+    case eTraceEvent::create:
+        return "create";
+    case eTraceEvent::swap_in:
+        return "swap_in";
+    case eTraceEvent::swap_out:
+        return "swap_out";
+    case eTraceEvent::suspend:
+        return "suspend";
+    case eTraceEvent::wakeup:
+        return "wakeup";
+    case eTraceEvent::steal:
+        return "steal";
+    case eTraceEvent::timer_fire:
+        return "timer_fire";
+    case eTraceEvent::io_wait:
+        return "io_wait";
+    default:
+        return "unkown";
+    }
+}
+
+TraceBuffer::TraceBuffer(std::size_t capacity, int procId)
+{
+    Reset(capacity, procId);
+}
+
+void TraceBuffer::Reset(std::size_t capacity, int procId)
+{
+    std::size_t n = 1;
+    while (n < capacity) n <<= 1;
+    records_.resize(n);
+    records_.shrink_to_fit();
+    mask_ = n - 1;
+    procId_ = procId;
+    writeIdx_.store(0, std::memory_order_release);
+}
+
+std::vector<TraceRecord> TraceBuffer::Copy()
+{
+    uint64_t end = writeIdx_.load(std::memory_order_acquire);
+    uint64_t begin = end > records_.size() ? end - records_.size() : 0;
+    std::vector<TraceRecord> out;
+    out.reserve(end - begin);
+    for (uint64_t i = begin; i < end; ++i)
+        out.push_back(records_[i & mask_]);
+    return out;
+}
+
+void TraceBuffer::Clear()
+{
+    writeIdx_.store(0, std::memory_order_release);
+}
+
+Tracer& Tracer::getInstance()
+{
+    // 线程退出时还要归还缓冲区, 不析构
+    static Tracer *obj = new Tracer;
+    return *obj;
+}
+
+Tracer::LocalBufferHolder::~LocalBufferHolder()
+{
+    if (buffer_)
+        Tracer::getInstance().ReleaseBuffer(buffer_);
+}
+
+Tracer::LocalBufferHolder& Tracer::LocalBuffer()
+{
+    static thread_local LocalBufferHolder holder;
+    return holder;
+}
+
+TraceBuffer* Tracer::NewLocalBuffer()
+{
+    Processer* proc = Processer::GetCurrentProcesser();
+    int procId = proc ? proc->Id() : -1;
+    TraceBuffer* buffer;
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (!freeBuffers_.empty()) {
+        buffer = freeBuffers_.back();
+        freeBuffers_.pop_back();
+        buffer->Reset(bufferSize_, procId);
+    } else {
+        buffer = new TraceBuffer(bufferSize_, procId);
+        buffers_.push_back(buffer);
+    }
+    LocalBuffer().buffer_ = buffer;
+    return buffer;
+}
+
+void Tracer::ReleaseBuffer(TraceBuffer* buffer)
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    freeBuffers_.push_back(buffer);
+}
+
+void Tracer::Enable(std::size_t bufferSize)
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    bufferSize_ = (std::max<std::size_t>)(bufferSize, 16);
+    s_enabled_ = true;
+}
+
+void Tracer::Disable()
+{
+    s_enabled_ = false;
+}
+
+void Tracer::Clear()
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    for (auto buffer : buffers_)
+        buffer->Clear();
+}
+
+std::string Tracer::DumpChromeTrace()
+{
+    std::vector<std::pair<int, std::vector<TraceRecord>>> all;
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        for (auto buffer : buffers_)
+            all.emplace_back(buffer->ProcId(), buffer->Copy());
+    }
+
+    uint64_t baseTsc = std::numeric_limits<uint64_t>::max();
+    for (auto & kv : all)
+        if (!kv.second.empty())
+            baseTsc = (std::min)(baseTsc, kv.second.front().tsc_);
+
+    double cyclesPerUs = FastSteadyClock::CyclesPerNanosecond() * 1000;
+
+    std::string s;
+    s.reserve(4096);
+    s += "{\"traceEvents\":[";
+    bool first = true;
+    char buf[256];
+    for (std::size_t tid = 0; tid < all.size(); ++tid) {
+        int procId = all[tid].first;
+        int len;
+        if (procId >= 0)
+            len = snprintf(buf, sizeof(buf), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                    "\"args\":{\"name\":\"Processer(%d)\"}}", (int)tid, procId);
+        else
+            len = snprintf(buf, sizeof(buf), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                    "\"args\":{\"name\":\"Thread(%d)\"}}", (int)tid, (int)tid);
+        if (!first) s += ",";
+        first = false;
+        s.append(buf, len);
+
+        for (TraceRecord & record : all[tid].second) {
+            // 不同CPU的tsc可能有偏差, 早于基准的记录按0处理, 避免无符号减法回绕
+            double ts = record.tsc_ > baseTsc ? (record.tsc_ - baseTsc) / cyclesPerUs : 0;
+            switch (record.event_) {
+            case eTraceEvent::swap_in:
+                len = snprintf(buf, sizeof(buf), ",{\"name\":\"task(%lu)\",\"cat\":\"task\",\"ph\":\"B\",\"pid\":1,"
+                        "\"tid\":%d,\"ts\":%.3f}",
+                        (unsigned long)record.taskId_, (int)tid, ts);
+                break;
+
+            case eTraceEvent::swap_out:
+                len = snprintf(buf, sizeof(buf), ",{\"name\":\"task(%lu)\",\"cat\":\"task\",\"ph\":\"E\",\"pid\":1,"
+                        "\"tid\":%d,\"ts\":%.3f,\"args\":{\"state\":\"%s\"}}",
+                        (unsigned long)record.taskId_, (int)tid, ts,
+                        GetTaskStateName((TaskState)record.arg_));
+                break;
+
+            default:
+                len = snprintf(buf, sizeof(buf), ",{\"name\":\"%s\",\"cat\":\"event\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,"
+                        "\"tid\":%d,\"ts\":%.3f,\"args\":{\"task\":%lu,\"arg\":%u}}",
+                        GetTraceEventName(record.event_), (int)tid, ts,
+                        (unsigned long)record.taskId_, (unsigned)record.arg_);
+                break;
+            }
+            s.append(buf, len);
+        }
+    }
+    s += "],\"displayTimeUnit\":\"ns\"}";
+    return s;
+}
+
+bool Tracer::DumpChromeTrace(const char* filename)
+{
+    std::ofstream ofs(filename, std::ios::out | std::ios::trunc);
+    if (!ofs) return false;
+    ofs << DumpChromeTrace();
+    return !!ofs;
+}
+
+} // namespace co
@@ -0,0 +1,139 @@
+#pragma once
+#include "../common/config.h"
+#include "../common/clock.h"
+#include "../common/spinlock.h"
+
+namespace co
+{
+
+// 追踪事件类型
+enum class eTraceEvent : uint8_t
+{
+    create,         // 创建协程
+    swap_in,        // 切入协程
+    swap_out,       // 切出协程(arg: 切出时的TaskState)
+    suspend,        // 挂起协程
+    wakeup,         // 唤醒协程
+    steal,          // 偷协程(taskId: 被偷的P的ID, arg: 偷走的数量)
+    timer_fire,     // 定时器到期唤醒挂起的协程
+    io_wait,        // 协程等待IO(arg: fd)
+};
+
+const char* GetTraceEventName(eTraceEvent event);
+
+// 追踪记录(定长二进制格式)
+struct TraceRecord
+{
+    uint64_t tsc_;
+    uint64_t taskId_;
+    uint32_t arg_;
+    eTraceEvent event_;
+};
+
+// 环形缓冲区
+// 每个线程一个, 只有所属线程写入, 写满后覆盖最旧的记录.
+// 线程退出后归还给Tracer, 由之后新建的线程复用.
+class TraceBuffer
+{
+public:
+    TraceBuffer(std::size_t capacity, int procId);
+
+    // 清空并重新设置容量和所属线程(复用时调用, 此时没有线程写入)
+    void Reset(std::size_t capacity, int procId);
+
+    ALWAYS_INLINE void Push(eTraceEvent event, uint64_t taskId, uint32_t arg)
+    {
+        uint64_t idx = writeIdx_.load(std::memory_order_relaxed);
+        TraceRecord & record = records_[idx & mask_];
+        record.tsc_ = FastSteadyClock::rdtsc();
+        record.taskId_ = taskId;
+        record.arg_ = arg;
+        record.event_ = event;
+        writeIdx_.store(idx + 1, std::memory_order_release);
+    }
+
+    // 拷贝出当前缓冲区中的记录(按时间顺序)
+    std::vector<TraceRecord> Copy();
+
+    void Clear();
+
+    int ProcId() const { return procId_; }
+
+private:
+    std::vector<TraceRecord> records_;
+    std::size_t mask_;
+    atomic_t<uint64_t> writeIdx_{0};
+
+    // 所属的调度线程ID(非调度线程为-1)
+    int procId_;
+};
+
+// 协程事件追踪器
+// 始终编译, 运行时开关. 开启后各线程向自己的环形缓冲区写入记录, 无锁无系统调用.
+// 可导出为Chrome trace格式(chrome://tracing 或 https://ui.perfetto.dev 打开).
+class Tracer
+{
+public:
+    static Tracer& getInstance();
+
+    // 开启追踪
+    // @bufferSize: 每个线程的环形缓冲区可容纳的记录数(向上取整到2的幂次),
+    //              只影响开启后新分配或复用的缓冲区.
+    void Enable(std::size_t bufferSize = 64 * 1024);
+
+    void Disable();
+
+    ALWAYS_INLINE static bool IsEnabled() { return s_enabled_; }
+
+    ALWAYS_INLINE static void Trace(eTraceEvent event, uint64_t taskId, uint32_t arg = 0)
+    {
+        if (LIKELY(!s_enabled_)) return ;
+        TraceBuffer* buffer = LocalBuffer().buffer_;
+        if (UNLIKELY(!buffer))
+            buffer = getInstance().NewLocalBuffer();
+        buffer->Push(event, taskId, arg);
+    }
+
+    // 清空所有缓冲区(建议在Disable之后调用)
+    void Clear();
+
+    // 导出Chrome trace格式的json
+    // 导出时最好先Disable, 否则正在覆盖的少量记录可能不准确.
+    std::string DumpChromeTrace();
+
+    bool DumpChromeTrace(const char* filename);
+
+private:
+    Tracer() = default;
+    Tracer(Tracer const&) = delete;
+    Tracer& operator=(Tracer const&) = delete;
+
+    // 线程退出时把缓冲区归还给Tracer
+    struct LocalBufferHolder
+    {
+        TraceBuffer* buffer_ = nullptr;
+
+        ~LocalBufferHolder();
+    };
+
+    static LocalBufferHolder& LocalBuffer();
+
+    TraceBuffer* NewLocalBuffer();
+
+    void ReleaseBuffer(TraceBuffer* buffer);
+
+private:
+    static volatile bool s_enabled_;
+
+    std::size_t bufferSize_ = 64 * 1024;
+
+    std::mutex mtx_;
+
+    // 所有线程的缓冲区, 线程退出后仍然保留, 以便导出
+    std::vector<TraceBuffer*> buffers_;
+
+    // 已退出线程归还的缓冲区, 被复用前其中的记录仍然可以导出
+    std::vector<TraceBuffer*> freeBuffers_;
+};
+
+} // namespace co
@@ -0,0 +1,217 @@
+#include "watchdog.h"
+#include "profiler.h"
+#include "../scheduler/processer.h"
+#include "../scheduler/ref.h"
+#include <thread>
+
+namespace co
+{
+
+volatile bool BlockingWatchdog::s_enabled_ = false;
+
+// 信号处理函数中使用的全局状态
+// 同一时刻只采集一个P(多个调度器的DispatcherThread通过s_captureMtx串行化),
+// 信号处理函数通过CAS s_target认领本次采集, 防止超时后迟到的信号写坏下一次的结果.
+static std::mutex s_captureMtx;
+static std::atomic<Processer*> s_target{nullptr};
+static std::atomic<bool> s_done{false};
+static uint64_t s_taskId = 0;
+static SourceLocation s_location;
+static int s_depth = 0;
+static void* s_pcs[BlockingWatchdog::kMaxDepth];
+
+// 等待信号处理函数完成采集的最长时间
+static const int kCaptureTimeoutMs = 100;
+
+BlockingWatchdog& BlockingWatchdog::getInstance()
+{
+    static BlockingWatchdog obj;
+    return obj;
+}
+
+void BlockingWatchdog::OnSignal(int signum, siginfo_t* info, void* ucontext)
+{
+    (void)signum, (void)info, (void)ucontext;
+    Processer* proc = Processer::GetCurrentProcesser();
+    if (!proc) return ;
+
+    Processer* expect = proc;
+    if (!s_target.compare_exchange_strong(expect, nullptr))
+        return ;
+
+    int savedErrno = errno;
+
+    s_taskId = 0;
+    s_location = SourceLocation();
+    Task* tk = Processer::GetCurrentTask();
+    if (tk) {
+        s_taskId = tk->id_;
+        s_location = TaskRefLocation(tk);
+    }
+
+    s_depth = Profiler::CaptureSignalStack(s_pcs, kMaxDepth);
+    s_done.store(true, std::memory_order_release);
+
+    errno = savedErrno;
+}
+
+bool BlockingWatchdog::Enable(int signo)
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (s_enabled_) return false;
+
+    Profiler::WarmUpBacktrace();
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = &BlockingWatchdog::OnSignal;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(signo, &sa, &oldAction_) != 0)
+        return false;
+
+    signo_ = signo;
+    s_enabled_ = true;
+    return true;
+}
+
+void BlockingWatchdog::Disable()
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (!s_enabled_) return ;
+    s_enabled_ = false;
+
+    // 等待正在进行中的采集结束后再恢复原来的信号处理
+    std::unique_lock<std::mutex> captureLock(s_captureMtx);
+    sigaction(signo_, &oldAction_, nullptr);
+}
+
+void BlockingWatchdog::SetHandler(Handler const& handler)
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    handler_ = handler;
+}
+
+void BlockingWatchdog::Capture(Processer* proc)
+{
+    Event event;
+    event.procId_ = proc->id_;
+    event.taskId_ = 0;
+    event.blockedUs_ = proc->NowMicrosecond() - proc->markTick_;
+
+    {
+        std::unique_lock<std::mutex> captureLock(s_captureMtx);
+        if (!s_enabled_) return ;
+
+        s_done = false;
+        s_target = proc;
+        if (pthread_kill(proc->nativeThread_, signo_) == 0) {
+            for (int i = 0; i < kCaptureTimeoutMs * 10 && !s_done; ++i)
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+
+        // 信号处理函数没有认领本次采集, 作废; 已经认领的等它写完.
+        if (s_target.exchange(nullptr) == nullptr) {
+            while (!s_done.load(std::memory_order_acquire))
+                std::this_thread::yield();
+
+            event.taskId_ = s_taskId;
+            event.location_ = s_location;
+            event.stack_.assign(s_pcs, s_pcs + s_depth);
+        }
+    }
+
+    DebugPrint(dbg_scheduler, "Watchdog: processer(%d) blocked %ld us, task(%lu)",
+            event.procId_, (long)event.blockedUs_, (unsigned long)event.taskId_);
+
+    Handler handler;
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        ++eventCount_;
+        CallSite & site = callSites_[CallSiteKey(event.location_, event.stack_)];
+        ++site.count_;
+        site.totalBlockedUs_ += event.blockedUs_;
+        site.maxBlockedUs_ = (std::max)(site.maxBlockedUs_, event.blockedUs_);
+        handler = handler_;
+    }
+
+    if (handler)
+        handler(event);
+}
+
+std::size_t BlockingWatchdog::EventCount()
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    return eventCount_;
+}
+
+void BlockingWatchdog::Clear()
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    callSites_.clear();
+    eventCount_ = 0;
+}
+
+static std::string LocationName(SourceLocation const& loc)
+{
+    if (!loc.file_) return "(unknown)";
+    return std::string(loc.file_) + ":" + std::to_string(loc.lineno_);
+}
+
+static void AppendStack(std::string & s, std::vector<void*> const& stack)
+{
+    for (std::size_t i = 0; i < stack.size(); ++i) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "    #%-2d ", (int)i);
+        s += buf;
+        s += Profiler::SymbolName(stack[i]);
+        s += "\n";
+    }
+}
+
+std::string BlockingWatchdog::Event::ToString() const
+{
+    char buf[128];
+    snprintf(buf, sizeof(buf), "processer(%d) blocked %ld us, task(%lu) ",
+            procId_, (long)blockedUs_, (unsigned long)taskId_);
+    std::string s(buf);
+    s += LocationName(location_);
+    s += "\n";
+    AppendStack(s, stack_);
+    return s;
+}
+
+std::string BlockingWatchdog::GetReport()
+{
+    std::vector<std::pair<CallSiteKey, CallSite>> sorted;
+    std::size_t total;
+    {
+        std::unique_lock<std::mutex> lock(mtx_);
+        sorted.assign(callSites_.begin(), callSites_.end());
+        total = eventCount_;
+    }
+    std::sort(sorted.begin(), sorted.end(),
+            [](std::pair<CallSiteKey, CallSite> const& lhs,
+                std::pair<CallSiteKey, CallSite> const& rhs) {
+                return lhs.second.count_ > rhs.second.count_;
+            });
+
+    std::string s;
+    char buf[128];
+    snprintf(buf, sizeof(buf), "Blocking events: %lu\n", (unsigned long)total);
+    s += buf;
+    for (auto & kv : sorted) {
+        CallSite const& site = kv.second;
+        snprintf(buf, sizeof(buf), "%10lu  avg=%ldus max=%ldus  ",
+                (unsigned long)site.count_,
+                (long)(site.totalBlockedUs_ / (int64_t)site.count_),
+                (long)site.maxBlockedUs_);
+        s += buf;
+        s += LocationName(kv.first.first);
+        s += "\n";
+        AppendStack(s, kv.first.second);
+    }
+    return s;
+}
+
+} // namespace co
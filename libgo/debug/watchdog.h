@@ -0,0 +1,98 @@
+#pragma once
+#include "../common/config.h"
+#include "../common/util.h"
+#include <signal.h>
+
+namespace co
+{
+
+class Processer;
+
+// 阻塞检测看门狗
+// 调度线程(DispatcherThread)发现某个P的协程超过cycle_timeout_us没有切换时,
+// 向该P的线程发送信号, 在信号处理函数中记录正在运行的协程ID、go语句位置和调用栈,
+// 用来定位没有被hook的阻塞调用(如直接syscall、第三方库内部的阻塞IO、长时间计算等).
+// 每次阻塞只采集一次, 按(go语句位置 + 调用栈)聚合.
+//
+// 注意: 信号处理函数以SA_RESTART安装, 但nanosleep、epoll_wait等不可重启的系统调用
+//       被打断时仍然会返回EINTR, 开启前请确认阻塞代码能处理EINTR.
+class BlockingWatchdog
+{
+public:
+    // 每次采集最多记录的栈帧数
+    static const int kMaxDepth = 64;
+
+    // 一次阻塞事件
+    struct Event
+    {
+        int procId_;
+        uint64_t taskId_;           // 0表示没有采集到(信号未及时处理)
+        SourceLocation location_;
+
+        // 检测到阻塞时已经持续的时间(微秒)
+        int64_t blockedUs_;
+
+        std::vector<void*> stack_;
+
+        // 可读的描述(多行, 包含符号化的调用栈)
+        std::string ToString() const;
+    };
+
+    typedef std::function<void(Event const&)> Handler;
+
+    static BlockingWatchdog& getInstance();
+
+    // 开启看门狗
+    // @signo: 用于打断阻塞线程的信号, 默认使用SIGURG(默认行为是忽略, 不会误杀进程)
+    // @return: 已经开启或安装信号处理函数失败时返回false
+    bool Enable(int signo = SIGURG);
+
+    void Disable();
+
+    ALWAYS_INLINE static bool IsEnabled() { return s_enabled_; }
+
+    // 每次检测到阻塞时回调(在调度线程中执行, 不要在其中做耗时操作)
+    void SetHandler(Handler const& handler);
+
+    // 检测到的阻塞次数
+    std::size_t EventCount();
+
+    // 按调用点聚合的报告(文本, 按次数降序)
+    std::string GetReport();
+
+    void Clear();
+
+    // 由DispatcherThread调用: 采集阻塞中的P正在执行的协程信息
+    void Capture(Processer* proc);
+
+private:
+    BlockingWatchdog() = default;
+    BlockingWatchdog(BlockingWatchdog const&) = delete;
+    BlockingWatchdog& operator=(BlockingWatchdog const&) = delete;
+
+    static void OnSignal(int signum, siginfo_t* info, void* ucontext);
+
+private:
+    static volatile bool s_enabled_;
+
+    std::mutex mtx_;
+
+    int signo_ = 0;
+
+    struct sigaction oldAction_;
+
+    Handler handler_;
+
+    struct CallSite
+    {
+        std::size_t count_ = 0;
+        int64_t totalBlockedUs_ = 0;
+        int64_t maxBlockedUs_ = 0;
+    };
+
+    typedef std::pair<SourceLocation, std::vector<void*>> CallSiteKey;
+    std::map<CallSiteKey, CallSite> callSites_;
+    std::size_t eventCount_ = 0;
+};
+
+} // namespace co
@@ -3,6 +3,7 @@
 #include "reactor_element.h"
 #include "fd_context.h"
 #include "hook_helper.h"
+#include "hook.h"
 #include <poll.h>
 #include <thread>
 #include <sys/epoll.h>
@@ -50,7 +51,9 @@ short int ReactorEvent2PollEvent(uint32_t reactorEvent)
 
 EpollReactor::EpollReactor()
 {
-    epfd_ = epoll_create(1024);
+    // reactor自己的epfd不经过hook
+    initHook();
+    epfd_ = epoll_create_f(1024);
     InitLoopThread();
 }
 
@@ -61,6 +64,7 @@ bool EpollReactor::AddEvent(int fd, short int addEvent, short int promiseEvent)
     ev.data.fd = fd;
     int op = addEvent == promiseEvent ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
     int res = CallWithoutINTR<int>(::epoll_ctl, epfd_, op, fd, &ev);
+    ctlCount_.fetch_add(1, std::memory_order_relaxed);
     DebugPrint(dbg_ioblock, "EpollReactor::ADD fd = %d, addEvent = %s, promiseEvent = %s, "
             "epoll_ctl op = %s, ret = %d, errno = %d",
             fd, PollEvent2Str(addEvent), PollEvent2Str(promiseEvent),
@@ -75,6 +79,7 @@ bool EpollReactor::DelEvent(int fd, short int delEvent, short int promiseEvent)
     ev.data.fd = fd;
     int op = promiseEvent == 0 ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
     int res = CallWithoutINTR<int>(::epoll_ctl, epfd_, op, fd, &ev);
+    ctlCount_.fetch_add(1, std::memory_order_relaxed);
     DebugPrint(dbg_ioblock, "EpollReactor::DEL fd = %d, delEvent = %s, promiseEvent = %s, "
             "epoll_ctl op = %s, ret = %d, errno = %d",
             fd, PollEvent2Str(delEvent), PollEvent2Str(promiseEvent),
@@ -86,7 +91,9 @@ void EpollReactor::Run()
 {
     const int cEvent = 1024;
     struct epoll_event evs[cEvent];
-    int n = CallWithoutINTR<int>(::epoll_wait, epfd_, evs, cEvent, 10);
+    int n = CallWithoutINTR<int>(epoll_wait_f, epfd_, evs, cEvent, 10);
+    ++loopCount_;
+    if (n > 0) eventCount_ += n;
     for (int i = 0; i < n; ++i) {
         struct epoll_event & ev = evs[i];
         int fd = ev.data.fd;
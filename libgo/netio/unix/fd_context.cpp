@@ -18,6 +18,7 @@ const char* FdType2Str(eFdType fdType)
     switch (fdType) {
         LIBGO_E2S_DEFINE(eFdType::eSocket);
         LIBGO_E2S_DEFINE(eFdType::ePipe);
+        LIBGO_E2S_DEFINE(eFdType::eEpoll);
         default:
             return "Unkown FdType";
     }
@@ -30,6 +31,7 @@ FdContext::FdContext(int fd, eFdType fdType, bool isNonBlocking, SocketAttribute
     fdType_ = fdType;
     sockAttr_ = sockAttr;
     isNonBlocking_ = isNonBlocking;
+    kernelNonBlocking_ = std::make_shared<std::atomic<bool>>(fdType == eFdType::eSocket || isNonBlocking);
     tcpConnectTimeout_ = 0;
     recvTimeout_ = 0;
     sendTimeout_ = 0;
@@ -47,20 +49,25 @@ bool FdContext::IsTcpSocket()
     return sockAttr_.type_ == SOCK_STREAM &&
         (sockAttr_.domain_ == AF_INET || sockAttr_.domain_ == AF_INET6);
 }
-bool FdContext::SetNonBlocking(bool isNonBlocking)
+bool FdContext::SetKernelNonBlocking(int fd, bool nonBlocking)
 {
-    int flags = CallWithoutINTR<int>(fcntl_f, fd_, F_GETFL, 0);
-    bool old = flags & O_NONBLOCK;
-    if (isNonBlocking == old) return old;
+    int flags = CallWithoutINTR<int>(fcntl_f, fd, F_GETFL, 0);
+    if (flags == -1) return false;
+    if (!!(flags & O_NONBLOCK) == nonBlocking) return true;
 
-    CallWithoutINTR<int>(fcntl_f, fd_, F_SETFL,
-            isNonBlocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
-    OnSetNonBlocking(isNonBlocking);
-    return true;
+    flags = nonBlocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    return CallWithoutINTR<int>(fcntl_f, fd, F_SETFL, flags) == 0;
 }
 void FdContext::OnSetNonBlocking(bool isNonBlocking)
 {
     isNonBlocking_ = isNonBlocking;
+    kernelNonBlocking_->store(isNonBlocking, std::memory_order_relaxed);
+}
+void FdContext::OnDupToStdio()
+{
+    if (isNonBlocking_ || !IsKernelNonBlocking()) return ;
+    if (SetKernelNonBlocking(fd_, false))
+        kernelNonBlocking_->store(false, std::memory_order_relaxed);
 }
 bool FdContext::IsNonBlocking()
 {
@@ -105,6 +112,7 @@ FdContextPtr FdContext::Clone(int newFd)
     ctx->tcpConnectTimeout_ = tcpConnectTimeout_;
     ctx->recvTimeout_ = recvTimeout_;
     ctx->sendTimeout_ = sendTimeout_;
+    ctx->kernelNonBlocking_ = kernelNonBlocking_;
     return ctx;
 }
 
@@ -10,6 +10,7 @@ typedef std::shared_ptr<FdContext> FdContextPtr;
 enum class eFdType : uint8_t {
     eSocket,
     ePipe,
+    eEpoll,
 };
 const char* FdType2Str(eFdType fdType);
 
@@ -46,6 +47,9 @@ public:
 
     bool IsNonBlocking();
 
+    // 内核中是否是非阻塞的
+    bool IsKernelNonBlocking() const { return kernelNonBlocking_->load(std::memory_order_relaxed); }
+
     void SetTcpConnectTimeout(int milliseconds);
 
     int GetTcpConnectTimeout();
@@ -54,9 +58,21 @@ public:
 
     SocketAttribute GetSocketAttribute() const { return sockAttr_; }
 
+    eFdType GetFdType() const { return fdType_; }
+
+    // epoll fd: 下次epoll_wait是否先乐观地非阻塞取一次, 否则直接挂起等待reactor通知.
+    bool GetReadyHint() const { return readyHint_.load(std::memory_order_relaxed); }
+
+    void SetReadyHint(bool ready) { readyHint_.store(ready, std::memory_order_relaxed); }
+
 public:
+    // 用户通过F_SETFL/FIONBIO设置了O_NONBLOCK, 内核中的标识与用户设置一致
     void OnSetNonBlocking(bool isNonBlocking);
 
+    // fd被dup2到标准输入输出(0~2)上: 用户视角阻塞时恢复内核中的阻塞模式,
+    // 避免不经过hook的读写(stdio等)和子进程拿到非阻塞的fd
+    void OnDupToStdio();
+
     void OnSetSocketTimeout(int timeoutType, int microseconds);
 
     FdContextPtr Clone(int newFd);
@@ -64,16 +80,22 @@ public:
     void OnClose();
 
 public:
-    bool SetNonBlocking(bool isNonBlocking);
+    // 设置fd在内核中的O_NONBLOCK, 已经一致时不再调用F_SETFL
+    static bool SetKernelNonBlocking(int fd, bool nonBlocking = true);
 
 private:
     int fd_;
     eFdType fdType_;
     SocketAttribute sockAttr_;
-    bool isNonBlocking_;
+    bool isNonBlocking_;    // 用户视角的非阻塞标识
+
+    // 内核中的O_NONBLOCK属于打开文件描述, dup出的fd共享同一个标识.
+    // socket创建后在内核中总是非阻塞的(直到用户显式清除), 其他fd与用户视角一致.
+    std::shared_ptr<std::atomic<bool>> kernelNonBlocking_;
     int tcpConnectTimeout_;
     long recvTimeout_;
     long sendTimeout_;
+    std::atomic<bool> readyHint_{true};
 };
 
 } // namespace co
@@ -9,14 +9,16 @@
 #include <netdb.h>
 #include <assert.h>
 #include <chrono>
-#include <map>
 #include <stdarg.h>
 #include <poll.h>
+#include <sys/syscall.h>
 #include "../../scheduler/processer.h"
+#include "../../scheduler/scheduler.h"
 #include "reactor.h"
 #include "hook_helper.h"
 #include "../../sync/co_mutex.h"
 #include "../../cls/co_local_storage.h"
+#include "../../debug/tracer.h"
 #if defined(LIBGO_SYS_Linux)
 # include <sys/epoll.h>
 #elif defined(LIBGO_SYS_FreeBSD)
@@ -40,37 +42,6 @@ namespace co {
         return true;
     }
 
-#if defined(LIBGO_SYS_Linux)
-    int libgo_epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
-    {
-        Task* tk = Processer::GetCurrentTask();
-        DebugPrint(dbg_hook, "task(%s) call libgo_epoll_wait. %s coroutine.",
-                tk->DebugInfo(), Processer::IsCoroutine() ? "In" : "Not in");
-
-        if (!tk)
-            return epoll_wait_f(epfd, events, maxevents, timeout);
-
-        int res = epoll_wait_f(epfd, events, maxevents, 0);
-        if (res == -1) {
-            return -1;
-        } else if (res > 0) {
-            return res;
-        }
-
-        // res == 0, wait by poll.
-        struct pollfd pfd;
-        pfd.fd = epfd;
-        pfd.events = POLLIN | POLLOUT;
-        pfd.revents = 0;
-        res = poll(&pfd, 1, timeout);
-        if (res == -1)
-            return -1;
-
-        return epoll_wait_f(epfd, events, maxevents, 0);
-    }
-#elif defined(LIBGO_SYS_FreeBSD)
-#endif
-
     inline int libgo_poll(struct pollfd *fds, nfds_t nfds, int timeout, bool nonblocking_check)
     {
         Task* tk = Processer::GetCurrentTask();
@@ -80,8 +51,16 @@ namespace co {
                 (int)nfds, timeout, nonblocking_check,
                 Processer::IsCoroutine() ? "In" : "Not in");
 
-        if (!tk)
+        if (!tk) {
+            // 轻量任务中: 已经就绪时不会阻塞
+            if (UNLIKELY(Processer::IsRunningLight()) && timeout != 0) {
+                int res = poll_f(fds, nfds, 0);
+                if (res != 0)
+                    return res;
+                Processer::OnBlockInLight("poll");
+            }
             return poll_f(fds, nfds, timeout);
+        }
 
         if (timeout == 0)
             return poll_f(fds, nfds, timeout);
@@ -96,71 +75,197 @@ namespace co {
         if (nfds == negative_fd_n) {
             // co sleep
             if (timeout > 0) {
-                Processer::Suspend(std::chrono::milliseconds(timeout));
+                Metrics::Inc(eMetric::hook_sleeps);
+                Processer::Suspend(std::chrono::milliseconds(timeout), eSuspendReason::sleep);
                 Processer::StaticCoYield();
             }
+            if (Processer::IsCancelled()) {
+                errno = ECANCELED;
+                return -1;
+            }
             return 0;
         }
         // --------------------------------
 
-        if (nonblocking_check) {
+        // 同一个协程连续poll同一组fd时复用上次在reactor中的注册,
+        // 只有上次之后触发过的fd需要检查状态和重新注册.
+        PollCache & cache = TaskRefPollCache(tk);
+        PollWaiterPtr waiter = cache.waiter_;
+        if (!waiter || !waiter->Match(fds, nfds)) {
+            if (waiter) waiter->retired_ = true;
+            waiter.reset(new PollWaiter);
+            waiter->Reset(fds, nfds);
+            cache.waiter_ = waiter;
+        }
+
+        std::vector<nfds_t> & rearm = waiter->rearm_;
+        rearm.clear();
+        {
+            std::unique_lock<LFLock> lock(waiter->lock_);
+            rearm.swap(waiter->disarmed_);
+            // 上次poll返回后收到的事件已经过时, 这些fd都在rearm中, 下面重新检查和注册
+            for (nfds_t idx : waiter->ready_)
+                waiter->revents_[idx] = 0;
+            waiter->ready_.clear();
+        }
+
+        for (nfds_t i = 0; i < nfds; ++i)
+            fds[i].revents = 0;
+
+        if (nonblocking_check && !rearm.empty()) {
             // 执行一次非阻塞的poll, 检测异常或无效fd.
-            int res = poll_f(fds, nfds, 0);
+            std::vector<pollfd> & check = waiter->check_;
+            check.resize(rearm.size());
+            for (std::size_t k = 0; k < rearm.size(); ++k) {
+                check[k] = fds[rearm[k]];
+                check[k].revents = 0;
+            }
+
+            int res = poll_f(check.data(), check.size(), 0);
             if (res != 0) {
                 DebugPrint(dbg_hook, "poll returns %d immediately.", res);
+                if (res > 0)
+                    for (std::size_t k = 0; k < rearm.size(); ++k)
+                        fds[rearm[k]].revents = check[k].revents;
+
+                std::unique_lock<LFLock> lock(waiter->lock_);
+                waiter->disarmed_.insert(waiter->disarmed_.end(), rearm.begin(), rearm.end());
                 return res;
             }
         }
 
-        short int *arrRevents = new short int[nfds];
-        memset(arrRevents, 0, sizeof(short int) * nfds);
-        std::shared_ptr<short int> revents(arrRevents, [](short int* p){ delete[] p; });
+        Metrics::Inc(eMetric::hook_io_waits);
+        Tracer::Trace(eTraceEvent::io_wait, tk->id_, (uint32_t)fds[0].fd);
 
         Processer::SuspendEntry entry;
         if (timeout > 0)
-            entry = Processer::Suspend(std::chrono::milliseconds(timeout));
+            entry = Processer::Suspend(std::chrono::milliseconds(timeout), eSuspendReason::io);
         else
-            entry = Processer::Suspend();
+            entry = Processer::Suspend(eSuspendReason::io);
+
+        {
+            std::unique_lock<LFLock> lock(waiter->lock_);
+            waiter->suspendEntry_ = entry;
+            waiter->waiting_ = true;
+            for (nfds_t idx : rearm)
+                waiter->armed_[idx] = 1;
+
+            // 取出disarmed_之后、开始等待之前触发的事件: 边沿触发不会再通知, 直接唤醒
+            if (!waiter->ready_.empty())
+                Processer::Wakeup(entry);
+        }
 
         // add file descriptor into epoll or poll.
-        bool added = false;
-        for (nfds_t i = 0; i < nfds; ++i) {
-            pollfd & pfd = fds[i];
-            pfd.revents = 0;     // clear revents
-            if (pfd.fd < 0)
-                continue;
-
-            if (!Reactor::Select(pfd.fd).Add(pfd.fd, pfd.events, Reactor::Entry(entry, revents, i))) {
+        for (nfds_t idx : rearm) {
+            pollfd & pfd = fds[idx];
+            if (!Reactor::Select(pfd.fd).Add(pfd.fd, pfd.events, Reactor::Entry(waiter, idx))) {
                 // bad file descriptor
-                arrRevents[i] = POLLNVAL;
-                continue;
+                std::unique_lock<LFLock> lock(waiter->lock_);
+                waiter->armed_[idx] = 0;
+                waiter->disarmed_.push_back(idx);
+                if (!waiter->revents_[idx])
+                    waiter->ready_.push_back(idx);
+                waiter->revents_[idx] = POLLNVAL;
+                Processer::Wakeup(entry);
             }
-
-            added = true;
-        }
-
-        if (!added) {
-            // 全部fd都无法加入epoll
-            for (nfds_t i = 0; i < nfds; ++i)
-                fds[i].revents = arrRevents[i];
-            errno = 0;
-            Processer::Wakeup(entry);
-            Processer::StaticCoYield();
-            return nfds;
         }
 
         Processer::StaticCoYield();
 
         int n = 0;
-        for (nfds_t i = 0; i < nfds; ++i) {
-            fds[i].revents = arrRevents[i];
-            if (fds[i].revents) ++n;
+        {
+            std::unique_lock<LFLock> lock(waiter->lock_);
+            waiter->waiting_ = false;
+            waiter->suspendEntry_ = Processer::SuspendEntry();
+            for (nfds_t idx : waiter->ready_) {
+                fds[idx].revents = waiter->revents_[idx];
+                waiter->revents_[idx] = 0;
+                ++n;
+            }
+            waiter->ready_.clear();
+        }
+
+        // 协程被取消(CancelToken)
+        if (n == 0 && Processer::IsCancelled()) {
+            errno = ECANCELED;
+            return -1;
         }
+
+        // 超过了协程的截止时间
+        if (n == 0 && Processer::IsDeadlineExceeded()) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+
         errno = 0;
         return n;
     }
+
+#if defined(LIBGO_SYS_Linux)
+    int libgo_epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+    {
+        Task* tk = Processer::GetCurrentTask();
+        DebugPrint(dbg_hook, "task(%s) call libgo_epoll_wait(epfd=%d, timeout=%d). %s coroutine.",
+                tk->DebugInfo(), epfd, timeout, Processer::IsCoroutine() ? "In" : "Not in");
+
+        if (!tk && UNLIKELY(Processer::IsRunningLight()) && timeout != 0) {
+            int res = epoll_wait_f(epfd, events, maxevents, 0);
+            if (res != 0)
+                return res;
+            Processer::OnBlockInLight("epoll_wait");
+        }
+
+        if (!tk || timeout == 0)
+            return epoll_wait_f(epfd, events, maxevents, timeout);
+
+        FdContextPtr ctx = HookHelper::getInstance().GetFdContext(epfd);
+        if (!ctx || ctx->GetFdType() != eFdType::eEpoll)
+            return epoll_wait_f(epfd, events, maxevents, timeout);
+
+        // 上次乐观地取到过事件时先非阻塞地取一次.
+        // 否则直接把epfd注册到reactor上挂起, 注册时如果epfd已经就绪reactor会立即通知.
+        if (ctx->GetReadyHint()) {
+            int res = epoll_wait_f(epfd, events, maxevents, 0);
+            if (res != 0) return res;
+            ctx->SetReadyHint(false);
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+        for (;;) {
+            int pollTimeout = -1;
+            if (timeout > 0) {
+                auto remain = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        deadline - std::chrono::steady_clock::now()).count();
+                pollTimeout = remain > 0 ? (int)remain : 0;
+            }
+
+            struct pollfd pfd;
+            pfd.fd = epfd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            int triggers = pollTimeout == 0 ? 0 : libgo_poll(&pfd, 1, pollTimeout, false);
+            if (triggers == -1)
+                return -1;
+
+            // 一次取满了说明事件很多, 下次先乐观地取
+            int res = epoll_wait_f(epfd, events, maxevents, 0);
+            if (res == maxevents)
+                ctx->SetReadyHint(true);
+            if (res != 0 || triggers == 0)
+                return res;
+
+            // 事件被其他等待者先取走了, 继续等待剩余时间
+        }
+    }
+#elif defined(LIBGO_SYS_FreeBSD)
+#endif
 } //namespace co
 
+// 用户视角是阻塞的fd在这里模拟阻塞:
+// 内核中非阻塞的fd(socket)先乐观地执行一次syscall, 返回EAGAIN时再poll等待.
+// 原生线程中也走这里, libgo_poll会直接调用poll_f阻塞线程.
+// 内核中阻塞的fd(pipe, 用户显式清除过O_NONBLOCK的socket): 原生线程直接调用,
+// 协程中先poll等待就绪再调用.
 template <typename OriginF, typename ... Args>
 static ssize_t read_write_mode(int fd, OriginF fn, const char* hook_fn_name,
         short int event, int timeout_so, ssize_t buflen, Args && ... args)
@@ -170,41 +275,90 @@ static ssize_t read_write_mode(int fd, OriginF fn, const char* hook_fn_name,
             tk->DebugInfo(), hook_fn_name, fd, (int)buflen,
             Processer::IsCoroutine() ? "In" : "Not in");
 
-    if (!tk)
-        return fn(fd, std::forward<Args>(args)...);
-
     FdContextPtr ctx = HookHelper::getInstance().GetFdContext(fd);
 
     if (!ctx || ctx->IsNonBlocking())
         return fn(fd, std::forward<Args>(args)...);
 
+    // 轻量任务中也先poll, 会阻塞时报错
+    bool kernelNonBlocking = ctx->IsKernelNonBlocking();
+    if (!kernelNonBlocking && !tk && LIKELY(!Processer::IsRunningLight()))
+        return fn(fd, std::forward<Args>(args)...);
+
     long socketTimeout = ctx->GetSocketTimeoutMicroSeconds(timeout_so);
     int pollTimeout = (socketTimeout == 0) ? -1 : (socketTimeout < 1000 ? 1 : socketTimeout / 1000);
 
-    struct pollfd fds;
-    fds.fd = fd;
-    fds.events = event;
-    fds.revents = 0;
-
-eintr:
-    int triggers = libgo_poll(&fds, 1, pollTimeout, true);
-    if (-1 == triggers) {
-        if (errno == EINTR) goto eintr;
-        return -1;
-    } else if (0 == triggers) {  // poll等待超时
-        errno = EAGAIN;
-        return -1;
+    if (!kernelNonBlocking) {
+        struct pollfd fds;
+        fds.fd = fd;
+        fds.events = event;
+        fds.revents = 0;
+
+        for (;;) {
+            int triggers = libgo_poll(&fds, 1, pollTimeout, true);
+            if (-1 == triggers) {
+                if (errno == EINTR) continue;
+                return -1;
+            } else if (0 == triggers) {  // poll等待超时
+                errno = EAGAIN;
+                return -1;
+            }
+            break;
+        }
+        return CallWithoutINTR<ssize_t>(fn, fd, std::forward<Args>(args)...);
     }
 
-retry_intr_fn:
-    ssize_t res = fn(fd, std::forward<Args>(args)...);
-    if (res == -1) {
+    for (;;) {
+        ssize_t res = fn(fd, args...);
+        if (res != -1)
+            return res;
+
         if (errno == EINTR)
-            goto retry_intr_fn;
-        return -1;
+            continue;
+
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            return -1;
+
+        struct pollfd fds;
+        fds.fd = fd;
+        fds.events = event;
+        fds.revents = 0;
+
+        int triggers = libgo_poll(&fds, 1, pollTimeout, false);
+        if (-1 == triggers) {
+            if (errno == EINTR) continue;
+            return -1;
+        } else if (0 == triggers) {  // poll等待超时
+            errno = EAGAIN;
+            return -1;
+        }
     }
+}
 
-    return res;
+// 协程中的sleep类调用: 挂起到时间结束, 被取消或超过截止时间时提前返回.
+// 提前返回时返回-1并设置errno(ECANCELED/ETIMEDOUT), remain为剩余的时间.
+static int co_sleep_for(std::chrono::nanoseconds dur, std::chrono::nanoseconds * remain)
+{
+    Metrics::Inc(eMetric::hook_sleeps);
+    FastSteadyClock::time_point end = FastSteadyClock::now() + dur;
+    Processer::Suspend(dur, eSuspendReason::sleep);
+    Processer::StaticCoYield();
+
+    int err = 0;
+    if (Processer::IsCancelled())
+        err = ECANCELED;
+    else if (Processer::IsDeadlineExceeded())
+        err = ETIMEDOUT;
+    if (!err)
+        return 0;
+
+    if (remain) {
+        FastSteadyClock::time_point now = FastSteadyClock::now();
+        *remain = end > now ? std::chrono::duration_cast<std::chrono::nanoseconds>(end - now)
+            : std::chrono::nanoseconds(0);
+    }
+    errno = err;
+    return -1;
 }
 
 extern "C" {
@@ -240,10 +394,14 @@ dup3_t dup3_f = NULL;
 fclose_t fclose_f = NULL;
 #if defined(LIBGO_SYS_Linux)
 pipe2_t pipe2_f = NULL;
+accept4_t accept4_f = NULL;
 gethostbyname_r_t gethostbyname_r_f = NULL;
 gethostbyname2_r_t gethostbyname2_r_f = NULL;
 gethostbyaddr_r_t gethostbyaddr_r_f = NULL;
 epoll_wait_t epoll_wait_f = NULL;
+epoll_pwait_t epoll_pwait_f = NULL;
+epoll_create_t epoll_create_f = NULL;
+epoll_create1_t epoll_create1_f = NULL;
 #elif defined(LIBGO_SYS_FreeBSD)
 #endif
 
@@ -254,6 +412,7 @@ int pipe(int pipefd[2])
     Task* tk = Processer::GetCurrentTask();
     DebugPrint(dbg_hook, "task(%s) hook pipe.", tk->DebugInfo());
 
+    // pipe常被子进程继承或交给不经过hook的代码读写, 在内核中保持阻塞
     int res = pipe_f(pipefd);
     if (res == 0) {
         HookHelper::getInstance().OnCreate(pipefd[0], eFdType::ePipe);
@@ -283,9 +442,12 @@ int socket(int domain, int type, int protocol)
 
     Task* tk = Processer::GetCurrentTask();
 
-    int sock = socket_f(domain, type, protocol);
+    bool isNonBlocking = !!(type & SOCK_NONBLOCK);
+    int sockType = type & ~(SOCK_NONBLOCK | SOCK_CLOEXEC);
+    int sock = socket_f(domain, type | SOCK_NONBLOCK, protocol);
     if (sock >= 0) {
-        HookHelper::getInstance().OnCreate(sock, eFdType::eSocket, false, SocketAttribute(domain, type, protocol));
+        HookHelper::getInstance().OnCreate(sock, eFdType::eSocket, isNonBlocking,
+                SocketAttribute(domain, sockType, protocol));
     }
 
     DebugPrint(dbg_hook, "task(%s) hook socket, returns %d.", tk->DebugInfo(), sock);
@@ -299,10 +461,14 @@ int socketpair(int domain, int type, int protocol, int sv[2])
     Task* tk = Processer::GetCurrentTask();
     DebugPrint(dbg_hook, "task(%s) hook socketpair.", tk->DebugInfo());
 
-    int res = socketpair_f(domain, type, protocol, sv);
+    bool isNonBlocking = !!(type & SOCK_NONBLOCK);
+    int sockType = type & ~(SOCK_NONBLOCK | SOCK_CLOEXEC);
+    int res = socketpair_f(domain, type | SOCK_NONBLOCK, protocol, sv);
     if (res == 0) {
-        HookHelper::getInstance().OnCreate(sv[0], eFdType::eSocket, false, SocketAttribute(domain, type, protocol));
-        HookHelper::getInstance().OnCreate(sv[1], eFdType::eSocket, false, SocketAttribute(domain, type, protocol));
+        HookHelper::getInstance().OnCreate(sv[0], eFdType::eSocket, isNonBlocking,
+                SocketAttribute(domain, sockType, protocol));
+        HookHelper::getInstance().OnCreate(sv[1], eFdType::eSocket, isNonBlocking,
+                SocketAttribute(domain, sockType, protocol));
     }
     return res;
 }
@@ -315,22 +481,43 @@ int connect(int fd, const struct sockaddr *addr, socklen_t addrlen)
     DebugPrint(dbg_hook, "task(%s) hook connect. %s coroutine.",
             tk->DebugInfo(), Processer::IsCoroutine() ? "In" : "Not in");
 
-    if (!tk)
-        return connect_f(fd, addr, addrlen);
-
     FdContextPtr ctx = HookHelper::getInstance().GetFdContext(fd);
 
-    if (!ctx)
+    if (!ctx || ctx->IsNonBlocking())
         return connect_f(fd, addr, addrlen);
 
-    if (!ctx->IsTcpSocket() || ctx->IsNonBlocking())
-        return connect_f(fd, addr, addrlen);
+    // 用户显式清除过O_NONBLOCK的socket在内核中也是阻塞的:
+    // 原生线程直接阻塞, 协程中临时切换为非阻塞发起连接, 结束后恢复.
+    struct KernelBlockingGuard {
+        int fd_ = -1;
+        ~KernelBlockingGuard() {
+            if (fd_ < 0) return ;
+            int e = errno;
+            FdContext::SetKernelNonBlocking(fd_, false);
+            errno = e;
+        }
+    } guard;
+    if (!ctx->IsKernelNonBlocking()) {
+        if (!tk && UNLIKELY(Processer::IsRunningLight()))
+            Processer::OnBlockInLight("connect");
+        if (!tk || !FdContext::SetKernelNonBlocking(fd, true))
+            return connect_f(fd, addr, addrlen);
+        guard.fd_ = fd;
+    }
 
     int res;
-
-    {
-        NonBlockingGuard guard(ctx);
+    for (;;) {
         res = connect_f(fd, addr, addrlen);
+        if (res == -1 && errno == EINTR)
+            continue;
+
+        // unix域socket的backlog满时返回EAGAIN, 阻塞式connect会一直等待
+        if (res == -1 && errno == EAGAIN && !ctx->IsTcpSocket()) {
+            if (-1 == usleep(1000))
+                return -1;
+            continue;
+        }
+        break;
     }
 
     if (res == 0) {
@@ -350,9 +537,10 @@ int connect(int fd, const struct sockaddr *addr, socklen_t addrlen)
     struct pollfd pfd;
     pfd.fd = fd;
     pfd.events = POLLOUT;
+    pfd.revents = 0;
     int triggers = libgo_poll(&pfd, 1, pollTimeout, false);
-    if (triggers <= 0 || pfd.revents != POLLOUT) {
-        errno = ETIMEDOUT;
+    if (triggers <= 0) {
+        errno = (triggers == -1 && errno == ECANCELED) ? ECANCELED : ETIMEDOUT;
         return -1;
     }
 
@@ -368,10 +556,9 @@ int connect(int fd, const struct sockaddr *addr, socklen_t addrlen)
     return -1;
 }
 
-int accept(int sockfd, struct sockaddr *addr, socklen_t *addrlen)
+// accept/accept4共用, flags为accept4的flags(SOCK_NONBLOCK/SOCK_CLOEXEC)
+static int accept_mode(int sockfd, struct sockaddr *addr, socklen_t *addrlen, int flags)
 {
-    if (!accept_f) initHook();
-
     FdContextPtr ctx = HookHelper::getInstance().GetFdContext(sockfd);
     if (!ctx) {
         Task* tk = Processer::GetCurrentTask();
@@ -380,13 +567,48 @@ int accept(int sockfd, struct sockaddr *addr, socklen_t *addrlen)
         return -1;
     }
 
-    int sock = read_write_mode(sockfd, accept_f, "accept", POLLIN, SO_RCVTIMEO, 0, addr, addrlen);
-    if (sock >= 0) {
-        HookHelper::getInstance().OnCreate(sock, eFdType::eSocket, false, ctx->GetSocketAttribute());
+    // 调度器过载时暂停接收新连接
+    Scheduler* sched = Processer::GetCurrentScheduler();
+    if (sched && !ctx->IsNonBlocking())
+        sched->WaitAdmission();
+
+    int sock;
+#if defined(LIBGO_SYS_Linux)
+    if (accept4_f) {
+        // accept出来的socket不继承O_NONBLOCK, 由accept4直接以非阻塞方式创建
+        sock = read_write_mode(sockfd, accept4_f, "accept4", POLLIN, SO_RCVTIMEO, 0,
+                addr, addrlen, flags | SOCK_NONBLOCK);
+    } else
+#endif
+    {
+        // 没有accept4时退化为accept + fcntl
+        sock = read_write_mode(sockfd, accept_f, "accept", POLLIN, SO_RCVTIMEO, 0, addr, addrlen);
+        if (sock >= 0) {
+            FdContext::SetKernelNonBlocking(sock);
+            if (flags & SOCK_CLOEXEC)
+                fcntl_f(sock, F_SETFD, fcntl_f(sock, F_GETFD) | FD_CLOEXEC);
+        }
     }
+
+    if (sock >= 0)
+        HookHelper::getInstance().OnCreate(sock, eFdType::eSocket, !!(flags & SOCK_NONBLOCK),
+                ctx->GetSocketAttribute());
     return sock;
 }
 
+int accept(int sockfd, struct sockaddr *addr, socklen_t *addrlen)
+{
+    if (!accept_f) initHook();
+    return accept_mode(sockfd, addr, addrlen, 0);
+}
+#if defined(LIBGO_SYS_Linux)
+int accept4(int sockfd, struct sockaddr *addr, socklen_t *addrlen, int flags)
+{
+    if (!accept_f) initHook();
+    return accept_mode(sockfd, addr, addrlen, flags);
+}
+#endif
+
 ssize_t read(int fd, void *buf, size_t count)
 {
     if (!read_f) initHook();
@@ -405,6 +627,8 @@ ssize_t readv(int fd, const struct iovec *iov, int iovcnt)
 ssize_t recv(int sockfd, void *buf, size_t len, int flags)
 {
     if (!recv_f) initHook();
+    if (flags & MSG_DONTWAIT)
+        return recv_f(sockfd, buf, len, flags);
     return read_write_mode(sockfd, recv_f, "recv", POLLIN, SO_RCVTIMEO, len, buf, len, flags);
 }
 
@@ -412,6 +636,8 @@ ssize_t recvfrom(int sockfd, void *buf, size_t len, int flags,
         struct sockaddr *src_addr, socklen_t *addrlen)
 {
     if (!recvfrom_f) initHook();
+    if (flags & MSG_DONTWAIT)
+        return recvfrom_f(sockfd, buf, len, flags, src_addr, addrlen);
     return read_write_mode(sockfd, recvfrom_f, "recvfrom", POLLIN, SO_RCVTIMEO, len, buf, len, flags,
             src_addr, addrlen);
 }
@@ -419,6 +645,8 @@ ssize_t recvfrom(int sockfd, void *buf, size_t len, int flags,
 ssize_t recvmsg(int sockfd, struct msghdr *msg, int flags)
 {
     if (!recvmsg_f) initHook();
+    if (flags & MSG_DONTWAIT)
+        return recvmsg_f(sockfd, msg, flags);
     size_t buflen = 0;
     for (size_t i = 0; i < msg->msg_iovlen; ++i)
         buflen += msg->msg_iov[i].iov_len;
@@ -443,6 +671,8 @@ ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
 ssize_t send(int sockfd, const void *buf, size_t len, int flags)
 {
     if (!send_f) initHook();
+    if (flags & MSG_DONTWAIT)
+        return send_f(sockfd, buf, len, flags);
     return read_write_mode(sockfd, send_f, "send", POLLOUT, SO_SNDTIMEO, len, buf, len, flags);
 }
 
@@ -450,6 +680,8 @@ ssize_t sendto(int sockfd, const void *buf, size_t len, int flags,
         const struct sockaddr *dest_addr, socklen_t addrlen)
 {
     if (!sendto_f) initHook();
+    if (flags & MSG_DONTWAIT)
+        return sendto_f(sockfd, buf, len, flags, dest_addr, addrlen);
     return read_write_mode(sockfd, sendto_f, "sendto", POLLOUT, SO_SNDTIMEO, len, buf, len, flags,
             dest_addr, addrlen);
 }
@@ -457,6 +689,8 @@ ssize_t sendto(int sockfd, const void *buf, size_t len, int flags,
 ssize_t sendmsg(int sockfd, const struct msghdr *msg, int flags)
 {
     if (!sendmsg_f) initHook();
+    if (flags & MSG_DONTWAIT)
+        return sendmsg_f(sockfd, msg, flags);
     size_t buflen = 0;
     for (size_t i = 0; i < msg->msg_iovlen; ++i)
         buflen += msg->msg_iov[i].iov_len;
@@ -663,101 +897,112 @@ int select(int nfds, fd_set *readfds, fd_set *writefds,
             tk->DebugInfo(),
             (int)nfds, readfds, writefds, exceptfds, timeout_ms);
 
-    if (!tk)
+    if (!tk) {
+        // 轻量任务中: 已经就绪时不会阻塞
+        if (UNLIKELY(Processer::IsRunningLight()) && timeout_ms != 0) {
+            fd_set sets[3];
+            fd_set* in[3] = {readfds, writefds, exceptfds};
+            for (int i = 0; i < 3; ++i)
+                if (in[i]) sets[i] = *in[i];
+            struct timeval zero = {0, 0};
+            int res = select_f(nfds, readfds ? &sets[0] : nullptr, writefds ? &sets[1] : nullptr,
+                    exceptfds ? &sets[2] : nullptr, &zero);
+            if (res != 0) {
+                if (res > 0)
+                    for (int i = 0; i < 3; ++i)
+                        if (in[i]) *in[i] = sets[i];
+                return res;
+            }
+            Processer::OnBlockInLight("select");
+        }
         return select_f(nfds, readfds, writefds, exceptfds, timeout);
+    }
 
     if (timeout_ms == 0)
         return select_f(nfds, readfds, writefds, exceptfds, timeout);
 
     if (!nfds) {
-        Processer::Suspend(std::chrono::milliseconds(timeout_ms));
+        Metrics::Inc(eMetric::hook_sleeps);
+        Processer::Suspend(std::chrono::milliseconds(timeout_ms), eSuspendReason::sleep);
         Processer::StaticCoYield();
+        if (Processer::IsCancelled()) {
+            errno = ECANCELED;
+            return -1;
+        }
         return 0;
     }
 
     nfds = std::min<int>(nfds, FD_SETSIZE);
 
-    // 执行一次非阻塞的select, 检测异常或无效fd.
-    fd_set rfs, wfs, efs;
-    FD_ZERO(&rfs);
-    FD_ZERO(&wfs);
-    FD_ZERO(&efs);
-    if (readfds) rfs = *readfds;
-    if (writefds) wfs = *writefds;
-    if (exceptfds) efs = *exceptfds;
-    timeval zero_tv = {0, 0};
-    int n = select_f(nfds, (readfds ? &rfs : nullptr),
-            (writefds ? &wfs : nullptr),
-            (exceptfds ? &efs : nullptr), &zero_tv);
-    if (n != 0) {
-        if (readfds) *readfds = rfs;
-        if (writefds) *writefds = wfs;
-        if (exceptfds) *exceptfds = efs;
-        return n;
-    }
-
     // -------------------------------------
-    // convert fd_set to pollfd, and clear 3 fd_set.
-    std::pair<fd_set*, uint32_t> sets[3] = {
-        {readfds, POLLIN},
-        {writefds, POLLOUT},
-        {exceptfds, 0}
-    };
-    //static const char* set_names[] = {"readfds", "writefds", "exceptfds"};
-
-    std::map<int, int> pfd_map;
-    for (int i = 0; i < 3; ++i) {
-        fd_set* fds = sets[i].first;
-        if (!fds) continue;
-        int event = sets[i].second;
-        for (int fd = 0; fd < nfds; ++fd) {
-            if (FD_ISSET(fd, fds)) {
-                pfd_map[fd] |= event;
-            }
+    // fd_set按字扫描转换为pollfd, 缓冲区在协程内复用.
+    // 同样的fd_set得到同样的pollfd数组, 连续select时可以复用poll的注册.
+    typedef unsigned long fd_word;
+    const int cWordBits = sizeof(fd_word) * 8;
+    fd_set* sets[3] = {readfds, writefds, exceptfds};
+    std::vector<pollfd> & pfds = CLS(std::vector<pollfd>);
+    pfds.clear();
+    for (int w = 0; w * cWordBits < nfds; ++w) {
+        fd_word bits[3] = {0, 0, 0};
+        for (int i = 0; i < 3; ++i)
+            if (sets[i])
+                bits[i] = reinterpret_cast<const fd_word*>(sets[i])[w];
+
+        fd_word any = bits[0] | bits[1] | bits[2];
+        if (nfds - w * cWordBits < cWordBits)
+            any &= ((fd_word)1 << (nfds - w * cWordBits)) - 1;
+
+        while (any) {
+            int b = __builtin_ctzl(any);
+            any &= any - 1;
+
+            pollfd pfd;
+            pfd.fd = w * cWordBits + b;
+            pfd.events = 0;
+            pfd.revents = 0;
+            if (bits[0] >> b & 1) pfd.events |= POLLIN;
+            if (bits[1] >> b & 1) pfd.events |= POLLOUT;
+            if (bits[2] >> b & 1) pfd.events |= POLLPRI;
+            pfds.push_back(pfd);
         }
-        FD_ZERO(fds);
-    }
-
-    std::vector<pollfd> pfds(pfd_map.size());
-    int i = 0;
-    for (auto &kv : pfd_map) {
-        pollfd &pfd = pfds[i++];
-        pfd.fd = kv.first;
-        pfd.events = kv.second;
     }
     // -------------------------------------
 
     // -------------------------------------
     // poll
-    n = libgo_poll(pfds.data(), pfds.size(), timeout_ms, true);
-    if (n <= 0)
+    int n = libgo_poll(pfds.data(), pfds.size(), timeout_ms, true);
+    if (n < 0)
         return n;
     // -------------------------------------
 
     // -------------------------------------
     // convert pollfd to fd_set.
+    for (int i = 0; i < 3; ++i)
+        if (sets[i])
+            FD_ZERO(sets[i]);
+
     int ret = 0;
-    for (size_t i = 0; i < pfds.size(); ++i) {
-        pollfd &pfd = pfds[i];
-        if (pfd.events & POLLIN) {
-            if (readfds) {
-                FD_SET(pfd.fd, readfds);
-                ++ret;
-            }
+    for (pollfd & pfd : pfds) {
+        if (!pfd.revents) continue;
+
+        if (pfd.revents & POLLNVAL) {
+            errno = EBADF;
+            return -1;
         }
 
-        if (pfd.events & POLLOUT) {
-            if (writefds) {
-                FD_SET(pfd.fd, writefds);
-                ++ret;
-            }
+        if ((pfd.events & POLLIN) && (pfd.revents & (POLLIN | POLLHUP | POLLERR))) {
+            FD_SET(pfd.fd, readfds);
+            ++ret;
         }
 
-        if (pfd.events & ~(POLLIN | POLLOUT)) {
-            if (exceptfds) {
-                FD_SET(pfd.fd, exceptfds);
-                ++ret;
-            }
+        if ((pfd.events & POLLOUT) && (pfd.revents & (POLLOUT | POLLERR))) {
+            FD_SET(pfd.fd, writefds);
+            ++ret;
+        }
+
+        if ((pfd.events & POLLPRI) && (pfd.revents & POLLPRI)) {
+            FD_SET(pfd.fd, exceptfds);
+            ++ret;
         }
     }
     // -------------------------------------
@@ -774,12 +1019,18 @@ unsigned int sleep(unsigned int seconds)
             tk->DebugInfo(), seconds,
             Processer::IsCoroutine() ? "In" : "Not in");
 
-    if (!tk)
+    if (!tk) {
+        if (UNLIKELY(Processer::IsRunningLight()) && seconds)
+            Processer::OnBlockInLight("sleep");
         return sleep_f(seconds);
+    }
 
-    Processer::Suspend(std::chrono::seconds(seconds));
-    Processer::StaticCoYield();
-    return 0;
+    // 提前唤醒时返回剩余的秒数(向上取整)
+    std::chrono::nanoseconds remain;
+    if (co_sleep_for(std::chrono::seconds(seconds), &remain) == 0)
+        return 0;
+    return (unsigned int)std::chrono::duration_cast<std::chrono::seconds>(
+            remain + std::chrono::seconds(1) - std::chrono::nanoseconds(1)).count();
 }
 
 int usleep(useconds_t usec)
@@ -793,13 +1044,13 @@ int usleep(useconds_t usec)
                 Processer::IsCoroutine() ? "In" : "Not in");
     }
 
-    if (!tk)
+    if (!tk) {
+        if (UNLIKELY(Processer::IsRunningLight()) && usec)
+            Processer::OnBlockInLight("usleep");
         return usleep_f(usec);
+    }
 
-    Processer::Suspend(std::chrono::microseconds(usec));
-    Processer::StaticCoYield();
-    return 0;
-
+    return co_sleep_for(std::chrono::microseconds(usec), nullptr);
 }
 
 int nanosleep(const struct timespec *req, struct timespec *rem)
@@ -814,12 +1065,20 @@ int nanosleep(const struct timespec *req, struct timespec *rem)
                 Processer::IsCoroutine() ? "In" : "Not in");
     }
 
-    if (!tk)
+    if (!tk) {
+        if (UNLIKELY(Processer::IsRunningLight()) && (req->tv_sec || req->tv_nsec))
+            Processer::OnBlockInLight("nanosleep");
         return nanosleep_f(req, rem);
+    }
 
-    Processer::Suspend(std::chrono::nanoseconds(req->tv_sec * 1000000000 + req->tv_nsec));
-    Processer::StaticCoYield();
-    return 0;
+    std::chrono::nanoseconds remain;
+    if (co_sleep_for(std::chrono::seconds(req->tv_sec) + std::chrono::nanoseconds(req->tv_nsec), &remain) == 0)
+        return 0;
+    if (rem) {
+        rem->tv_sec = std::chrono::duration_cast<std::chrono::seconds>(remain).count();
+        rem->tv_nsec = (remain - std::chrono::seconds(rem->tv_sec)).count();
+    }
+    return -1;
 }
 
 int close(int fd)
@@ -860,7 +1119,7 @@ int fcntl(int __fd, int __cmd, ...)
                 int newfd = fcntl_f(__fd, __cmd, fd);
                 if (newfd < 0) return newfd;
 
-                HookHelper::getInstance().OnDup(fd, newfd);
+                HookHelper::getInstance().OnDup(__fd, newfd);
                 return newfd;
             }
 
@@ -889,12 +1148,14 @@ int fcntl(int __fd, int __cmd, ...)
                 int flags = va_arg(va, int);
                 va_end(va);
 
-                FdContextPtr ctx = HookHelper::getInstance().GetFdContext(__fd);
-                if (ctx) {
-                    bool isNonBlocking = !!(flags & O_NONBLOCK);
-                    ctx->OnSetNonBlocking(isNonBlocking);
+                // 按用户的设置修改内核中的标识, 显式清除O_NONBLOCK后内核中恢复阻塞
+                int res = fcntl_f(__fd, __cmd, flags);
+                if (res == 0) {
+                    FdContextPtr ctx = HookHelper::getInstance().GetFdContext(__fd);
+                    if (ctx)
+                        ctx->OnSetNonBlocking(!!(flags & O_NONBLOCK));
                 }
-                return fcntl_f(__fd, __cmd, flags);
+                return res;
             }
 
         // struct flock*
@@ -922,7 +1183,14 @@ int fcntl(int __fd, int __cmd, ...)
         case F_GETFL:
             {
                 va_end(va);
-                return fcntl_f(__fd, __cmd);
+                int flags = fcntl_f(__fd, __cmd);
+                if (flags == -1) return flags;
+
+                // 返回用户视角的O_NONBLOCK
+                FdContextPtr ctx = HookHelper::getInstance().GetFdContext(__fd);
+                if (ctx)
+                    flags = ctx->IsNonBlocking() ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+                return flags;
             }
 
         // void
@@ -954,15 +1222,13 @@ int ioctl(int fd, unsigned long int request, ...)
     void* arg = va_arg(va, void*);
     va_end(va);
 
-    if (FIONBIO == request) {
+    int res = ioctl_f(fd, request, arg);
+    if (res == 0 && FIONBIO == request) {
         FdContextPtr ctx = HookHelper::getInstance().GetFdContext(fd);
-        if (ctx) {
-            bool isNonBlocking = !!*(int*)arg;
-            ctx->OnSetNonBlocking(isNonBlocking);
-        }
+        if (ctx)
+            ctx->OnSetNonBlocking(!!*(int*)arg);
     }
-
-    return ioctl_f(fd, request, arg);
+    return res;
 }
 
 int getsockopt(int sockfd, int level, int optname, void *optval, socklen_t *optlen)
@@ -1000,6 +1266,14 @@ int dup(int oldfd)
     HookHelper::getInstance().OnDup(oldfd, newfd);
     return newfd;
 }
+static void OnDupToStdio(int newfd)
+{
+    if (newfd > STDERR_FILENO) return ;
+    FdContextPtr ctx = HookHelper::getInstance().GetFdContext(newfd);
+    if (ctx)
+        ctx->OnDupToStdio();
+}
+
 // TODO: support FD_CLOEXEC
 int dup2(int oldfd, int newfd)
 {
@@ -1011,6 +1285,7 @@ int dup2(int oldfd, int newfd)
     if (ret < 0) return ret;
 
     HookHelper::getInstance().OnDup(oldfd, newfd);
+    OnDupToStdio(newfd);
     return ret;
 }
 // TODO: support FD_CLOEXEC
@@ -1028,6 +1303,7 @@ int dup3(int oldfd, int newfd, int flags)
     if (ret < 0) return ret;
 
     HookHelper::getInstance().OnDup(oldfd, newfd);
+    OnDupToStdio(newfd);
     return ret;
 }
 
@@ -1040,13 +1316,48 @@ int fclose(FILE* fp)
 }
 
 #if defined(LIBGO_SYS_Linux)
-/*
+int epoll_create(int size)
+{
+    if (!epoll_create_f) initHook();
+
+    // epfd在内核中是阻塞的, F_GETFL和fcntl/ioctl的设置都按用户的实际值
+    int epfd = epoll_create_f(size);
+    if (epfd >= 0)
+        HookHelper::getInstance().OnCreate(epfd, eFdType::eEpoll);
+
+    Task* tk = Processer::GetCurrentTask();
+    DebugPrint(dbg_hook, "task(%s) hook epoll_create, returns %d.", tk->DebugInfo(), epfd);
+    return epfd;
+}
+
+int epoll_create1(int flags)
+{
+    if (!epoll_create1_f) initHook();
+
+    int epfd = epoll_create1_f(flags);
+    if (epfd >= 0)
+        HookHelper::getInstance().OnCreate(epfd, eFdType::eEpoll);
+
+    Task* tk = Processer::GetCurrentTask();
+    DebugPrint(dbg_hook, "task(%s) hook epoll_create1, returns %d.", tk->DebugInfo(), epfd);
+    return epfd;
+}
+
 int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
 {
     if (!epoll_wait_f) initHook();
     return libgo_epoll_wait(epfd, events, maxevents, timeout);
 }
-*/
+
+// 协程中无法原子地切换信号掩码, 带sigmask时阻塞当前线程
+int epoll_pwait(int epfd, struct epoll_event *events, int maxevents, int timeout,
+        const sigset_t *sigmask)
+{
+    if (!epoll_pwait_f) initHook();
+    if (sigmask)
+        return epoll_pwait_f(epfd, events, maxevents, timeout, sigmask);
+    return libgo_epoll_wait(epfd, events, maxevents, timeout);
+}
 #elif defined(LIBGO_SYS_FreeBSD)
 #endif
 
@@ -1116,6 +1427,31 @@ ATTRIBUTE_WEAK int __usleep(useconds_t usec)
 namespace co
 {
 
+#if defined(LIBGO_SYS_Linux)
+// libc.a中没有epoll_create等函数的内部别名, 静态链接时直接走syscall
+static int static_epoll_create(int size)
+{
+    if (size <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    return syscall(SYS_epoll_create1, 0);
+}
+static int static_epoll_create1(int flags)
+{
+    return syscall(SYS_epoll_create1, flags);
+}
+static int static_epoll_pwait(int epfd, struct epoll_event *events, int maxevents,
+        int timeout, const sigset_t *sigmask)
+{
+    return syscall(SYS_epoll_pwait, epfd, events, maxevents, timeout, sigmask, _NSIG / 8);
+}
+static int static_accept4(int sockfd, struct sockaddr *addr, socklen_t *addrlen, int flags)
+{
+    return syscall(SYS_accept4, sockfd, addr, addrlen, flags);
+}
+#endif
+
 static int doInitHook()
 {
     connect_f = (connect_t)dlsym(RTLD_NEXT, "connect");
@@ -1151,10 +1487,14 @@ static int doInitHook()
         fclose_f = (fclose_t)dlsym(RTLD_NEXT, "fclose");
 #if defined(LIBGO_SYS_Linux)
         pipe2_f = (pipe2_t)dlsym(RTLD_NEXT, "pipe2");
+        accept4_f = (accept4_t)dlsym(RTLD_NEXT, "accept4");
         gethostbyname_r_f = (gethostbyname_r_t)dlsym(RTLD_NEXT, "gethostbyname_r");
         gethostbyname2_r_f = (gethostbyname2_r_t)dlsym(RTLD_NEXT, "gethostbyname2_r");
         gethostbyaddr_r_f = (gethostbyaddr_r_t)dlsym(RTLD_NEXT, "gethostbyaddr_r");
         epoll_wait_f = (epoll_wait_t)dlsym(RTLD_NEXT, "epoll_wait");
+        epoll_pwait_f = (epoll_pwait_t)dlsym(RTLD_NEXT, "epoll_pwait");
+        epoll_create_f = (epoll_create_t)dlsym(RTLD_NEXT, "epoll_create");
+        epoll_create1_f = (epoll_create1_t)dlsym(RTLD_NEXT, "epoll_create1");
 #elif defined(LIBGO_SYS_FreeBSD)
 #endif
     } else {
@@ -1191,10 +1531,14 @@ static int doInitHook()
         fclose_f = &__new_fclose;
 #if defined(LIBGO_SYS_Linux)
         pipe2_f = &__pipe2;
+        accept4_f = &static_accept4;
         gethostbyname_r_f = &__gethostbyname_r;
         gethostbyname2_r_f = &__gethostbyname2_r;
         gethostbyaddr_r_f = &__gethostbyaddr_r;
         epoll_wait_f = &__epoll_wait_nocancel;
+        epoll_pwait_f = &static_epoll_pwait;
+        epoll_create_f = &static_epoll_create;
+        epoll_create1_f = &static_epoll_create1;
 #elif defined(LIBGO_SYS_FreeBSD)
 #endif
 #endif
@@ -1211,10 +1555,14 @@ static int doInitHook()
             || !gethostbyname2_r_f
             || !gethostbyaddr_r_f
             || !epoll_wait_f
+            || !epoll_pwait_f
+            || !epoll_create_f
+            || !epoll_create1_f
 #elif defined(LIBGO_SYS_FreeBSD)
 #endif
-            // 老版本linux中没有dup3, 无需校验
+            // 老版本linux中没有dup3/accept4, 无需校验
             // || !dup3_f
+            // || !accept4_f
             )
     {
         fprintf(stderr, "Hook syscall failed. Please don't remove libc.a when static-link.\n");
@@ -4,6 +4,7 @@
 #include <resolv.h>
 #include <netdb.h>
 #include <poll.h>
+#include <signal.h>
 
 extern "C" {
 
@@ -13,6 +14,9 @@ extern pipe_t pipe_f;
 #if defined(LIBGO_SYS_Linux)
 typedef int (*pipe2_t)(int pipefd[2], int flags);
 extern pipe2_t pipe2_f;
+
+typedef int (*accept4_t)(int sockfd, struct sockaddr *addr, socklen_t *addrlen, int flags);
+extern accept4_t accept4_f;
 #endif 
 
 typedef int (*socket_t)(int domain, int type, int protocol);
@@ -63,6 +67,16 @@ extern poll_t poll_f;
 typedef int (*epoll_wait_t)(int epfd, struct epoll_event *events,
         int maxevents, int timeout);
 extern epoll_wait_t epoll_wait_f;
+
+typedef int (*epoll_pwait_t)(int epfd, struct epoll_event *events,
+        int maxevents, int timeout, const sigset_t *sigmask);
+extern epoll_pwait_t epoll_pwait_f;
+
+typedef int (*epoll_create_t)(int size);
+extern epoll_create_t epoll_create_f;
+
+typedef int (*epoll_create1_t)(int flags);
+extern epoll_create1_t epoll_create1_f;
 #elif defined(LIBGO_SYS_FreeBSD)
 #endif
 
@@ -144,6 +158,7 @@ namespace co {
     extern bool setTcpConnectTimeout(int fd, int milliseconds);
 
     // libgo提供的协程版epoll_wait接口
+    // epfd需要由hook过的epoll_create/epoll_create1创建, 否则阻塞当前线程
     extern int libgo_epoll_wait(int epfd, struct epoll_event *events,
             int maxevents, int timeout);
 
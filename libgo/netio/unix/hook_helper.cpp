@@ -9,21 +9,6 @@ HookHelper& HookHelper::getInstance()
     return obj;
 }
 
-NonBlockingGuard::NonBlockingGuard(FdContextPtr const& fdCtx)
-    : fdCtx_(fdCtx)
-{
-    isNonBlocking_ = fdCtx_->IsNonBlocking();
-    if (!isNonBlocking_)
-        fdCtx_->SetNonBlocking(true);
-}
-NonBlockingGuard::~NonBlockingGuard()
-{
-    if (!isNonBlocking_) {
-        ErrnoStore es;
-        fdCtx_->SetNonBlocking(false);
-    }
-}
-
 void HookHelper::OnCreate(int fd, eFdType fdType, bool isNonBlocking,
         SocketAttribute sockAttr)
 {
@@ -53,6 +38,21 @@ void HookHelper::OnDup(int from, int to)
     Insert(to, ctx->Clone(to));
 }
 
+std::size_t HookHelper::GetFdCount(eFdType fdType)
+{
+    std::size_t n = 0;
+    for (int i = 0; i <= kBucketCount; ++i) {
+        std::unique_lock<std::mutex> lock(bucketMtx_[i]);
+        for (auto & kv : buckets_[i]) {
+            FdSlotPtr const& slot = kv.second;
+            std::unique_lock<LFLock> slotLock(slot->lock_);
+            if (slot->ctx_ && slot->ctx_->GetFdType() == fdType)
+                ++n;
+        }
+    }
+    return n;
+}
+
 HookHelper::FdSlotPtr HookHelper::GetSlot(int fd)
 {
     int bucketIdx = fd & kBucketCount;
@@ -6,14 +6,6 @@
 
 namespace co {
 
-struct NonBlockingGuard {
-    explicit NonBlockingGuard(FdContextPtr const& fdCtx);
-    ~NonBlockingGuard();
-
-    FdContextPtr fdCtx_;
-    bool isNonBlocking_;
-};
-
 class HookHelper
 {
 public:
@@ -33,6 +25,8 @@ public:
 
 public:
     // 有些socket的close行为hook不到, 创建时如果有旧的context直接close掉即可.
+    // isNonBlocking是用户视角的标识. 调用者要保证socket在内核中已经是非阻塞的,
+    // 其他类型的fd在内核中与用户视角一致.
     void OnCreate(int fd, eFdType fdType, bool isNonBlocking = false,
             SocketAttribute sockAttr = SocketAttribute());
 
@@ -42,6 +36,9 @@ public:
     // 在syscall之后调用
     void OnDup(int from, int to);
 
+    // 当前hook管理的fd数量
+    std::size_t GetFdCount(eFdType fdType);
+
 private:
     FdSlotPtr GetSlot(int fd);
 
@@ -43,6 +43,7 @@ bool KqueueReactor::AddEvent(int fd, short int addEvent, short int promiseEvent)
     }
 
     int res = kevent(kq_, kev, n, nullptr, 0, nullptr);
+    ctlCount_.fetch_add(1, std::memory_order_relaxed);
     DebugPrint(dbg_ioblock, "KqueueReactor::ADD fd = %d, addEvent = %s, promiseEvent = %s, "
             "ret = %d, errno = %d",
             fd, PollEvent2Str(addEvent), PollEvent2Str(promiseEvent), res, errno);
@@ -64,6 +65,7 @@ bool KqueueReactor::DelEvent(int fd, short int delEvent, short int promiseEvent)
     }
 
     int res = kevent(kq_, kev, n, nullptr, 0, nullptr);
+    ctlCount_.fetch_add(1, std::memory_order_relaxed);
     DebugPrint(dbg_ioblock, "KqueueReactor::DEL fd = %d, delEvent = %s, promiseEvent = %s, "
             "ret = %d, errno = %d",
             fd, PollEvent2Str(delEvent), PollEvent2Str(promiseEvent),
@@ -79,6 +81,8 @@ void KqueueReactor::Run()
     timeout.tv_sec = 0;
     timeout.tv_nsec = 10 * 1000 * 1000;
     int n = kevent(kq_, nullptr, 0, kev, cEvent, &timeout);
+    ++loopCount_;
+    if (n > 0) eventCount_ += n;
     std::unordered_map<int, short int> eventMap;
     for (int i = 0; i < n; ++i) {
         struct kevent & ev = kev[i];
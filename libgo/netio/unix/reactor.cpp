@@ -1,6 +1,7 @@
 #include "reactor.h"
 #include "fd_context.h"
 #include "hook_helper.h"
+#include "../../common/metrics.h"
 #include <poll.h>
 #include <thread>
 #include "epoll_reactor.h"
@@ -36,8 +37,52 @@ int Reactor::GetReactorThreadCount()
     return sReactors_.size();
 }
 
+std::vector<Reactor::Stat> Reactor::GetStats()
+{
+    std::vector<Stat> stats;
+    for (Reactor* reactor : sReactors_) {
+        Stat stat;
+        stat.loops_ = reactor->loopCount_;
+        stat.events_ = reactor->eventCount_;
+        stat.ctls_ = reactor->ctlCount_.load(std::memory_order_relaxed);
+        stats.push_back(stat);
+    }
+    return stats;
+}
+
 Reactor::Reactor()
 {
+    static std::once_flag once;
+    std::call_once(once, []{
+                Metrics & metrics = Metrics::getInstance();
+                metrics.RegisterFunc(eMetricType::counter, "libgo_reactor_loops_total",
+                        "Reactor wait loops.", "", []{
+                            double n = 0;
+                            for (auto & stat : GetStats()) n += stat.loops_;
+                            return n;
+                        });
+                metrics.RegisterFunc(eMetricType::counter, "libgo_reactor_events_total",
+                        "Io events returned by the reactors.", "", []{
+                            double n = 0;
+                            for (auto & stat : GetStats()) n += stat.events_;
+                            return n;
+                        });
+                metrics.RegisterFunc(eMetricType::counter, "libgo_reactor_ctls_total",
+                        "epoll_ctl/kevent registrations.", "", []{
+                            double n = 0;
+                            for (auto & stat : GetStats()) n += stat.ctls_;
+                            return n;
+                        });
+                std::pair<eFdType, const char*> types[] = {
+                    {eFdType::eSocket, "type=\"socket\""}, {eFdType::ePipe, "type=\"pipe\""}};
+                for (auto & type : types) {
+                    eFdType fdType = type.first;
+                    metrics.RegisterFunc(eMetricType::gauge, "libgo_fds",
+                            "File descriptors tracked by the hook layer.", type.second, [=]{
+                                return (double)HookHelper::getInstance().GetFdCount(fdType);
+                            });
+                }
+            });
 }
 
 void Reactor::InitLoopThread()
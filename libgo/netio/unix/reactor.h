@@ -14,6 +14,14 @@ public:
 
     static int GetReactorThreadCount();
 
+    // 运行统计
+    struct Stat {
+        uint64_t loops_;    // 等待事件的次数
+        uint64_t events_;   // 收到的事件数
+        uint64_t ctls_;     // 修改关注事件的次数(epoll_ctl/kevent)
+    };
+    static std::vector<Stat> GetStats();
+
 public:
     typedef ReactorElement::Entry Entry;
 
@@ -31,6 +39,11 @@ public:
 protected:
     void InitLoopThread();
 
+    // 统计计数, loops_和events_只由reactor线程写入
+    volatile uint64_t loopCount_ = 0;
+    volatile uint64_t eventCount_ = 0;
+    atomic_t<uint64_t> ctlCount_{0};
+
 private:
     static std::vector<Reactor*> sReactors_;
     static std::atomic<uint8_t> sReactorCount_;
@@ -6,6 +6,44 @@
 
 namespace co {
 
+bool PollWaiter::Match(struct pollfd *fds, nfds_t nfds) const
+{
+    if (fds_.size() != nfds) return false;
+    for (nfds_t i = 0; i < nfds; ++i)
+        if (fds_[i].fd != fds[i].fd || fds_[i].events != fds[i].events)
+            return false;
+    return true;
+}
+
+void PollWaiter::Reset(struct pollfd *fds, nfds_t nfds)
+{
+    fds_.assign(fds, fds + nfds);
+    revents_.assign(nfds, 0);
+    armed_.assign(nfds, 0);
+    disarmed_.clear();
+    ready_.clear();
+    for (nfds_t i = 0; i < nfds; ++i)
+        if (fds[i].fd >= 0)
+            disarmed_.push_back(i);
+}
+
+void PollWaiter::OnTrigger(nfds_t idx, short int revent)
+{
+    std::unique_lock<LFLock> lock(lock_);
+    if (armed_[idx]) {
+        armed_[idx] = 0;
+        disarmed_.push_back(idx);
+    }
+
+    // 不在等待中时也记录事件: 协程正在进入等待时由它自己取走,
+    // 下次poll开始时仍未取走的事件已经过时, 由poll重新检查这个fd
+    if (!revents_[idx])
+        ready_.push_back(idx);
+    revents_[idx] |= revent;
+    if (waiting_)
+        Processer::Wakeup(suspendEntry_);
+}
+
 ReactorElement::ReactorElement(int fd) : fd_(fd)
 {
 }
@@ -113,10 +151,8 @@ void ReactorElement::Trigger(Reactor * reactor, short int pollEvent)
 
 void ReactorElement::TriggerListWithoutLock(short int revent, EntryList & entryList)
 {
-    for (Entry & entry : entryList) {
-        entry.revents_.get()[entry.idx_] = revent;
-        Processer::Wakeup(entry.suspendEntry_);
-    }
+    for (Entry & entry : entryList)
+        entry.waiter_->OnTrigger(entry.idx_, revent);
     entryList.clear();
 }
 
@@ -138,7 +174,7 @@ ReactorElement::EntryList & ReactorElement::SelectList(short int pollEvent)
 void ReactorElement::CheckExpire(EntryList & entryList)
 {
     entryList.erase(std::remove_if(entryList.begin(), entryList.end(), [](Entry & entry){
-                    return entry.suspendEntry_.IsExpire();
+                    return entry.waiter_->retired_.load(std::memory_order_relaxed);
                 }), entryList.end());
 }
 
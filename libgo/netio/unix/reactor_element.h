@@ -1,29 +1,66 @@
 #pragma once
 #include "../../common/config.h"
+#include "../../common/spinlock.h"
 #include "../../scheduler/processer.h"
+#include <poll.h>
 
 namespace co {
 
+// 一次poll在reactor中的注册, 可以被同一个协程之后的poll复用.
+// reactor中的注册是一次性的: 触发后从fd上摘除, 并记录到disarmed_中等待重新注册.
+// 没有触发过的fd一直注册着, 同一个协程连续poll同一组fd时不需要重新注册, 也不需要再检查状态.
+struct PollWaiter
+{
+    LFLock lock_;
+    Processer::SuspendEntry suspendEntry_;  // 正在等待时有效
+    bool waiting_ = false;
+    std::atomic<bool> retired_{false};      // 作废后reactor中残留的注册惰性清理
+
+    std::vector<pollfd> fds_;               // 注册时的fd和events, 用于比较是否是同一组fd
+    std::vector<short int> revents_;        // 收到的事件
+    std::vector<char> armed_;               // 是否注册在reactor中
+    std::vector<nfds_t> disarmed_;          // 需要重新注册的下标
+    std::vector<nfds_t> ready_;             // 收到事件的下标(包括正在进入等待时收到的)
+
+    // 只由所属协程使用, 复用内存
+    std::vector<nfds_t> rearm_;
+    std::vector<pollfd> check_;
+
+    bool Match(struct pollfd *fds, nfds_t nfds) const;
+
+    void Reset(struct pollfd *fds, nfds_t nfds);
+
+    // reactor线程中调用
+    void OnTrigger(nfds_t idx, short int revent);
+};
+typedef std::shared_ptr<PollWaiter> PollWaiterPtr;
+
+// 协程最近一次poll的注册, 协程结束时作废
+struct PollCache
+{
+    PollWaiterPtr waiter_;
+
+    ~PollCache() {
+        if (waiter_) waiter_->retired_ = true;
+    }
+};
+TaskRefDefine(PollCache, PollCache)
+
 class Reactor;
 class ReactorElement
 {
 public:
     struct Entry {
-        Processer::SuspendEntry suspendEntry_;
-        std::shared_ptr<short int> revents_;
-        int idx_;
-
-        Entry() {}
-        Entry(Processer::SuspendEntry const& suspendEntry,
-                std::shared_ptr<short int> const& revents,
-                int idx)
-            : suspendEntry_(suspendEntry), revents_(revents), idx_(idx)
+        PollWaiterPtr waiter_;
+        nfds_t idx_;
+
+        Entry() : idx_(0) {}
+        Entry(PollWaiterPtr const& waiter, nfds_t idx)
+            : waiter_(waiter), idx_(idx)
         {}
 
         friend bool operator==(Entry const& lhs, Entry const& rhs) {
-            return lhs.idx_ == rhs.idx_ &&
-                lhs.revents_ == rhs.revents_ &&
-                lhs.suspendEntry_ == rhs.suspendEntry_;
+            return lhs.idx_ == rhs.idx_ && lhs.waiter_ == rhs.waiter_;
         }
     };
     typedef std::vector<Entry> EntryList;
@@ -53,6 +53,7 @@ void AsyncCoroutinePool::Go()
 void AsyncCoroutinePool::Post(Func const& func, Func const& callback)
 {
     PoolTask task{func, callback};
+    Metrics::Inc(eMetric::async_pool_posts);
     tasks_ << std::move(task);
 }
 bool AsyncCoroutinePool::AddCallbackPoint(AsyncCoroutinePool::CallbackPoint * point)
@@ -58,6 +58,7 @@ public:
     // 获取一个连接
     // 如果池空了并且连接数达到上限, 则会等待
     // 返回的智能指针销毁时, 会自动将连接归还给池
+    // 当前协程设置了截止时间(co::set_deadline)时, 到期仍没有连接则返回空; 被取消(CancelToken)时也返回空
     ConnectionPtr Get(CheckAlive checkAliveOnGet = NULL,
             CheckAlive checkAliveOnPut = NULL)
     {
@@ -77,7 +78,11 @@ retry_get:
         if (connection)
             return Out(connection, checkAliveOnPut);
 
+        Metrics::Inc(eMetric::connection_pool_waits);
         channel_ >> connection;
+        if (!connection)    // 超过了协程的截止时间
+            return ConnectionPtr();
+
         if (checkAliveOnGet && !checkAliveOnGet(connection)) {
             deleter_(connection);
             connection = nullptr;
@@ -115,6 +120,7 @@ retry_get:
         if (connection)
             return Out(connection, checkAliveOnPut);
 
+        Metrics::Inc(eMetric::connection_pool_waits);
         if (channel_.TimedPop(connection, deadline)) {
             if (checkAliveOnGet && !checkAliveOnGet(connection)) {
                 deleter_(connection);
@@ -141,6 +147,7 @@ private:
             return nullptr;
         }
 
+        Metrics::Inc(eMetric::connection_pool_creates);
         return factory_();
     }
 
@@ -0,0 +1,96 @@
+#include "parallel.h"
+
+namespace co
+{
+
+ParallelJob::ParallelJob(Scheduler* sched, std::size_t grain, Body const& body)
+    : sched_(sched), grain_(grain), body_(body)
+{
+}
+
+void ParallelJob::Run(std::size_t n, std::size_t grain, Body const& body)
+{
+    if (!n) return ;
+
+    Scheduler* sched = Processer::GetCurrentScheduler();
+    if (!sched)
+        sched = &Scheduler::getInstance();
+
+    // 自动粒度: 大约每个P分到64块, 既能及时响应空闲的P, 检查空闲的开销也可以忽略
+    if (!grain) {
+        std::size_t procs = (std::max<std::size_t>)(sched->ProcesserCount(), 1);
+        grain = (std::max<std::size_t>)(n / (procs * 64), 1);
+    }
+
+    std::shared_ptr<ParallelJob> job(new ParallelJob(sched, grain, body));
+    Future<void> done = job->done_.get_future();
+    job->RunRange(0, n);
+    job->Finish();
+
+    bool interrupted = false;
+    while (!done.wait()) {
+        // 被截止时间或取消打断: 放弃未执行的区间, 但执行中的区间还在使用body, 要等它们结束
+        interrupted = true;
+        job->stopped_ = true;
+        Processer::StaticCoYield();
+    }
+
+    if (job->error_)
+        std::rethrow_exception(job->error_);
+    if (interrupted)
+        ThrowError(eCoErrorCode::ec_future_interrupted);
+}
+
+void ParallelJob::RunRange(std::size_t begin, std::size_t end)
+{
+    while (begin < end && !stopped_.load(std::memory_order_relaxed)) {
+        // 有没被占用的空闲P时, 后一半交给它
+        std::size_t n = end - begin;
+        if (n > grain_ && queued_.load(std::memory_order_relaxed) < sched_->IdleProcesserCount()) {
+            std::size_t mid = begin + n / 2;
+            if (Spawn(mid, end)) {
+                end = mid;
+                continue;
+            }
+        }
+
+        std::size_t chunkEnd = (std::min)(end, begin + grain_);
+        try {
+            body_(begin, chunkEnd);
+        } catch (...) {
+            std::unique_lock<LFLock> lock(errorLock_);
+            if (!error_)
+                error_ = std::current_exception();
+            stopped_ = true;
+            break;
+        }
+        begin = chunkEnd;
+    }
+}
+
+bool ParallelJob::Spawn(std::size_t begin, std::size_t end)
+{
+    ++pending_;
+    ++queued_;
+
+    auto self = shared_from_this();
+    TaskOpt opt;
+    if (sched_->CreateTaskOnIdle([self, begin, end]{
+                -- self->queued_;
+                self->RunRange(begin, end);
+                self->Finish();
+            }, opt))
+        return true;
+
+    --queued_;
+    --pending_;
+    return false;
+}
+
+void ParallelJob::Finish()
+{
+    if (--pending_ == 0)
+        done_.set_value();
+}
+
+} // namespace co
@@ -0,0 +1,124 @@
+#pragma once
+#include "../common/config.h"
+#include "../common/spinlock.h"
+#include "../scheduler/scheduler.h"
+#include "../sync/future.h"
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace co
+{
+
+/// 并行执行[0, n)上的工作
+// 调用者先在本线程(或本协程)中从头部逐块执行, 每执行完一块检查一次调度器中是否有空闲的P:
+// 有空闲P时把剩余区间对半拆开, 后一半作为新协程直接交给空闲的P, 没有时继续在本地执行.
+// 新协程开始执行后以同样的方式继续拆分. 只在有P空闲时才拆分(惰性拆分),
+// 所有P都忙时不产生额外的协程, 退化为调用者顺序执行.
+//
+// 协程和原生线程中都可以调用: 协程中等待时挂起当前协程, 原生线程中阻塞线程.
+// 在协程中使用当前的调度器, 否则使用g_Scheduler.
+class ParallelJob : public std::enable_shared_from_this<ParallelJob>
+{
+public:
+    // 执行[begin, end)区间
+    typedef std::function<void(std::size_t begin, std::size_t end)> Body;
+
+    // 执行到全部完成. 区间函数抛出的第一个异常在这里重新抛出, 之后未执行的区间被放弃.
+    // 协程的等待被截止时间或取消令牌打断时, 放弃未执行的区间, 等执行中的区间结束后抛出ec_future_interrupted.
+    // @grain: 每块的大小, 也是可拆分的最小区间, 为0时按n和P的数量自动选择
+    static void Run(std::size_t n, std::size_t grain, Body const& body);
+
+private:
+    ParallelJob(Scheduler* sched, std::size_t grain, Body const& body);
+
+    // 执行一个区间, 有空闲P时拆分
+    void RunRange(std::size_t begin, std::size_t end);
+
+    // 把[begin, end)交给空闲的P
+    bool Spawn(std::size_t begin, std::size_t end);
+
+    // 一个区间(调用者的或新协程的)执行结束
+    void Finish();
+
+private:
+    Scheduler* sched_;
+    std::size_t grain_;
+    Body body_;
+
+    // 没有结束的区间数(包括调用者自己执行的区间)
+    std::atomic<std::size_t> pending_{1};
+
+    // 已经交给空闲P还没开始执行的区间数
+    std::atomic<std::size_t> queued_{0};
+
+    std::atomic<bool> stopped_{false};
+    LFLock errorLock_;
+    std::exception_ptr error_;
+
+    Promise<void> done_;
+};
+
+// 对[first, last)中的每个下标i并行调用f(i)
+template <typename Index, typename F>
+void parallel_for(Index first, Index last, F const& f, std::size_t grain = 0)
+{
+    static_assert(std::is_integral<Index>::value, "parallel_for requires an integral index");
+    if (!(first < last)) return ;
+
+    ParallelJob::Run((std::size_t)(last - first), grain,
+            [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i)
+                    f((Index)(first + i));
+            });
+}
+
+// 并行计算out[i] = f(first[i]), 输入输出都是随机访问迭代器, 返回输出的尾后迭代器
+template <typename InIt, typename OutIt, typename F>
+OutIt parallel_transform(InIt first, InIt last, OutIt out, F const& f, std::size_t grain = 0)
+{
+    std::size_t n = std::distance(first, last);
+    if (!n) return out;
+
+    ParallelJob::Run(n, grain,
+            [&](std::size_t begin, std::size_t end) {
+                InIt in = first + begin;
+                OutIt o = out + begin;
+                for (std::size_t i = begin; i < end; ++i, ++in, ++o)
+                    *o = f(*in);
+            });
+    return out + n;
+}
+
+// 并行归约: reduce(... reduce(reduce(identity, map(first)), map(first + 1)) ..., map(last - 1))
+// 每块先从identity开始顺序归约, 再把各块的结果按区间顺序归约, 所以reduce只需要满足结合律.
+template <typename Index, typename T, typename Map, typename Reduce>
+T parallel_reduce(Index first, Index last, T identity, Map const& map, Reduce const& reduce, std::size_t grain = 0)
+{
+    static_assert(std::is_integral<Index>::value, "parallel_reduce requires an integral index");
+    if (!(first < last)) return identity;
+
+    LFLock lock;
+    std::vector<std::pair<std::size_t, T>> partials;
+    ParallelJob::Run((std::size_t)(last - first), grain,
+            [&](std::size_t begin, std::size_t end) {
+                T acc = identity;
+                for (std::size_t i = begin; i < end; ++i)
+                    acc = reduce(std::move(acc), map((Index)(first + i)));
+                std::unique_lock<LFLock> guard(lock);
+                partials.emplace_back(begin, std::move(acc));
+            });
+
+    std::sort(partials.begin(), partials.end(),
+            [](std::pair<std::size_t, T> const& lhs, std::pair<std::size_t, T> const& rhs) {
+                return lhs.first < rhs.first;
+            });
+    T result = std::move(identity);
+    for (auto & kv : partials)
+        result = reduce(std::move(result), std::move(kv.second));
+    return result;
+}
+
+} // namespace co
@@ -0,0 +1,127 @@
+#include "cancel_token.h"
+#include "../common/spinlock.h"
+#include "../common/util.h"
+#include "processer.h"
+#include "ref.h"
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+namespace co
+{
+
+// 登记的协程超过这个数量后, 每增长一倍清理一次已经结束的协程
+static const std::size_t kPruneThreshold = 64;
+
+// 绑定的协程: 协程槽位和协程id(槽位被其他协程复用后id不再相同)
+struct CancelTaskRef
+{
+    TaskSlot* slot_;
+    uint64_t taskId_;
+
+    bool IsAlive() const {
+        return slot_->taskId_.load(std::memory_order_acquire) == taskId_;
+    }
+};
+
+struct CancelToken::State
+{
+    std::atomic<bool> cancelled_{false};
+
+    LFLock lock_;
+    std::vector<CancelTaskRef> tasks_;
+    std::vector<std::weak_ptr<State>> children_;
+    std::size_t pruneMark_ = kPruneThreshold;
+};
+
+CancelToken CancelToken::Create()
+{
+    return CancelToken(std::make_shared<State>());
+}
+
+CancelToken CancelToken::Current()
+{
+    Task* tk = Processer::GetCurrentTask();
+    return tk ? TaskRefCancel(tk) : CancelToken();
+}
+
+void CancelToken::Cancel() const
+{
+    if (!state_) return ;
+    if (state_->cancelled_.exchange(true, std::memory_order_seq_cst))
+        return ;
+
+    std::vector<CancelTaskRef> tasks;
+    std::vector<std::weak_ptr<State>> children;
+    {
+        std::unique_lock<LFLock> lock(state_->lock_);
+        tasks.swap(state_->tasks_);
+        children.swap(state_->children_);
+    }
+
+    // 先设置标记再读挂起序号, 与挂起时先增加序号再检查标记(Processer::Suspend)配对:
+    // 两边至少有一边能看到对方, 不会漏掉正在挂起的协程.
+    // 挂起序号为奇数时协程处于挂起状态, 用这个序号唤醒, 序号已经变化(被唤醒过)则唤醒失败.
+    // 读到序号之后再确认槽位没有被复用, 保证序号属于绑定的协程.
+    for (auto & ref : tasks) {
+        TaskSlot* slot = ref.slot_;
+        uint64_t id = slot->state_.load(std::memory_order_seq_cst);
+        if ((id & 1) == 0) continue;
+        if (!ref.IsAlive()) continue;
+        if (slot->reason_ == eSuspendReason::mutex) continue;
+
+        Processer::Wakeup(Processer::SuspendEntry{ slot, id });
+    }
+
+    for (auto & weak : children) {
+        std::shared_ptr<State> child = weak.lock();
+        if (child)
+            CancelToken(child).Cancel();
+    }
+}
+
+bool CancelToken::IsCancelled() const
+{
+    return state_ && state_->cancelled_.load(std::memory_order_seq_cst);
+}
+
+CancelToken CancelToken::Child() const
+{
+    CancelToken child = Create();
+    if (!state_) return child;
+
+    std::unique_lock<LFLock> lock(state_->lock_);
+    if (state_->cancelled_) {
+        child.state_->cancelled_ = true;
+        return child;
+    }
+
+    auto & children = state_->children_;
+    if (children.size() >= kPruneThreshold && children.size() >= children.capacity()) {
+        children.erase(std::remove_if(children.begin(), children.end(),
+                    [](std::weak_ptr<State> const& w){ return w.expired(); }),
+                children.end());
+    }
+    children.push_back(child.state_);
+    return child;
+}
+
+void CancelToken::Attach(Task* tk) const
+{
+    TaskRefCancel(tk) = *this;
+    if (!state_ || !tk->slot_) return ;
+
+    std::unique_lock<LFLock> lock(state_->lock_);
+    if (state_->cancelled_) return ;
+
+    auto & tasks = state_->tasks_;
+    if (tasks.size() >= state_->pruneMark_) {
+        tasks.erase(std::remove_if(tasks.begin(), tasks.end(),
+                    [](CancelTaskRef const& ref){ return !ref.IsAlive(); }),
+                tasks.end());
+        state_->pruneMark_ = (std::max)(kPruneThreshold, tasks.size() * 2);
+    }
+    tasks.push_back(CancelTaskRef{ tk->slot_, tk->id_ });
+}
+
+} // namespace co
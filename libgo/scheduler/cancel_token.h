@@ -0,0 +1,53 @@
+#pragma once
+#include "../common/config.h"
+#include <memory>
+
+namespace co
+{
+
+struct Task;
+
+// 取消令牌
+// 协程创建时绑定(co_cancel), 任意线程调用Cancel后, 绑定的协程正在进行的挂起立即被唤醒,
+// 各个阻塞操作返回取消: hook的IO、sleep返回-1(errno=ECANCELED), Channel的读写、ConnectionPool::Get返回失败,
+// ConditionVariableAny返回cv_status::timeout. 之后再挂起也会立即返回, 互斥锁除外.
+//
+// 令牌可以派生子令牌(Child): 取消父令牌时子令牌一起取消, 取消子令牌不影响父令牌.
+// 一组协程绑定同一个令牌(或co_inherit_cancel继承当前协程的令牌)即可整组取消.
+class CancelToken
+{
+public:
+    struct State;
+
+    // 空令牌, 不能取消
+    CancelToken() = default;
+
+    static CancelToken Create();
+
+    // 当前协程绑定的令牌, 不在协程中或没有绑定时返回空令牌
+    static CancelToken Current();
+
+    // 取消, 可以重复调用
+    void Cancel() const;
+
+    bool IsCancelled() const;
+
+    // 派生子令牌, 父令牌已经取消时子令牌创建后即为取消状态
+    CancelToken Child() const;
+
+    explicit operator bool() const { return !!state_; }
+
+    friend bool operator==(CancelToken const& lhs, CancelToken const& rhs) {
+        return lhs.state_ == rhs.state_;
+    }
+
+    // 绑定协程(创建协程时由调度器调用)
+    void Attach(Task* tk) const;
+
+private:
+    explicit CancelToken(std::shared_ptr<State> const& state) : state_(state) {}
+
+    std::shared_ptr<State> state_;
+};
+
+} // namespace co
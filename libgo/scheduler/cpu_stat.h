@@ -0,0 +1,107 @@
+#pragma once
+#include "../common/config.h"
+#include "../common/util.h"
+#include "../common/clock.h"
+
+namespace co
+{
+
+// 协程的CPU时间
+struct TaskCpuInfo
+{
+    uint64_t id_;
+    SourceLocation location_;
+
+    // 累计运行时间(纳秒), 包括正在运行中的这一次
+    uint64_t cpuNs_;
+
+    // 切出次数
+    uint64_t yieldCount_;
+
+    // 是否正在运行
+    bool running_;
+};
+
+// 按go语句位置聚合的CPU时间
+struct LocationCpuInfo
+{
+    SourceLocation location_;
+
+    // 累计运行时间(纳秒)
+    uint64_t cpuNs_;
+
+    // 最近一个滑动窗口(LocationCpuStat::kWindowMs)内的运行时间(纳秒)
+    uint64_t windowCpuNs_;
+
+    // 被调度执行的次数
+    uint64_t switchCount_;
+};
+
+// 单个go语句位置的CPU时间统计
+// 由所属P的线程写入, 滑动窗口由kSlots个时间片组成, 按rdtsc换算的时间片编号轮转.
+struct LocationCpuStat
+{
+    static const int kSlots = 10;
+    static const int kSlotMs = 100;
+    static const int kWindowMs = kSlots * kSlotMs;
+
+    uint64_t cycles_ = 0;
+    uint64_t switchCount_ = 0;
+    uint64_t slotEpoch_[kSlots] = {};
+    uint64_t slotCycles_[kSlots] = {};
+
+    ALWAYS_INLINE void Add(uint64_t cycles, uint64_t epoch)
+    {
+        cycles_ += cycles;
+        ++switchCount_;
+        int idx = epoch % kSlots;
+        if (slotEpoch_[idx] != epoch) {
+            slotEpoch_[idx] = epoch;
+            slotCycles_[idx] = 0;
+        }
+        slotCycles_[idx] += cycles;
+    }
+
+    uint64_t WindowCycles(uint64_t epoch) const
+    {
+        uint64_t cycles = 0;
+        for (int i = 0; i < kSlots; ++i)
+            if (epoch - slotEpoch_[i] < (uint64_t)kSlots)
+                cycles += slotCycles_[i];
+        return cycles;
+    }
+
+    // rdtsc对应的时间片编号
+    static uint64_t Epoch(uint64_t tsc)
+    {
+        static double cyclesPerSlot = FastSteadyClock::CyclesPerNanosecond() * kSlotMs * 1000000;
+        return (uint64_t)(tsc / cyclesPerSlot);
+    }
+};
+
+// 以文件名指针和行号作为key, 合并同名文件的工作留给汇总时做
+struct SourceLocationPtrHash
+{
+    std::size_t operator()(SourceLocation const& loc) const
+    {
+        return std::hash<const void*>()(loc.file_) ^ ((std::size_t)loc.lineno_ << 1);
+    }
+};
+
+struct SourceLocationPtrEqual
+{
+    bool operator()(SourceLocation const& lhs, SourceLocation const& rhs) const
+    {
+        return lhs.file_ == rhs.file_ && lhs.lineno_ == rhs.lineno_;
+    }
+};
+
+typedef std::unordered_map<SourceLocation, LocationCpuStat,
+        SourceLocationPtrHash, SourceLocationPtrEqual> LocationCpuStatMap;
+
+ALWAYS_INLINE uint64_t CyclesToNanoseconds(uint64_t cycles)
+{
+    return (uint64_t)(cycles / FastSteadyClock::CyclesPerNanosecond());
+}
+
+} // namespace co
@@ -0,0 +1,214 @@
+#include "cpu_topology.h"
+#include <fstream>
+#include <sstream>
+#include <dirent.h>
+#if defined(LIBGO_SYS_Linux)
+#include <sched.h>
+#include <pthread.h>
+#endif
+
+namespace co
+{
+
+static bool ReadFile(std::string const& path, std::string & out)
+{
+    std::ifstream ifs(path);
+    if (!ifs) return false;
+    std::getline(ifs, out);
+    return true;
+}
+
+static int MinCpu(std::vector<int> const& cpus, int def)
+{
+    return cpus.empty() ? def : *std::min_element(cpus.begin(), cpus.end());
+}
+
+std::vector<int> CpuTopology::ParseCpuList(std::string const& s)
+{
+    std::vector<int> cpus;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        int first, last;
+        int n = sscanf(item.c_str(), "%d-%d", &first, &last);
+        if (n < 1) continue;
+        if (n == 1) last = first;
+        for (int i = first; i <= last; ++i)
+            cpus.push_back(i);
+    }
+    return cpus;
+}
+
+// 目录下的cpuN
+static std::vector<int> ListCpuDirs(std::string const& root)
+{
+    std::vector<int> cpus;
+    DIR* dir = opendir(root.c_str());
+    if (!dir) return cpus;
+    while (struct dirent* ent = readdir(dir)) {
+        int id;
+        char tail;
+        if (sscanf(ent->d_name, "cpu%d%c", &id, &tail) == 1)
+            cpus.push_back(id);
+    }
+    closedir(dir);
+    std::sort(cpus.begin(), cpus.end());
+    return cpus;
+}
+
+// cpuN目录下的nodeM链接
+static int FindNode(std::string const& cpuDir)
+{
+    int node = 0;
+    DIR* dir = opendir(cpuDir.c_str());
+    if (!dir) return node;
+    while (struct dirent* ent = readdir(dir)) {
+        int id;
+        char tail;
+        if (sscanf(ent->d_name, "node%d%c", &id, &tail) == 1) {
+            node = id;
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+// 级别最高的缓存(LLC)的共享CPU列表
+static std::vector<int> FindLLCShared(std::string const& cpuDir)
+{
+    std::vector<int> shared;
+    int maxLevel = -1;
+    for (int i = 0; ; ++i) {
+        std::string indexDir = cpuDir + "/cache/index" + std::to_string(i);
+        std::string level, list;
+        if (!ReadFile(indexDir + "/level", level)) break;
+        if (!ReadFile(indexDir + "/shared_cpu_list", list)) continue;
+        int lv = atoi(level.c_str());
+        if (lv > maxLevel) {
+            maxLevel = lv;
+            shared = CpuTopology::ParseCpuList(list);
+        }
+    }
+    return shared;
+}
+
+CpuTopology CpuTopology::Load(std::string const& root, std::vector<int> const& cpuset)
+{
+    std::vector<int> ids;
+    std::string online;
+    if (ReadFile(root + "/online", online))
+        ids = ParseCpuList(online);
+    else
+        ids = ListCpuDirs(root);
+
+    if (!cpuset.empty()) {
+        std::vector<int> filtered;
+        for (int id : ids)
+            if (std::find(cpuset.begin(), cpuset.end(), id) != cpuset.end())
+                filtered.push_back(id);
+        ids.swap(filtered);
+    }
+
+    CpuTopology topo;
+    std::map<int, int> nodeFirstCpu;
+    for (int id : ids) {
+        std::string cpuDir = root + "/cpu" + std::to_string(id);
+        Cpu cpu;
+        cpu.id_ = id;
+
+        std::string siblings;
+        if (ReadFile(cpuDir + "/topology/thread_siblings_list", siblings) ||
+                ReadFile(cpuDir + "/topology/core_cpus_list", siblings))
+            cpu.core_ = MinCpu(ParseCpuList(siblings), id);
+        else
+            cpu.core_ = id;
+
+        cpu.llc_ = MinCpu(FindLLCShared(cpuDir), -1);
+        cpu.node_ = FindNode(cpuDir);
+        if (!nodeFirstCpu.count(cpu.node_))
+            nodeFirstCpu[cpu.node_] = id;
+        topo.cpus_.push_back(cpu);
+    }
+
+    // 没有缓存信息时把整个节点视为共享LLC
+    for (Cpu & cpu : topo.cpus_)
+        if (cpu.llc_ < 0)
+            cpu.llc_ = nodeFirstCpu[cpu.node_];
+
+    std::sort(topo.cpus_.begin(), topo.cpus_.end(), [](Cpu const& a, Cpu const& b) {
+            if (a.node_ != b.node_) return a.node_ < b.node_;
+            if (a.llc_ != b.llc_) return a.llc_ < b.llc_;
+            if (a.core_ != b.core_) return a.core_ < b.core_;
+            return a.id_ < b.id_;
+        });
+    return topo;
+}
+
+std::vector<int> CpuTopology::GetProcessCpuset()
+{
+    std::vector<int> cpus;
+#if defined(LIBGO_SYS_Linux)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int i = 0; i < CPU_SETSIZE; ++i)
+            if (CPU_ISSET(i, &set))
+                cpus.push_back(i);
+    }
+#endif
+    return cpus;
+}
+
+bool CpuTopology::BindCurrentThread(int cpu)
+{
+#if defined(LIBGO_SYS_Linux)
+    if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+CpuTopology::Cpu const* CpuTopology::Find(int cpu) const
+{
+    for (Cpu const& c : cpus_)
+        if (c.id_ == cpu)
+            return &c;
+    return nullptr;
+}
+
+CpuTopology::eDistance CpuTopology::Distance(int cpuA, int cpuB) const
+{
+    if (cpuA == cpuB) return same_cpu;
+    Cpu const* a = Find(cpuA);
+    Cpu const* b = Find(cpuB);
+    if (!a || !b) return remote;
+    if (a->core_ == b->core_) return same_core;
+    if (a->llc_ == b->llc_) return same_llc;
+    if (a->node_ == b->node_) return same_node;
+    return remote;
+}
+
+int CpuTopology::NodeCount() const
+{
+    std::set<int> nodes;
+    for (Cpu const& c : cpus_)
+        nodes.insert(c.node_);
+    return (int)nodes.size();
+}
+
+std::string CpuTopology::ToString() const
+{
+    std::string s;
+    for (Cpu const& c : cpus_) {
+        s += Format("cpu%d core=%d llc=%d node=%d\n", c.id_, c.core_, c.llc_, c.node_);
+    }
+    return s;
+}
+
+} // namespace co
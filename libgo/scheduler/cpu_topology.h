@@ -0,0 +1,66 @@
+#pragma once
+#include "../common/config.h"
+
+namespace co
+{
+
+// CPU拓扑
+// 从sysfs(/sys/devices/system/cpu)读取每个逻辑CPU所属的物理核、最后一级缓存(LLC)和NUMA节点,
+// 用于把P绑定到CPU上, 以及按拓扑由近到远地偷协程.
+// 读取的目录可以替换成模拟的拓扑(格式与sysfs相同), 便于在单节点的机器上测试.
+class CpuTopology
+{
+public:
+    // 两个CPU之间的距离
+    enum eDistance {
+        same_cpu = 0,
+        same_core = 1,
+        same_llc = 2,
+        same_node = 3,
+        remote = 4,
+    };
+
+    struct Cpu
+    {
+        int id_ = -1;
+        int core_ = -1;     // 同一物理核的超线程中最小的CPU编号
+        int llc_ = -1;      // 共享最后一级缓存的CPU中最小的CPU编号
+        int node_ = 0;      // NUMA节点编号
+    };
+
+    // 系统的CPU拓扑目录
+    static const char* SysfsRoot() { return "/sys/devices/system/cpu"; }
+
+    // 读取sysfs格式的拓扑目录
+    // @cpuset: 非空时只保留其中的CPU(例如当前进程的cpuset)
+    // 目录不存在时返回空的拓扑; 缺少节点或缓存信息时视为单节点、整个节点共享LLC.
+    static CpuTopology Load(std::string const& root, std::vector<int> const& cpuset = std::vector<int>());
+
+    // 当前进程可以使用的CPU(sched_getaffinity)
+    static std::vector<int> GetProcessCpuset();
+
+    // 把当前线程绑定到指定的CPU
+    static bool BindCurrentThread(int cpu);
+
+    // 解析"0-3,8,10-11"格式的CPU列表
+    static std::vector<int> ParseCpuList(std::string const& s);
+
+    // 按节点、LLC、物理核排序后的CPU列表, 依次分配给P可以让相邻的P共享缓存
+    std::vector<Cpu> const& Cpus() const { return cpus_; }
+
+    bool Empty() const { return cpus_.empty(); }
+
+    // 查找CPU, 不存在时返回nullptr
+    Cpu const* Find(int cpu) const;
+
+    eDistance Distance(int cpuA, int cpuB) const;
+
+    int NodeCount() const;
+
+    std::string ToString() const;
+
+private:
+    std::vector<Cpu> cpus_;
+};
+
+} // namespace co
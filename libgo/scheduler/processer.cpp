@@ -2,6 +2,7 @@
 #include "scheduler.h"
 #include "../common/error.h"
 #include "../common/clock.h"
+#include "../debug/tracer.h"
 #include <assert.h>
 #include "ref.h"
 
@@ -29,7 +30,17 @@ Scheduler* Processer::GetCurrentScheduler()
 void Processer::AddTask(Task *tk)
 {
     DebugPrint(dbg_task | dbg_scheduler, "task(%s) add into proc(%u)(%p)", tk->DebugInfo(), id_, (void*)this);
-    newQueue_.push(tk);
+    {
+        std::unique_lock<TaskQueue::lock_t> lock(newQueue_.LockRef());
+        if (UNLIKELY(retired_)) {
+            lock.unlock();
+            scheduler_->SelectProcesser(this)->AddTask(tk);
+            return;
+        }
+        newQueue_.pushWithoutLock(tk);
+        if (tk->priority_ < newMinPriority_)
+            newMinPriority_ = tk->priority_;
+    }
     newQueue_.AssertLink();
 
     OnAddTask();
@@ -38,7 +49,26 @@ void Processer::AddTask(Task *tk)
 void Processer::AddTask(SList<Task> && slist)
 {
     DebugPrint(dbg_scheduler, "task(num=%d) add into proc(%u)", (int)slist.size(), id_);
-    newQueue_.push(std::move(slist));
+    uint8_t minPriority = priority_count;
+    for (TSQueueHook* pos = slist.head(); pos; pos = pos->next) {
+        Task* tk = (Task*)pos;
+        minPriority = (std::min)(minPriority, tk->priority_);
+
+        // 偷来的亲和组归本P所有, 同组的新协程和被唤醒的协程随后也会加入本P
+        if (UNLIKELY(tk->affinityKey_) && !retired_)
+            scheduler_->AffinitySlot(tk->affinityKey_).store(this, std::memory_order_relaxed);
+    }
+    {
+        std::unique_lock<TaskQueue::lock_t> lock(newQueue_.LockRef());
+        if (UNLIKELY(retired_)) {
+            lock.unlock();
+            scheduler_->SelectProcesser(this)->AddTask(std::move(slist));
+            return;
+        }
+        newQueue_.pushWithoutLock(std::move(slist));
+        if (minPriority < newMinPriority_)
+            newMinPriority_ = minPriority;
+    }
     newQueue_.AssertLink();
 
     OnAddTask();
@@ -55,33 +85,78 @@ void Processer::OnAddTask()
 void Processer::Process()
 {
     GetCurrentProcesser() = this;
+#if defined(LIBGO_SYS_Unix)
+    nativeThread_ = pthread_self();
+#endif
+    metrics_ = &Metrics::LocalShard();
+    running_ = true;
 
     bool & isStop = *stop_;
+    int64_t idleSince = 0;
 
     while (!isStop)
     {
-        runnableQueue_.front(runningTask_);
-
-        if (!runningTask_) {
-            if (AddNewTasks())
-                runnableQueue_.front(runningTask_);
+        SchedulingGroup::Refresh();
+        preemptCycles_ = (uint64_t)(CoroutineOptions::getInstance().preempt_timeslice_us * 1000.0
+                * FastSteadyClock::CyclesPerNanosecond());
+
+        int prio = SelectPriority();
+        if (newMinPriority_ < prio) {
+            AddNewTasks();
+            prio = SelectPriority();
+        }
 
-            if (!runningTask_) {
+        if (prio == priority_count) {
+            lastRoundCycles_ = 0;
+            if (deferredMask_) {
+                // 剩下的协程都因配额被推迟, 等待配额周期刷新
+                WaitCondition(1);
+                deferredMask_ = 0;
+            } else {
                 WaitCondition();
-                AddNewTasks();
-                continue;
             }
+            AddNewTasks();
+
+            // 空闲太久的多余线程退出
+            int64_t now = NowMicrosecond();
+            if (!idleSince)
+                idleSince = now;
+            else if (scheduler_->TryRetire(this, now - idleSince))
+                break;
+            continue;
         }
+        idleSince = 0;
+
+        curPriority_ = prio;
+        TaskQueue & runnableQueue = runnableQueues_[prio];
+        runnableQueue.front(runningTask_);
+        if (!runningTask_)
+            continue;
 
 #if ENABLE_DEBUGGER
         DebugPrint(dbg_scheduler, "Run [Proc(%d) QueueSize:%lu] --------------------------", id_, RunnableSize());
 #endif
 
         addNewQuota_ = 1;
+        roundStartTsc_ = FastSteadyClock::rdtsc();
+        uint32_t ran = 0, deferred = 0;
         while (runningTask_ && !isStop) {
             runningTask_->state_ = TaskState::runnable;
             runningTask_->proc_ = this;
 
+            // 所属调度组超出配额或权重, 本轮跳过
+            if (UNLIKELY(runningTask_->group_) &&
+                    !runningTask_->group_->Admit(FastSteadyClock::rdtsc(), enforceWeight_))
+            {
+                ++deferred;
+                std::unique_lock<TaskQueue::lock_t> lock(runnableQueue.LockRef());
+                runningTask_ = (Task*)runningTask_->next;
+                if (runningTask_)
+                    runningTask_->check_ = runnableQueue.check_;
+                continue;
+            }
+            ++ran;
+
 #if ENABLE_DEBUGGER
             DebugPrint(dbg_switch, "enter task(%s)", runningTask_->DebugInfo());
             if (Listener::GetTaskListener())
@@ -89,8 +164,33 @@ void Processer::Process()
 #endif
 
             ++switchCount_;
+            metrics_->Add((int)eMetric::task_switches, 1);
+
+            Tracer::Trace(eTraceEvent::swap_in, runningTask_->id_);
+
+            swapInTsc_ = FastSteadyClock::rdtsc();
+            if (UNLIKELY(runningTask_->wakeupTsc_))
+                OnWakeupSwapIn(runningTask_, swapInTsc_);
+
+            if (UNLIKELY(runningTask_->light_)) {
+                runningLight_ = true;
+                runningTask_->Execute();
+                runningLight_ = false;
+            } else
+                runningTask_->SwapIn();
+
+            {
+                uint64_t tsc = FastSteadyClock::rdtsc();
+                uint64_t cycles = tsc - swapInTsc_;
+                swapInTsc_ = 0;
+                runningTask_->cpuCycles_ += cycles;
+                if (UNLIKELY(runningTask_->group_))
+                    runningTask_->group_->AddRuntime(cycles);
+                if (UNLIKELY(CoroutineOptions::getInstance().enable_coro_stat))
+                    AddCpuStat(runningTask_, cycles, tsc);
+            }
 
-            runningTask_->SwapIn();
+            Tracer::Trace(eTraceEvent::swap_out, runningTask_->id_, (uint32_t)runningTask_->state_);
 
 #if ENABLE_DEBUGGER
             DebugPrint(dbg_switch, "leave task(%s) state=%d", runningTask_->DebugInfo(), (int)runningTask_->state_);
@@ -99,11 +199,11 @@ void Processer::Process()
             switch (runningTask_->state_) {
                 case TaskState::runnable:
                     {
-                        std::unique_lock<TaskQueue::lock_t> lock(runnableQueue_.LockRef());
+                        std::unique_lock<TaskQueue::lock_t> lock(runnableQueue.LockRef());
                         auto next = (Task*)runningTask_->next;
                         if (next) {
                             runningTask_ = next;
-                            runningTask_->check_ = runnableQueue_.check_;
+                            runningTask_->check_ = runnableQueue.check_;
                             break;
                         }
 
@@ -112,10 +212,10 @@ void Processer::Process()
                         } else {
                             lock.unlock();
                             if (AddNewTasks()) {
-                                runnableQueue_.next(runningTask_, runningTask_);
+                                runnableQueue.next(runningTask_, runningTask_);
                                 -- addNewQuota_;
                             } else {
-                                std::unique_lock<TaskQueue::lock_t> lock2(runnableQueue_.LockRef());
+                                std::unique_lock<TaskQueue::lock_t> lock2(runnableQueue.LockRef());
                                 runningTask_ = nullptr;
                             }
                         }
@@ -125,7 +225,7 @@ void Processer::Process()
 
                 case TaskState::block:
                     {
-                        std::unique_lock<TaskQueue::lock_t> lock(runnableQueue_.LockRef());
+                        std::unique_lock<TaskQueue::lock_t> lock(runnableQueue.LockRef());
                         runningTask_ = nextTask_;
                         nextTask_ = nullptr;
                     }
@@ -134,16 +234,17 @@ void Processer::Process()
                 case TaskState::done:
                 default:
                     {
-                        runnableQueue_.next(runningTask_, nextTask_);
+                        runnableQueue.next(runningTask_, nextTask_);
                         if (!nextTask_ && addNewQuota_ > 0) {
                             if (AddNewTasks()) {
-                                runnableQueue_.next(runningTask_, nextTask_);
+                                runnableQueue.next(runningTask_, nextTask_);
                                 -- addNewQuota_;
                             }
                         }
 
                         DebugPrint(dbg_task, "task(%s) done.", runningTask_->DebugInfo());
-                        runnableQueue_.erase(runningTask_);
+                        metrics_->Add((int)eMetric::tasks_finished, 1);
+                        runnableQueue.erase(runningTask_);
                         if (gcQueue_.size() > 16)
                             GC();
                         gcQueue_.push(runningTask_);
@@ -152,20 +253,49 @@ void Processer::Process()
                             std::rethrow_exception(ep);
                         }
 
-                        std::unique_lock<TaskQueue::lock_t> lock(runnableQueue_.LockRef());
+                        std::unique_lock<TaskQueue::lock_t> lock(runnableQueue.LockRef());
                         runningTask_ = nextTask_;
                         nextTask_ = nullptr;
                     }
                     break;
             }
+
+            // 有更优先的协程等待执行, 结束本轮(饥饿保护选中的一轮除外).
+            // 轮转队列使下一轮从runningTask_开始, 保证同一队列内的协程仍然轮流执行.
+            if (runningTask_ && !starvationRound_ && UNLIKELY(HasHigherPriority(curPriority_))) {
+                std::unique_lock<TaskQueue::lock_t> lock(runnableQueue.LockRef());
+                if (runningTask_->check_ == runnableQueue.check_)
+                    runnableQueue.rotateWithoutLock(runningTask_);
+                runningTask_ = nullptr;
+            }
+        }
+
+        lastRoundCycles_ = FastSteadyClock::rdtsc() - roundStartTsc_;
+        roundStartTsc_ = 0;
+
+        // 整轮都没有执行协程: 先取消权重限制重试一轮, 仍然都被推迟说明是配额不足
+        if (UNLIKELY(deferred) && !ran) {
+            if (enforceWeight_) {
+                enforceWeight_ = false;
+            } else {
+                deferredMask_ |= 1u << prio;
+                deferredEpoch_ = SchedulingGroup::Epoch();
+            }
+        } else if (ran) {
+            enforceWeight_ = true;
         }
     }
+
+    running_ = false;
 }
 
 Task* Processer::GetCurrentTask()
 {
     auto proc = GetCurrentProcesser();
-    return proc ? proc->runningTask_ : nullptr;
+    Task* tk = proc ? proc->runningTask_ : nullptr;
+
+    // 轻量任务在P的线程栈上执行, 对外表现为原生线程
+    return (tk && !tk->light_) ? tk : nullptr;
 }
 
 bool Processer::IsCoroutine()
@@ -173,9 +303,21 @@ bool Processer::IsCoroutine()
     return !!GetCurrentTask();
 }
 
+void Processer::OnBlockInLight(const char* what)
+{
+    Processer* proc = GetCurrentProcesser();
+    fprintf(stderr, "libgo: light task(%s) calls blocking %s, which blocks the processer(%d) thread. "
+            "Light tasks must not block, use go instead of go_fn/post.\n",
+            proc->runningTask_->DebugInfo(), what, proc->id_);
+    assert(!"light task must not block");
+}
+
 std::size_t Processer::RunnableSize()
 {
-    return runnableQueue_.size() + newQueue_.size();
+    std::size_t n = newQueue_.size();
+    for (int i = 0; i < priority_count; ++i)
+        n += runnableQueues_[i].size();
+    return n;
 }
 
 void Processer::NotifyCondition()
@@ -183,35 +325,109 @@ void Processer::NotifyCondition()
     cv_.notify_all();
 }
 
-void Processer::WaitCondition()
+void Processer::WaitCondition(int timeoutMs)
 {
     GC();
     std::unique_lock<std::mutex> lock(cvMutex_);
     waiting_ = true;
-    cv_.wait_for(lock, std::chrono::milliseconds(100));
+    cv_.wait_for(lock, std::chrono::milliseconds(timeoutMs));
     waiting_ = false;
 }
 
 void Processer::GC()
 {
+    // 释放创建时的引用计数
     auto list = gcQueue_.pop_all();
-    for (Task & tk : list) {
-        tk.DecrementRef();
-    }
-    list.clear();
+    while (Task* tk = list.pop_front())
+        tk->DecrementRef();
 }
 
 bool Processer::AddNewTasks()
 {
     if (newQueue_.emptyUnsafe()) return false;
 
-    runnableQueue_.push(newQueue_.pop_all());
+    SList<Task> slist;
+    {
+        std::unique_lock<TaskQueue::lock_t> lock(newQueue_.LockRef());
+        slist = newQueue_.pop_allWithoutLock();
+        newMinPriority_ = priority_count;
+    }
     newQueue_.AssertLink();
+    PushRunnable(std::move(slist));
     return true;
 }
 
+void Processer::PushRunnable(SList<Task> && slist)
+{
+    if (slist.empty()) return ;
+
+    // 通常所有协程的优先级相同, 整体加入
+    uint8_t prio = ((Task*)slist.head())->priority_;
+    bool uniform = true;
+    for (TSQueueHook* pos = slist.head(); pos; pos = pos->next) {
+        if (((Task*)pos)->priority_ != prio) {
+            uniform = false;
+            break;
+        }
+    }
+
+    if (uniform) {
+        runnableQueues_[prio].push(std::move(slist));
+        return ;
+    }
+
+    SList<Task> lists[priority_count];
+    while (Task* tk = slist.pop_front())
+        lists[tk->priority_].push_back(tk);
+    for (int i = 0; i < priority_count; ++i)
+        runnableQueues_[i].push(std::move(lists[i]));
+}
+
+int Processer::SelectPriority()
+{
+    starvationRound_ = false;
+    if (UNLIKELY(deferredMask_) && deferredEpoch_ != SchedulingGroup::Epoch())
+        deferredMask_ = 0;
+
+    int prio = 0;
+    while (prio < priority_count && !IsSchedulable(prio))
+        ++prio;
+    if (prio == priority_count) return prio;
+
+    // 饥饿保护: 低优先级队列连续被跳过limit轮后调度它一轮
+    uint32_t limit = CoroutineOptions::getInstance().priority_starvation_limit;
+    if (limit) {
+        for (int i = priority_count - 1; i > prio; --i) {
+            if (!IsSchedulable(i)) {
+                skipped_[i] = 0;
+                continue;
+            }
+
+            if (++skipped_[i] >= limit) {
+                skipped_[i] = 0;
+                starvationRound_ = true;
+                return i;
+            }
+        }
+    }
+
+    skipped_[prio] = 0;
+    return prio;
+}
+
+bool Processer::HasHigherPriority(int prio)
+{
+    if (newMinPriority_ < prio) return true;
+    for (int i = 0; i < prio; ++i)
+        if (IsSchedulable(i))
+            return true;
+    return false;
+}
+
 bool Processer::IsBlocking()
 {
+    // 没有在执行协程(空闲)时不算阻塞, 否则空闲的P会因为残留的标记被当成阻塞
+    if (!swapInTsc_) return false;
     if (!markSwitch_ || markSwitch_ != switchCount_) return false;
     return NowMicrosecond() > markTick_ + CoroutineOptions::getInstance().cycle_timeout_us;
 }
@@ -229,145 +445,377 @@ int64_t Processer::NowMicrosecond()
     return std::chrono::duration_cast<std::chrono::microseconds>(FastSteadyClock::now().time_since_epoch()).count();
 }
 
+void Processer::OnWakeupSwapIn(Task* tk, uint64_t tsc)
+{
+    double cyclesPerNs = FastSteadyClock::CyclesPerNanosecond();
+    if (tsc > tk->wakeupTsc_)
+        runQueueLatency_.Record((uint64_t)((tsc - tk->wakeupTsc_) / cyclesPerNs));
+    if (tk->suspendTsc_ && tk->wakeupTsc_ > tk->suspendTsc_)
+        waitTime_[(int)tk->suspendReason_].Record((uint64_t)((tk->wakeupTsc_ - tk->suspendTsc_) / cyclesPerNs));
+    tk->wakeupTsc_ = tk->suspendTsc_ = 0;
+}
+
+void Processer::AddCpuStat(Task* tk, uint64_t cycles, uint64_t tsc)
+{
+    std::unique_lock<LFLock> lock(cpuStatLock_);
+    cpuStats_[TaskRefLocation(tk)].Add(cycles, LocationCpuStat::Epoch(tsc));
+}
+
+void Processer::CollectTaskCpuInfo(std::vector<TaskCpuInfo> & out)
+{
+    auto collect = [&](TaskQueue & queue) {
+        std::unique_lock<TaskQueue::lock_t> lock(queue.LockRef());
+        for (TSQueueHook* pos = queue.head_->next; pos; pos = pos->next) {
+            Task* tk = (Task*)pos;
+            TaskCpuInfo info;
+            info.id_ = tk->id_;
+            info.location_ = TaskRefLocation(tk);
+            info.yieldCount_ = tk->yieldCount_;
+            info.running_ = false;
+
+            uint64_t cycles = tk->cpuCycles_;
+            if (tk == runningTask_) {
+                uint64_t swapInTsc = swapInTsc_;
+                if (swapInTsc) {
+                    cycles += FastSteadyClock::rdtsc() - swapInTsc;
+                    info.running_ = true;
+                }
+            }
+            info.cpuNs_ = CyclesToNanoseconds(cycles);
+            out.push_back(info);
+        }
+    };
+
+    for (int i = 0; i < priority_count; ++i)
+        collect(runnableQueues_[i]);
+    collect(waitQueue_);
+    collect(newQueue_);
+}
+
+void Processer::CollectLocationCpuInfo(std::map<SourceLocation, LocationCpuInfo> & out)
+{
+    uint64_t epoch = LocationCpuStat::Epoch(FastSteadyClock::rdtsc());
+    std::unique_lock<LFLock> lock(cpuStatLock_);
+    for (auto & kv : cpuStats_) {
+        auto it = out.find(kv.first);
+        if (it == out.end()) {
+            LocationCpuInfo info;
+            info.location_ = kv.first;
+            info.cpuNs_ = info.windowCpuNs_ = info.switchCount_ = 0;
+            it = out.insert(std::make_pair(kv.first, info)).first;
+        }
+
+        LocationCpuInfo & info = it->second;
+        info.cpuNs_ += CyclesToNanoseconds(kv.second.cycles_);
+        info.windowCpuNs_ += CyclesToNanoseconds(kv.second.WindowCycles(epoch));
+        info.switchCount_ += kv.second.switchCount_;
+    }
+}
+
 SList<Task> Processer::Steal(std::size_t n)
 {
-    if (n > 0) {
-        // steal some
-        newQueue_.AssertLink();
-        auto slist = newQueue_.pop_back(n);
-        newQueue_.AssertLink();
-        if (slist.size() >= n)
-            return slist;
+    // n为0时全部偷走
+    // 先偷新加入的协程
+    newQueue_.AssertLink();
+    auto slist = n > 0 ? newQueue_.pop_back(n) : newQueue_.pop_all();
+    newQueue_.AssertLink();
 
-        std::unique_lock<TaskQueue::lock_t> lock(runnableQueue_.LockRef());
-        bool pushRunningTask = false, pushNextTask = false;
-        if (runningTask_)
-            pushRunningTask = runnableQueue_.eraseWithoutLock(runningTask_, true) || slist.erase(runningTask_, newQueue_.check_);
-        if (nextTask_)
-            pushNextTask = runnableQueue_.eraseWithoutLock(nextTask_, true) || slist.erase(nextTask_, newQueue_.check_);
-        auto slist2 = runnableQueue_.pop_backWithoutLock(n - slist.size());
-        if (pushRunningTask)
-            runnableQueue_.pushWithoutLock(runningTask_);
-        if (pushNextTask)
-            runnableQueue_.pushWithoutLock(nextTask_);
-        lock.unlock();
-
-        slist2.append(std::move(slist));
-        if (!slist2.empty())
-            DebugPrint(dbg_scheduler, "Proc(%d).Stealed = %d", id_, (int)slist2.size());
-        return slist2;
-    } else {
-        // steal all
-        newQueue_.AssertLink();
-        auto slist = newQueue_.pop_all();
-        newQueue_.AssertLink();
-
-        std::unique_lock<TaskQueue::lock_t> lock(runnableQueue_.LockRef());
+    // 再按优先级从高到低偷可执行队列中的协程, 高优先级的协程换到空闲的P上可以更早执行.
+    // 偷来的协程在新P上仍然进入同优先级的队列.
+    SList<Task> slist2;
+    for (int i = 0; i < priority_count; ++i) {
+        if (n > 0 && slist.size() + slist2.size() >= n)
+            break;
+
+        TaskQueue & runnableQueue = runnableQueues_[i];
+        if (runnableQueue.emptyUnsafe())
+            continue;
+
+        std::unique_lock<TaskQueue::lock_t> lock(runnableQueue.LockRef());
         bool pushRunningTask = false, pushNextTask = false;
         if (runningTask_)
-            pushRunningTask = runnableQueue_.eraseWithoutLock(runningTask_, true) || slist.erase(runningTask_, newQueue_.check_);
+            pushRunningTask = runnableQueue.eraseWithoutLock(runningTask_, true) || slist.erase(runningTask_, newQueue_.check_);
         if (nextTask_)
-            pushNextTask = runnableQueue_.eraseWithoutLock(nextTask_, true) || slist.erase(nextTask_, newQueue_.check_);
-        auto slist2 = runnableQueue_.pop_allWithoutLock();
+            pushNextTask = runnableQueue.eraseWithoutLock(nextTask_, true) || slist.erase(nextTask_, newQueue_.check_);
+        if (n > 0)
+            slist2.append(runnableQueue.pop_backWithoutLock(n - slist.size() - slist2.size()));
+        else
+            slist2.append(runnableQueue.pop_allWithoutLock());
         if (pushRunningTask)
-            runnableQueue_.pushWithoutLock(runningTask_);
+            runnableQueue.pushWithoutLock(runningTask_);
         if (pushNextTask)
-            runnableQueue_.pushWithoutLock(nextTask_);
-        lock.unlock();
+            runnableQueue.pushWithoutLock(nextTask_);
+    }
+
+    slist2.append(std::move(slist));
+    if (n > 0)
+        StealGroups(slist2);
+    if (!slist2.empty()) {
+        Tracer::Trace(eTraceEvent::steal, id_, (uint32_t)slist2.size());
+        Metrics::Inc(eMetric::steals);
+        Metrics::Inc(eMetric::stolen_tasks, slist2.size());
+        DebugPrint(dbg_scheduler, "Proc(%d).Stealed = %d", id_, (int)slist2.size());
+    }
+    return slist2;
+}
+
+void Processer::StealGroups(SList<Task> & slist)
+{
+    std::set<std::size_t> slots;
+    for (TSQueueHook* pos = slist.head(); pos; pos = pos->next) {
+        Task* tk = (Task*)pos;
+        if (tk->affinityKey_)
+            slots.insert(Scheduler::AffinitySlotIndex(tk->affinityKey_));
+    }
+    if (slots.empty()) return;
+
+    auto inGroups = [&](Task* tk) {
+        return tk->affinityKey_ && tk != runningTask_ && tk != nextTask_ &&
+            slots.count(Scheduler::AffinitySlotIndex(tk->affinityKey_));
+    };
+
+    {
+        std::unique_lock<TaskQueue::lock_t> lock(newQueue_.LockRef());
+        slist.append(newQueue_.pop_ifWithoutLock(inGroups));
+    }
+    for (int i = 0; i < priority_count; ++i) {
+        TaskQueue & runnableQueue = runnableQueues_[i];
+        if (runnableQueue.emptyUnsafe())
+            continue;
 
-        slist2.append(std::move(slist));
-        if (!slist2.empty())
-            DebugPrint(dbg_scheduler, "Proc(%d).Stealed all = %d", id_, (int)slist2.size());
-        return slist2;
+        std::unique_lock<TaskQueue::lock_t> lock(runnableQueue.LockRef());
+        slist.append(runnableQueue.pop_ifWithoutLock(inGroups));
     }
 }
 
-Processer::SuspendEntry Processer::Suspend()
+void Processer::Retire()
+{
+    assert(!runningTask_);
+    active_ = false;
+
+    SList<Task> tasks;
+    {
+        std::unique_lock<TaskQueue::lock_t> lock(newQueue_.LockRef());
+        retired_ = true;
+        tasks.append(newQueue_.pop_allWithoutLock());
+        newMinPriority_ = priority_count;
+    }
+    for (int i = 0; i < priority_count; ++i) {
+        std::unique_lock<TaskQueue::lock_t> lock(runnableQueues_[i].LockRef());
+        tasks.append(runnableQueues_[i].pop_allWithoutLock());
+    }
+    deferredMask_ = 0;
+    GC();
+
+    DebugPrint(dbg_scheduler, "Retire processer(%d), migrate %d tasks, %d tasks waiting",
+            id_, (int)tasks.size(), (int)waitQueue_.size());
+    if (!tasks.empty())
+        scheduler_->SelectProcesser(this)->AddTask(std::move(tasks));
+}
+
+bool Processer::HasAffinityTasks()
+{
+    std::unique_lock<TaskQueue::lock_t> lock(waitQueue_.LockRef());
+    for (TSQueueHook* pos = waitQueue_.head_->next; pos; pos = pos->next)
+        if (TaskRefAffinity((Task*)pos))
+            return true;
+    return false;
+}
+
+Processer::SuspendEntry Processer::Suspend(eSuspendReason reason)
 {
     Task* tk = GetCurrentTask();
+    if (UNLIKELY(!tk) && IsRunningLight()) {
+        OnBlockInLight("Suspend");
+        return SuspendEntry();
+    }
     assert(tk);
     assert(tk->proc_);
-    return tk->proc_->SuspendBySelf(tk);
+
+    // 有截止时间时最多挂起到截止时间
+    if (UNLIKELY(TaskRefDeadline(tk) != FastSteadyClock::time_point{}) && reason != eSuspendReason::mutex)
+        return Suspend(TaskRefDeadline(tk), reason);
+
+    SuspendEntry entry = tk->proc_->SuspendBySelf(tk, reason);
+    WakeupIfCancelled(tk, entry, reason);
+    return entry;
 }
 
-Processer::SuspendEntry Processer::Suspend(FastSteadyClock::duration dur)
+Processer::SuspendEntry Processer::Suspend(FastSteadyClock::duration dur, eSuspendReason reason)
 {
-    SuspendEntry entry = Suspend();
-    GetCurrentScheduler()->GetTimer().StartTimer(dur,
-            [entry]() mutable {
-                Processer::Wakeup(entry);
-            });
-    return entry;
+    return Suspend(FastSteadyClock::now() + dur, reason);
 }
-Processer::SuspendEntry Processer::Suspend(FastSteadyClock::time_point timepoint)
+Processer::SuspendEntry Processer::Suspend(FastSteadyClock::time_point timepoint, eSuspendReason reason)
 {
-    SuspendEntry entry = Suspend();
+    Task* tk = GetCurrentTask();
+    if (UNLIKELY(!tk) && IsRunningLight()) {
+        OnBlockInLight("Suspend");
+        return SuspendEntry();
+    }
+    assert(tk);
+    assert(tk->proc_);
+
+    FastSteadyClock::time_point deadline = TaskRefDeadline(tk);
+    if (UNLIKELY(deadline != FastSteadyClock::time_point{}) && deadline < timepoint &&
+            reason != eSuspendReason::mutex)
+        timepoint = deadline;
+
+    SuspendEntry entry = tk->proc_->SuspendBySelf(tk, reason);
+    if (WakeupIfCancelled(tk, entry, reason))
+        return entry;
+
+    // 只捕获挂起标识, 可以放进std::function的内部存储
     GetCurrentScheduler()->GetTimer().StartTimer(timepoint,
-            [entry]() mutable {
-                Processer::Wakeup(entry);
+            [entry]() {
+                Task* tk = Processer::TryWakeup(entry);
+                if (!tk) return ;
+                Tracer::Trace(eTraceEvent::timer_fire, tk->id_);
+                tk->proc_->WakeupBySelf(tk);
             });
     return entry;
 }
 
-Processer::SuspendEntry Processer::SuspendBySelf(Task* tk)
+bool Processer::WakeupIfCancelled(Task* tk, SuspendEntry const& entry, eSuspendReason reason)
+{
+    // 挂起序号已经增加, 再检查取消标记(与CancelToken::Cancel配对)
+    CancelToken & token = TaskRefCancel(tk);
+    if (LIKELY(!token) || reason == eSuspendReason::mutex || !token.IsCancelled())
+        return false;
+
+    Wakeup(entry);
+    return true;
+}
+
+Processer::SuspendEntry Processer::SuspendBySelf(Task* tk, eSuspendReason reason)
 {
     assert(tk == runningTask_);
     assert(tk->state_ == TaskState::runnable);
 
     tk->state_ = TaskState::block;
-    uint64_t id = ++ TaskRefSuspendId(tk);
+    tk->suspendReason_ = reason;
+    if (UNLIKELY(CoroutineOptions::getInstance().enable_coro_stat))
+        tk->suspendTsc_ = FastSteadyClock::rdtsc();
+    Tracer::Trace(eTraceEvent::suspend, tk->id_);
 
-    runnableQueue_.next(runningTask_, nextTask_);
+    TaskQueue & runnableQueue = runnableQueues_[tk->priority_];
+    runnableQueue.next(runningTask_, nextTask_);
     if (!nextTask_ && addNewQuota_ > 0) {
         if (AddNewTasks()) {
-            runnableQueue_.next(runningTask_, nextTask_);
+            runnableQueue.next(runningTask_, nextTask_);
             -- addNewQuota_;
         }
     }
 
     DebugPrint(dbg_suspend, "tk(%s) Suspend. nextTask(%s)", tk->DebugInfo(), nextTask_->DebugInfo());
 
-    runnableQueue_.erase(runningTask_);
+    runnableQueue.erase(runningTask_);
     waitQueue_.push(runningTask_);
-    return SuspendEntry{ WeakPtr<Task>(tk), id };
+
+    // 进入等待队列之后再增加挂起序号: 序号为奇数时协程一定在等待队列中,
+    // 唤醒方CAS成功后可以直接把协程移出等待队列.
+    TaskSlot* slot = tk->slot_;
+    slot->reason_ = reason;
+    uint64_t id = ++ slot->state_;
+    return SuspendEntry{ slot, id };
 }
 
-bool Processer::IsExpire(SuspendEntry const& entry)
+void Processer::SetDeadline(FastSteadyClock::time_point deadline)
 {
-    IncursivePtr<Task> tkPtr = entry.tk_.lock();
-    if (!tkPtr) return true;
-    if (entry.id_ != TaskRefSuspendId(tkPtr.get())) return true;
-    return false;
+    Task* tk = GetCurrentTask();
+    if (tk)
+        TaskRefDeadline(tk) = deadline;
 }
 
-bool Processer::Wakeup(SuspendEntry const& entry)
+FastSteadyClock::time_point Processer::GetDeadline()
+{
+    Task* tk = GetCurrentTask();
+    return tk ? TaskRefDeadline(tk) : FastSteadyClock::time_point{};
+}
+
+bool Processer::IsDeadlineExceeded()
+{
+    FastSteadyClock::time_point deadline = GetDeadline();
+    return deadline != FastSteadyClock::time_point{} && FastSteadyClock::now() >= deadline;
+}
+
+FastSteadyClock::time_point Processer::ClampDeadline(FastSteadyClock::time_point timepoint)
+{
+    FastSteadyClock::time_point deadline = GetDeadline();
+    if (deadline == FastSteadyClock::time_point{})
+        return timepoint;
+    if (timepoint == FastSteadyClock::time_point{} || deadline < timepoint)
+        return deadline;
+    return timepoint;
+}
+
+bool Processer::IsCancelled()
 {
-    IncursivePtr<Task> tkPtr = entry.tk_.lock();
-    if (!tkPtr) return false;
+    Task* tk = GetCurrentTask();
+    return tk && TaskRefCancel(tk).IsCancelled();
+}
+
+bool Processer::IsExpire(SuspendEntry const& entry)
+{
+    return !entry.slot_ || entry.slot_->state_.load(std::memory_order_acquire) != entry.id_;
+}
 
-    auto proc = tkPtr->proc_;
-    return proc ? proc->WakeupBySelf(tkPtr, entry.id_) : false;
+Task* Processer::TryWakeup(SuspendEntry const& entry)
+{
+    TaskSlot* slot = entry.slot_;
+    if (!slot) return nullptr;
+
+    // CAS成功的唤醒方独占这次唤醒, 此时协程一定存活且在等待队列中
+    uint64_t id = entry.id_;
+    if (slot->state_.load(std::memory_order_relaxed) != id) return nullptr;
+    if (!slot->state_.compare_exchange_strong(id, id + 1,
+                std::memory_order_acq_rel, std::memory_order_relaxed))
+        return nullptr;
+    return slot->tk_;
 }
 
-bool Processer::WakeupBySelf(IncursivePtr<Task> const& tkPtr, uint64_t id)
+bool Processer::Wakeup(SuspendEntry const& entry)
 {
-    Task* tk = tkPtr.get();
+    Task* tk = TryWakeup(entry);
+    if (!tk) return false;
 
-    if (id != TaskRefSuspendId(tk)) return false;
+    tk->proc_->WakeupBySelf(tk);
+    return true;
+}
 
+void Processer::WakeupBySelf(Task* tk)
+{
     {
         std::unique_lock<TaskQueue::lock_t> lock(waitQueue_.LockRef());
-        if (id != TaskRefSuspendId(tk)) return false;
         DebugPrint(dbg_suspend, "tk(%s) Wakeup. tk->state_ = %s", tk->DebugInfo(), GetTaskStateName(tk->state_));
-        ++ TaskRefSuspendId(tk);
+        if (tk->suspendTsc_)
+            tk->wakeupTsc_ = FastSteadyClock::rdtsc();
         bool ret = waitQueue_.eraseWithoutLock(tk, true);
         (void)ret;
         assert(ret);
     }
 
-    runnableQueue_.push(tk);
+    Tracer::Trace(eTraceEvent::wakeup, tk->id_);
+
+    // 亲和组已经移动到其他P上, 跟过去
+    if (UNLIKELY(tk->affinityKey_)) {
+        Processer* proc = scheduler_->AffinitySlot(tk->affinityKey_).load(std::memory_order_relaxed);
+        if (proc && proc != this && proc->active_ && !proc->retired_) {
+            proc->AddTask(tk);
+            return ;
+        }
+    }
+
+    {
+        TaskQueue & runnableQueue = runnableQueues_[tk->priority_];
+        std::unique_lock<TaskQueue::lock_t> lock(runnableQueue.LockRef());
+        if (UNLIKELY(retired_)) {
+            lock.unlock();
+            scheduler_->SelectProcesser(this)->AddTask(tk);
+            return ;
+        }
+        runnableQueue.pushWithoutLock(tk);
+    }
     OnAddTask();
-    return true;
 }
 
 } //namespace co
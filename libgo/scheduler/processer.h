@@ -3,6 +3,11 @@
 #include "../common/clock.h"
 #include "../task/task.h"
 #include "../common/ts_queue.h"
+#include "../common/histogram.h"
+#include "../common/metrics.h"
+#include "cpu_stat.h"
+#include "sched_group.h"
+#include "task_table.h"
 
 #if ENABLE_DEBUGGER
 #include "../debug/listener.h"
@@ -10,6 +15,9 @@
 #include <condition_variable>
 #include <mutex>
 #include <atomic>
+#if defined(LIBGO_SYS_Unix)
+#include <pthread.h>
+#endif
 
 namespace co {
 
@@ -20,6 +28,8 @@ class Scheduler;
 class Processer
 {
     friend class Scheduler;
+    friend class CoDebugger;
+    friend class BlockingWatchdog;
 
 private:
     Scheduler * scheduler_;
@@ -27,10 +37,20 @@ private:
     // 线程ID
     int id_;
 
+    // 绑定的CPU, 不绑定时为-1
+    int cpu_ = -1;
+
     // 激活态
     // 非激活的P仅仅是不能接受新的协程加入, 仍然可以强行AddTask并正常处理.
     volatile bool active_ = true;
 
+    // 已退役: 线程已经(或即将)退出, 加入的协程转交给其他P.
+    // 在newQueue_的锁内设置, 加入协程时在队列的锁内检查.
+    volatile bool retired_ = false;
+
+    // 线程正在执行Process(退役的P要等线程退出后才能重新启用)
+    std::atomic<bool> running_{false};
+
     // 当前正在运行的协程
     Task* runningTask_{nullptr};
     Task* nextTask_{nullptr};
@@ -42,17 +62,70 @@ private:
     volatile int64_t markTick_ = 0;
     volatile uint64_t markSwitch_ = 0;
 
+    // 看门狗已经采集过的阻塞(记录采集时的markSwitch_, 每次阻塞只采集一次, Dispatch线程专用)
+    uint64_t watchdogSwitch_ = 0;
+
+#if defined(LIBGO_SYS_Unix)
+    // 执行本P的线程, 看门狗向它发送信号
+    pthread_t nativeThread_;
+#endif
+
     // 协程调度次数
     volatile uint64_t switchCount_ = 0;
 
+    // 本P线程的指标分片(Process开始时获取, 省去热路径上的thread_local访问)
+    MetricShard* metrics_ = nullptr;
+
+    // 当前正在运行的协程本次切入时的rdtsc, 不在运行协程时为0
+    volatile uint64_t swapInTsc_ = 0;
+
+    // 正在P的线程栈上执行轻量任务
+    bool runningLight_ = false;
+
+    // 排队延迟的估计: 本轮调度开始时的rdtsc和上一轮调度的时长(空闲时为0)
+    volatile uint64_t roundStartTsc_ = 0;
+    volatile uint64_t lastRoundCycles_ = 0;
+
+    // 抢占时间片换算的cpu周期数(每轮调度开始时按preempt_timeslice_us更新, 0表示不抢占)
+    uint64_t preemptCycles_ = 0;
+
+    // 按go语句位置聚合的CPU时间(开启enable_coro_stat时才统计)
+    LFLock cpuStatLock_;
+    LocationCpuStatMap cpuStats_;
+
+    // 调度延迟(从唤醒到切入执行)和按挂起原因分类的等待时长, 单位: 纳秒
+    // (开启enable_coro_stat时才统计, 只由本P的线程写入)
+    Histogram runQueueLatency_;
+    Histogram waitTime_[(int)eSuspendReason::count];
+
     // 协程队列
+    // 可执行队列按优先级分开, 每轮调度选择一个队列轮流执行其中的协程.
     typedef TSQueue<Task, true> TaskQueue;
-    TaskQueue runnableQueue_;
+    TaskQueue runnableQueues_[priority_count];
     TaskQueue waitQueue_;
     TSQueue<Task, false> gcQueue_;
 
     TaskQueue newQueue_;
 
+    // newQueue_中协程的最高优先级(没有协程时为priority_count), 在newQueue_的锁内修改
+    volatile uint8_t newMinPriority_ = priority_count;
+
+    // 本轮调度的可执行队列
+    int curPriority_ = priority_normal;
+
+    // 各优先级队列有协程却没被选中的连续轮数(饥饿保护)
+    uint32_t skipped_[priority_count] = {};
+
+    // 本轮是饥饿保护选中的: 整轮执行完, 不因为更高优先级的协程提前结束
+    bool starvationRound_ = false;
+
+    // 调度组: 是否按权重推迟协程(上一轮所有协程都被推迟时, 本轮不按权重推迟)
+    bool enforceWeight_ = true;
+
+    // 调度组: 所有协程都因配额被推迟的可执行队列, 在SchedulingGroup::Epoch变化前不再选择
+    uint32_t deferredMask_ = 0;
+    uint64_t deferredEpoch_ = 0;
+
     // 等待的条件变量
     std::mutex cvMutex_;
     std::condition_variable cv_;
@@ -74,21 +147,40 @@ public:
     // 获取当前正在执行的协程
     static Task* GetCurrentTask();
 
+    // 调度延迟直方图(从唤醒到切入执行, 单位: 纳秒, 需开启enable_coro_stat)
+    Histogram const& GetRunQueueLatency() { return runQueueLatency_; }
+
+    // 按挂起原因分类的等待时长直方图(从挂起到唤醒, 单位: 纳秒, 需开启enable_coro_stat)
+    Histogram const& GetWaitTime(eSuspendReason reason) { return waitTime_[(int)reason]; }
+
     // 是否在协程中
     static bool IsCoroutine();
 
+    // 是否在轻量任务中
+    ALWAYS_INLINE static bool IsRunningLight();
+
+    // 轻量任务中调用了会阻塞的操作(会阻塞整个P线程): 打印错误, debug版本断言失败
+    // @what: 阻塞的操作
+    static void OnBlockInLight(const char* what);
+
     // 协程切出
     ALWAYS_INLINE static void StaticCoYield();
 
-    // 挂起标识
+    // 抢占检查点: 当前协程本次运行超过时间片时让出CPU, 返回是否让出过
+    ALWAYS_INLINE static bool PreemptCheck();
+
+    // 挂起标识: 协程槽位和挂起时的序号
     struct SuspendEntry {
-        WeakPtr<Task> tk_;
+        TaskSlot* slot_;
         uint64_t id_;
 
-        explicit operator bool() const { return !!tk_; }
+        SuspendEntry() : slot_(nullptr), id_(0) {}
+        SuspendEntry(TaskSlot* slot, uint64_t id) : slot_(slot), id_(id) {}
+
+        explicit operator bool() const { return !!slot_; }
 
         friend bool operator==(SuspendEntry const& lhs, SuspendEntry const& rhs) {
-            return lhs.tk_ == rhs.tk_ && lhs.id_ == rhs.id_;
+            return lhs.slot_ == rhs.slot_ && lhs.id_ == rhs.id_;
         }
 
         bool IsExpire() const {
@@ -97,11 +189,12 @@ public:
     };
 
     // 挂起当前协程
-    static SuspendEntry Suspend();
+    // @reason: 挂起原因, 用于统计各类等待的时长
+    static SuspendEntry Suspend(eSuspendReason reason = eSuspendReason::user);
 
     // 挂起当前协程, 并在指定时间后自动唤醒
-    static SuspendEntry Suspend(FastSteadyClock::duration dur);
-    static SuspendEntry Suspend(FastSteadyClock::time_point timepoint);
+    static SuspendEntry Suspend(FastSteadyClock::duration dur, eSuspendReason reason = eSuspendReason::timer);
+    static SuspendEntry Suspend(FastSteadyClock::time_point timepoint, eSuspendReason reason = eSuspendReason::timer);
 
     // 唤醒协程
     static bool Wakeup(SuspendEntry const& entry);
@@ -109,6 +202,20 @@ public:
     // 测试一个SuspendEntry是否还可能有效
     static bool IsExpire(SuspendEntry const& entry);
 
+    // 当前协程的截止时间, time_point{}表示没有截止时间
+    // 设置后当前协程的挂起(互斥锁除外)最多等待到截止时间, 由各个阻塞操作返回超时.
+    static void SetDeadline(FastSteadyClock::time_point deadline);
+    static FastSteadyClock::time_point GetDeadline();
+
+    // 当前协程是否已经超过截止时间
+    static bool IsDeadlineExceeded();
+
+    // 取timepoint和当前协程截止时间中较早的一个(time_point{}表示不限)
+    static FastSteadyClock::time_point ClampDeadline(FastSteadyClock::time_point timepoint);
+
+    // 当前协程绑定的取消令牌(CancelToken)是否已经取消
+    static bool IsCancelled();
+
     /// --------------------------------------
     // for friend class Scheduler
 private:
@@ -118,6 +225,14 @@ private:
     // 暂兼用于负载指数
     std::size_t RunnableSize();
 
+    // 新加入的协程大约要等待的时长: 一轮调度的时长
+    ALWAYS_INLINE uint64_t QueueDelayCycles(uint64_t tsc)
+    {
+        uint64_t start = roundStartTsc_;
+        uint64_t cur = (start && tsc > start) ? tsc - start : 0;
+        return (std::max)(cur, (uint64_t)lastRoundCycles_);
+    }
+
     ALWAYS_INLINE void CoYield();
 
     // 新创建、阻塞后触发的协程add进来
@@ -142,36 +257,105 @@ private:
     bool IsBlocking();
 
     // 偷协程
+    // 亲和组整组偷走: 被偷的协程所在的亲和组中还在队列里的协程也一起偷走
     SList<Task> Steal(std::size_t n);
+
+    void StealGroups(SList<Task> & slist);
+
+    // 退役: 取出newQueue_和可执行队列中的所有协程转交给其他P, 之后加入的协程也会被转交.
+    // 等待队列中的协程留在原处, 被唤醒时再转交. 只能由本P的线程在空闲时调用.
+    void Retire();
+
+    // 等待队列中是否有设置了亲和性(TaskOpt::affinity_)的协程
+    bool HasAffinityTasks();
     /// --------------------------------------
 
 private:
-    void WaitCondition();
+    void WaitCondition(int timeoutMs = 100);
 
     void GC();
 
     bool AddNewTasks();
 
+    // 按优先级把协程加入可执行队列
+    void PushRunnable(SList<Task> && slist);
+
+    // 选择本轮调度的可执行队列, 都为空时返回priority_count
+    int SelectPriority();
+
+    // 是否有比prio更优先的协程等待执行
+    bool HasHigherPriority(int prio);
+
+    // 可执行队列是否有协程可以调度(不含因配额被推迟的队列)
+    ALWAYS_INLINE bool IsSchedulable(int prio)
+    {
+        return !runnableQueues_[prio].emptyUnsafe() && !(deferredMask_ & (1u << prio));
+    }
+
     // 调度线程打标记, 用于检测阻塞
     void Mark();
 
     int64_t NowMicrosecond();
 
-    SuspendEntry SuspendBySelf(Task* tk);
+    SuspendEntry SuspendBySelf(Task* tk, eSuspendReason reason);
 
-    bool WakeupBySelf(IncursivePtr<Task> const& tkPtr, uint64_t id);
+    // 刚挂起的协程已经被取消时立即唤醒, 返回是否唤醒了
+    static bool WakeupIfCancelled(Task* tk, SuspendEntry const& entry, eSuspendReason reason);
+
+    // 被唤醒的协程切入时统计调度延迟和等待时长
+    void OnWakeupSwapIn(Task* tk, uint64_t tsc);
+
+    // 统计协程本次运行的CPU时间
+    void AddCpuStat(Task* tk, uint64_t cycles, uint64_t tsc);
+
+    // 收集本P中所有协程的CPU时间
+    void CollectTaskCpuInfo(std::vector<TaskCpuInfo> & out);
+
+    // 收集本P中按go语句位置聚合的CPU时间
+    void CollectLocationCpuInfo(std::map<SourceLocation, LocationCpuInfo> & out);
+
+    // 把挂起序号从entry.id_推进一步(一次CAS), 成功时返回被唤醒的协程
+    static Task* TryWakeup(SuspendEntry const& entry);
+
+    // 把已经由TryWakeup唤醒的协程从等待队列移回可执行队列
+    void WakeupBySelf(Task* tk);
 };
 
+ALWAYS_INLINE bool Processer::IsRunningLight()
+{
+    auto proc = GetCurrentProcesser();
+    return proc && proc->runningLight_;
+}
+
 ALWAYS_INLINE void Processer::StaticCoYield()
 {
     auto proc = GetCurrentProcesser();
     if (proc) proc->CoYield();
 }
 
+ALWAYS_INLINE bool Processer::PreemptCheck()
+{
+    auto proc = GetCurrentProcesser();
+    if (!proc || !proc->preemptCycles_) return false;
+
+    uint64_t swapInTsc = proc->swapInTsc_;
+    if (LIKELY(!swapInTsc || FastSteadyClock::rdtsc() - swapInTsc < proc->preemptCycles_))
+        return false;
+
+    // 轻量任务不能让出
+    if (UNLIKELY(proc->runningTask_->light_))
+        return false;
+
+    proc->metrics_->Add((int)eMetric::preemptions, 1);
+    proc->CoYield();
+    return true;
+}
+
 ALWAYS_INLINE void Processer::CoYield()
 {
+    // 不在协程中(P的调度循环或轻量任务中)时不能让出
     Task *tk = GetCurrentTask();
-    assert(tk);
+    if (UNLIKELY(!tk)) return ;
 
     ++ tk->yieldCount_;
 
@@ -185,4 +369,50 @@ ALWAYS_INLINE void Processer::CoYield()
 }
 
 
+// 协作式抢占检查点, 放在不会主动让出CPU的长循环中.
+// 当前协程本次运行超过CoroutineOptions::preempt_timeslice_us时让出CPU, 不在协程中时什么都不做.
+ALWAYS_INLINE bool preempt_check()
+{
+    return Processer::PreemptCheck();
+}
+
+// 协程的截止时间(deadline)
+// 设置后, 当前协程的阻塞操作最多等待到截止时间, 到期后返回超时:
+//   hook的IO、connect返回-1(errno=ETIMEDOUT), usleep/nanosleep提前返回-1(errno=ETIMEDOUT),
+//   Channel的读写、ConnectionPool::Get返回失败, ConditionVariableAny返回cv_status::timeout.
+// 互斥锁(CoMutex/CoRWMutex)的lock没有失败的返回值, 不受截止时间限制.
+// 子协程默认不继承截止时间, 需要时在go时加上co_inherit_deadline.
+ALWAYS_INLINE void set_deadline(FastSteadyClock::time_point deadline)
+{
+    Processer::SetDeadline(deadline);
+}
+
+template <typename Rep, typename Period>
+ALWAYS_INLINE void set_timeout(std::chrono::duration<Rep, Period> const& timeout)
+{
+    Processer::SetDeadline(FastSteadyClock::now() +
+            std::chrono::duration_cast<FastSteadyClock::duration>(timeout));
+}
+
+ALWAYS_INLINE void clear_deadline()
+{
+    Processer::SetDeadline(FastSteadyClock::time_point{});
+}
+
+ALWAYS_INLINE FastSteadyClock::time_point get_deadline()
+{
+    return Processer::GetDeadline();
+}
+
+ALWAYS_INLINE bool deadline_exceeded()
+{
+    return Processer::IsDeadlineExceeded();
+}
+
+// 当前协程的取消令牌(见CancelToken)是否已经取消
+ALWAYS_INLINE bool cancelled()
+{
+    return Processer::IsCancelled();
+}
+
 } //namespace co
@@ -2,6 +2,8 @@
 #include "../common/config.h"
 #include "../task/task.h"
 #include "../common/util.h"
+#include "../common/clock.h"
+#include "cancel_token.h"
 
 namespace co
 {
@@ -9,7 +11,8 @@ namespace co
 TaskRefDefine(bool, Affinity)
 TaskRefDefine(SourceLocation, Location)
 TaskRefDefine(std::string, DebugInfo)
-TaskRefDefine(atomic_t<uint64_t>, SuspendId)
+TaskRefDefine(FastSteadyClock::time_point, Deadline)
+TaskRefDefine(CancelToken, Cancel)
 
 inline const char* TaskDebugInfo(Task *tk)
 {
@@ -0,0 +1,211 @@
+#include "sched_group.h"
+#include "../common/metrics.h"
+
+namespace co
+{
+
+volatile uint64_t SchedulingGroup::s_minVruntime_ = 0;
+volatile uint64_t SchedulingGroup::s_epoch_ = 0;
+volatile uint64_t SchedulingGroup::s_lastRefreshTsc_ = 0;
+atomic_t<std::size_t> SchedulingGroup::s_count_{0};
+uint64_t SchedulingGroup::s_slackCycles_ = 0;
+uint64_t SchedulingGroup::s_activeUpdateCycles_ = 0;
+
+// 虚拟运行时间允许领先最小值的时长, 避免组之间频繁切换
+static const uint64_t kSlackNs = 2 * 1000 * 1000;
+
+// 超过这个时长没有协程想要执行的组视为空闲, 不参与计算最小虚拟运行时间
+static const uint64_t kIdleNs = 10 * 1000 * 1000;
+
+static std::mutex & GroupsMutex()
+{
+    static std::mutex mtx;
+    return mtx;
+}
+
+static std::vector<SchedulingGroup*> & Groups()
+{
+    static std::vector<SchedulingGroup*> groups;
+    return groups;
+}
+
+SchedulingGroup* SchedulingGroup::Create(std::string const& name, uint32_t weight,
+        uint32_t quotaUs, uint32_t periodUs)
+{
+    static std::once_flag once;
+    std::call_once(once, []{
+            double cyclesPerNs = FastSteadyClock::CyclesPerNanosecond();
+            s_slackCycles_ = (uint64_t)(cyclesPerNs * kSlackNs);
+            s_activeUpdateCycles_ = (uint64_t)(cyclesPerNs * 1000 * 1000);
+        });
+
+    SchedulingGroup* group = new SchedulingGroup(name, weight, quotaUs, periodUs);
+
+    std::string labels = "group=\"" + name + "\"";
+    Metrics::getInstance().RegisterFunc(eMetricType::gauge, "libgo_group_tasks",
+            "Coroutines alive in the scheduling group.", labels,
+            [=]{ return (double)group->tasks_; });
+    Metrics::getInstance().RegisterFunc(eMetricType::counter, "libgo_group_cpu_ns_total",
+            "CPU time used by the scheduling group.", labels,
+            [=]{ return (double)group->GetStat().cpuNs_; });
+    Metrics::getInstance().RegisterFunc(eMetricType::counter, "libgo_group_throttled_periods_total",
+            "Quota periods in which the scheduling group was throttled.", labels,
+            [=]{ return (double)group->throttledPeriods_; });
+    Metrics::getInstance().RegisterFunc(eMetricType::counter, "libgo_group_deferred_total",
+            "Coroutine runs deferred by quota or weight.", labels,
+            [=]{ return (double)group->deferred_; });
+    Metrics::getInstance().RegisterFunc(eMetricType::counter, "libgo_group_rejected_total",
+            "Coroutines rejected because the scheduling group reached max tasks.", labels,
+            [=]{ return (double)group->rejected_; });
+
+    std::unique_lock<std::mutex> lock(GroupsMutex());
+    Groups().push_back(group);
+    ++s_count_;
+    return group;
+}
+
+SchedulingGroup::SchedulingGroup(std::string const& name, uint32_t weight,
+        uint32_t quotaUs, uint32_t periodUs)
+    : name_(name)
+{
+    SetWeight(weight);
+    SetQuota(quotaUs, periodUs);
+
+    // 新组从当前的最小虚拟运行时间开始, 不会一加入就独占CPU
+    vruntime_ = s_minVruntime_;
+    lastActiveTsc_ = FastSteadyClock::rdtsc();
+}
+
+void SchedulingGroup::SetWeight(uint32_t weight)
+{
+    weight_ = (std::max<uint32_t>)(weight, 1);
+}
+
+void SchedulingGroup::SetQuota(uint32_t quotaUs, uint32_t periodUs)
+{
+    double cyclesPerNs = FastSteadyClock::CyclesPerNanosecond();
+    periodUs = (std::max<uint32_t>)(periodUs, 1000);
+    quotaUs_ = quotaUs;
+    periodUs_ = periodUs;
+    quotaCycles_ = (uint64_t)(cyclesPerNs * quotaUs * 1000);
+    periodCycles_ = (uint64_t)(cyclesPerNs * periodUs * 1000);
+    periodStart_ = FastSteadyClock::rdtsc();
+    periodUsage_ = 0;
+
+    if (!quotaUs && throttled_.exchange(false))
+        ++s_epoch_;
+}
+
+void SchedulingGroup::SetMaxTasks(uint32_t maxTasks)
+{
+    maxTasks_ = maxTasks;
+}
+
+void SchedulingGroup::AddRuntime(uint64_t cycles)
+{
+    cycles_.fetch_add(cycles, std::memory_order_relaxed);
+    vruntime_.fetch_add(cycles * kDefaultWeight / weight_, std::memory_order_relaxed);
+
+    uint64_t quota = quotaCycles_;
+    if (!quota) return;
+
+    uint64_t usage = periodUsage_.fetch_add(cycles, std::memory_order_relaxed) + cycles;
+    if (usage >= quota && !throttled_.load(std::memory_order_relaxed)) {
+        if (!throttled_.exchange(true))
+            ++throttledPeriods_;
+    }
+}
+
+bool SchedulingGroup::RefreshPeriod(uint64_t tsc)
+{
+    uint64_t quota = quotaCycles_;
+    if (!quota || tsc - periodStart_ < periodCycles_)
+        return throttled_;
+
+    periodStart_ = tsc;
+
+    // 单次运行超出配额的部分计入下一个周期
+    uint64_t usage = periodUsage_.load(std::memory_order_relaxed);
+    uint64_t remain = usage > quota ? usage - quota : 0;
+    periodUsage_.fetch_sub(usage - remain, std::memory_order_relaxed);
+
+    if (remain >= quota) {
+        ++throttledPeriods_;
+        return true;
+    }
+
+    throttled_ = false;
+    return false;
+}
+
+void SchedulingGroup::DoRefresh()
+{
+    static LFLock refreshLock;
+    std::unique_lock<LFLock> refreshGuard(refreshLock, std::defer_lock);
+    if (!refreshGuard.try_lock()) return;
+
+    uint64_t tsc = FastSteadyClock::rdtsc();
+    if (tsc - s_lastRefreshTsc_ < s_activeUpdateCycles_) return;
+
+    std::vector<SchedulingGroup*> groups = GetAllGroups();
+    uint64_t idleCycles = (uint64_t)(FastSteadyClock::CyclesPerNanosecond() * kIdleNs);
+
+    bool throttled = false;
+    uint64_t minVruntime = (uint64_t)-1;
+    for (SchedulingGroup* group : groups) {
+        // 本周期开始时处于限制状态也要通知P, 让它重新检查被推迟的协程
+        throttled |= group->throttled_;
+        group->RefreshPeriod(tsc);
+
+        if (tsc - group->lastActiveTsc_.load(std::memory_order_relaxed) < idleCycles)
+            minVruntime = (std::min)(minVruntime, group->vruntime_.load(std::memory_order_relaxed));
+    }
+
+    if (minVruntime != (uint64_t)-1 && minVruntime > s_minVruntime_)
+        s_minVruntime_ = minVruntime;
+
+    // 空闲的组不能积攒虚拟运行时间, 否则重新活跃时会长时间独占CPU
+    uint64_t floor = s_minVruntime_;
+    for (SchedulingGroup* group : groups) {
+        uint64_t vruntime = group->vruntime_.load(std::memory_order_relaxed);
+        while (vruntime < floor &&
+                !group->vruntime_.compare_exchange_weak(vruntime, floor, std::memory_order_relaxed)) ;
+    }
+
+    if (throttled)
+        ++s_epoch_;
+    s_lastRefreshTsc_ = tsc;
+}
+
+std::vector<SchedulingGroup*> SchedulingGroup::GetAllGroups()
+{
+    std::unique_lock<std::mutex> lock(GroupsMutex());
+    return Groups();
+}
+
+SchedulingGroup::Stat SchedulingGroup::GetStat()
+{
+    Stat stat;
+    stat.name_ = name_;
+    stat.weight_ = weight_;
+    stat.quotaUs_ = quotaUs_;
+    stat.periodUs_ = periodUs_;
+    stat.tasks_ = tasks_;
+    stat.cpuNs_ = (uint64_t)(cycles_ / FastSteadyClock::CyclesPerNanosecond());
+    stat.throttledPeriods_ = throttledPeriods_;
+    stat.deferred_ = deferred_;
+    stat.throttled_ = throttled_;
+    stat.maxTasks_ = maxTasks_;
+    stat.rejected_ = rejected_;
+    return stat;
+}
+
+std::vector<SchedulingGroup::Stat> SchedulingGroup::GetAllStats()
+{
+    std::vector<Stat> stats;
+    for (SchedulingGroup* group : GetAllGroups())
+        stats.push_back(group->GetStat());
+    return stats;
+}
+
+} // namespace co
@@ -0,0 +1,164 @@
+#pragma once
+#include "../common/config.h"
+#include "../common/spinlock.h"
+#include "../common/clock.h"
+
+namespace co
+{
+
+// 调度组(类似cgroups的cpu子系统)
+// 在go时通过co_group(group)指定协程所属的组, 同一组的协程按组统计CPU时间:
+//   weight: 权重, 多个组争抢CPU时按权重比例分配(通过虚拟运行时间实现, 单位为组内所有协程合计)
+//   quota: 每个period内组内协程合计最多使用quotaUs的CPU时间, 超出后本周期内不再调度(0表示不限制)
+//   maxTasks: 组内协程数上限, 达到上限后go创建的协程被准入控制拒绝(0表示不限制)
+// 组创建后不会销毁. 没有指定组的协程不受影响.
+class SchedulingGroup
+{
+public:
+    static const uint32_t kDefaultWeight = 100;
+
+    // 组的统计信息
+    struct Stat
+    {
+        std::string name_;
+        uint32_t weight_;
+        uint32_t quotaUs_;
+        uint32_t periodUs_;
+
+        // 组内存活的协程数
+        uint64_t tasks_;
+
+        // 累计运行时间(纳秒)
+        uint64_t cpuNs_;
+
+        // 因超出配额被限制的周期数
+        uint64_t throttledPeriods_;
+
+        // 因超出配额或权重而推迟执行的次数
+        uint64_t deferred_;
+
+        // 当前是否被限制
+        bool throttled_;
+
+        // 协程数上限
+        uint32_t maxTasks_;
+
+        // 因协程数达到上限被拒绝创建的协程数
+        uint64_t rejected_;
+    };
+
+    // @weight: 权重(相对值)
+    // @quotaUs: 每个周期的CPU配额(微秒), 0表示不限制
+    // @periodUs: 配额周期(微秒)
+    static SchedulingGroup* Create(std::string const& name, uint32_t weight = kDefaultWeight,
+            uint32_t quotaUs = 0, uint32_t periodUs = 100 * 1000);
+
+    void SetWeight(uint32_t weight);
+
+    void SetQuota(uint32_t quotaUs, uint32_t periodUs = 100 * 1000);
+
+    // @maxTasks: 组内协程数上限, 0表示不限制
+    void SetMaxTasks(uint32_t maxTasks);
+
+    std::string const& Name() const { return name_; }
+
+    Stat GetStat();
+
+    static std::vector<Stat> GetAllStats();
+
+    /// --------------------------------------
+    // for Processer/Scheduler
+    ALWAYS_INLINE void OnTaskCreate() { ++tasks_; }
+    ALWAYS_INLINE void OnTaskDelete() { --tasks_; }
+
+    // 准入控制: 再创建n个协程是否超过上限(近似判断, 并发创建时可能略微超出)
+    ALWAYS_INLINE bool AdmitTasks(std::size_t n)
+    {
+        uint32_t maxTasks = maxTasks_;
+        if (LIKELY(!maxTasks) || tasks_ + n <= maxTasks)
+            return true;
+        rejected_ += n;
+        return false;
+    }
+
+    // 协程将要执行时判断是否允许执行
+    // @enforceWeight: 是否按权重推迟(P上没有其他可执行的协程时不按权重推迟, 避免CPU空转)
+    ALWAYS_INLINE bool Admit(uint64_t tsc, bool enforceWeight)
+    {
+        // 记录组内有协程想要执行(降低写共享变量的频率)
+        if (tsc - lastActiveTsc_.load(std::memory_order_relaxed) > s_activeUpdateCycles_)
+            lastActiveTsc_.store(tsc, std::memory_order_relaxed);
+
+        if (throttled_.load(std::memory_order_relaxed) || (enforceWeight &&
+                    vruntime_.load(std::memory_order_relaxed) > s_minVruntime_ + s_slackCycles_)) {
+            deferred_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    // 协程执行完一次后记账
+    void AddRuntime(uint64_t cycles);
+
+    // 由P在每轮调度开始时调用: 更新配额周期和最小虚拟运行时间(最多每毫秒执行一次)
+    ALWAYS_INLINE static void Refresh()
+    {
+        if (LIKELY(!s_count_)) return;
+        if (FastSteadyClock::rdtsc() - s_lastRefreshTsc_ < s_activeUpdateCycles_) return;
+        DoRefresh();
+    }
+
+    // 有组处于限制状态时每次Refresh递增, P据此重新检查被限制的协程
+    ALWAYS_INLINE static uint64_t Epoch() { return s_epoch_; }
+    /// --------------------------------------
+
+private:
+    SchedulingGroup(std::string const& name, uint32_t weight, uint32_t quotaUs, uint32_t periodUs);
+    SchedulingGroup(SchedulingGroup const&) = delete;
+    SchedulingGroup& operator=(SchedulingGroup const&) = delete;
+
+    // 周期结束时扣除本周期的配额, 返回是否仍处于限制状态
+    bool RefreshPeriod(uint64_t tsc);
+
+    static void DoRefresh();
+
+    static std::vector<SchedulingGroup*> GetAllGroups();
+
+private:
+    std::string name_;
+
+    volatile uint32_t weight_;
+    volatile uint32_t quotaUs_;
+    volatile uint32_t periodUs_;
+    volatile uint32_t maxTasks_ = 0;
+
+    // 配额换算为cpu周期数(rdtsc)
+    volatile uint64_t quotaCycles_ = 0;
+    volatile uint64_t periodCycles_ = 0;
+
+    atomic_t<uint64_t> tasks_{0};
+    atomic_t<uint64_t> cycles_{0};
+    atomic_t<uint64_t> deferred_{0};
+    atomic_t<uint64_t> throttledPeriods_{0};
+    atomic_t<uint64_t> rejected_{0};
+
+    // 虚拟运行时间: 运行的cpu周期数 * kDefaultWeight / weight
+    std::atomic<uint64_t> vruntime_{0};
+
+    // 本周期内使用的cpu周期数
+    std::atomic<uint64_t> periodUsage_{0};
+    uint64_t periodStart_ = 0;
+    std::atomic<bool> throttled_{false};
+
+    // 最近一次有协程想要执行的时间
+    std::atomic<uint64_t> lastActiveTsc_{0};
+
+    static volatile uint64_t s_minVruntime_;
+    static volatile uint64_t s_epoch_;
+    static volatile uint64_t s_lastRefreshTsc_;
+    static atomic_t<std::size_t> s_count_;
+    static uint64_t s_slackCycles_;
+    static uint64_t s_activeUpdateCycles_;
+};
+
+} // namespace co
@@ -1,6 +1,8 @@
 #include "scheduler.h"
 #include "../common/error.h"
 #include "../common/clock.h"
+#include "../debug/tracer.h"
+#include "../debug/watchdog.h"
 #include <stdio.h>
 #include <system_error>
 #include <unistd.h>
@@ -20,45 +22,413 @@ inline atomic_t<unsigned long long> & GetTaskIdFactory()
     return factory;
 }
 
+// 遍历时持有(读取指标、导出快照可能较慢), 调度器析构时也要获取, 所以用mutex
+static std::mutex& AllSchedulersLock()
+{
+    static std::mutex lock;
+    return lock;
+}
+
+static std::vector<Scheduler*>& AllSchedulers()
+{
+    static std::vector<Scheduler*> schedulers;
+    return schedulers;
+}
+
 Scheduler* Scheduler::Create()
 {
     return new Scheduler;
 }
 
+void Scheduler::ForeachScheduler(std::function<void(Scheduler*)> const& fn)
+{
+    std::unique_lock<std::mutex> lock(AllSchedulersLock());
+    for (Scheduler* sched : AllSchedulers())
+        fn(sched);
+}
+
 Scheduler::Scheduler()
 {
     LibgoInitialize();
+    for (auto & slot : affinitySlots_)
+        slot.store(nullptr, std::memory_order_relaxed);
+    for (auto & rejected : rejected_)
+        rejected = 0;
     stop_.reset(new bool(false));
     processers_.push_back(new Processer(this, 0));
+
+    static std::once_flag once;
+    std::call_once(once, &Scheduler::RegisterMetrics);
+
+    std::unique_lock<std::mutex> lock(AllSchedulersLock());
+    AllSchedulers().push_back(this);
+}
+
+void Scheduler::RegisterMetrics()
+{
+    Metrics & metrics = Metrics::getInstance();
+    metrics.RegisterFunc(eMetricType::gauge, "libgo_tasks", "Coroutines alive.", "", []{
+                double n = 0;
+                ForeachScheduler([&](Scheduler* sched) { n += sched->TaskCount(); });
+                return n;
+            });
+    metrics.RegisterFunc(eMetricType::gauge, "libgo_processers", "Processer threads.", "", []{
+                double n = 0;
+                ForeachScheduler([&](Scheduler* sched) { n += sched->ProcesserCount(); });
+                return n;
+            });
+    metrics.RegisterFunc(eMetricType::gauge, "libgo_runnable_tasks",
+            "Coroutines waiting in run queues.", "", []{
+                double n = 0;
+                ForeachScheduler([&](Scheduler* sched) {
+                    for (std::size_t i = 0; i < sched->ProcesserCount(); ++i)
+                        n += sched->processers_[i]->RunnableSize();
+                });
+                return n;
+            });
+    metrics.RegisterFunc(eMetricType::gauge, "libgo_timer_pending",
+            "Timers waiting to fire.", "", []{
+                // 没有独立定时器的调度器共用同一个定时器
+                std::set<TimerType*> timers;
+                ForeachScheduler([&](Scheduler* sched) { timers.insert(&sched->GetTimer()); });
+                double n = 0;
+                for (TimerType* timer : timers)
+                    n += timer->GetPendingCount();
+                return n;
+            });
+    metrics.RegisterHistogramFunc("libgo_run_queue_latency_ns",
+            "Delay from wakeup to swap-in (requires enable_coro_stat).", "", []{
+                Histogram h;
+                ForeachScheduler([&](Scheduler* sched) { h.Merge(sched->GetRunQueueLatency()); });
+                return h;
+            });
+    for (int i = 0; i < (int)eSuspendReason::count; ++i) {
+        eSuspendReason reason = (eSuspendReason)i;
+        metrics.RegisterHistogramFunc("libgo_wait_time_ns",
+                "Time suspended before wakeup, by reason (requires enable_coro_stat).",
+                std::string("reason=\"") + GetSuspendReasonName(reason) + "\"", [=]{
+                    Histogram h;
+                    ForeachScheduler([&](Scheduler* sched) { h.Merge(sched->GetWaitTime(reason)); });
+                    return h;
+                });
+    }
+    metrics.RegisterFunc(eMetricType::gauge, "libgo_queue_delay_us",
+            "Estimated run queue delay, the largest among schedulers.", "", []{
+                uint32_t delay = 0;
+                ForeachScheduler([&](Scheduler* sched) { delay = (std::max)(delay, sched->QueueDelayUs()); });
+                return (double)delay;
+            });
+    for (int i = 0; i < (int)eAdmissionReject::count; ++i) {
+        eAdmissionReject reason = (eAdmissionReject)i;
+        metrics.RegisterFunc(eMetricType::counter, "libgo_admission_rejected_total",
+                "Coroutines rejected by admission control, by reason.",
+                std::string("reason=\"") + GetAdmissionRejectName(reason) + "\"", [=]{
+                    double n = 0;
+                    ForeachScheduler([&](Scheduler* sched) { n += sched->RejectedCount(reason); });
+                    return n;
+                });
+    }
 }
 
 Scheduler::~Scheduler()
 {
+    std::unique_lock<std::mutex> lock(AllSchedulersLock());
+    auto & schedulers = AllSchedulers();
+    schedulers.erase(std::remove(schedulers.begin(), schedulers.end(), this), schedulers.end());
+}
+
+bool Scheduler::CreateTask(TaskF const& fn, TaskOpt const& opt)
+{
+    eAdmissionReject reason;
+    if (UNLIKELY(!Admit(opt, 1, reason))) {
+        Reject(fn, reason);
+        return false;
+    }
+
+    Task* tk = NewTask(fn, opt, ++GetTaskIdFactory());
+    ++taskCount_;
+    AddTask(tk);
+    return true;
+}
+
+bool Scheduler::CreateTasks(std::size_t n, std::function<TaskF(std::size_t)> const& gen, TaskOpt const& opt)
+{
+    if (!n) return true;
+
+    eAdmissionReject reason;
+    if (UNLIKELY(!Admit(opt, n, reason))) {
+        // 不逐个生成协程函数, 需要时由拒绝回调一次执行整批
+        std::function<TaskF(std::size_t)> batch = gen;
+        Reject([batch, n]{
+                    for (std::size_t i = 0; i < n; ++i)
+                        batch(i)();
+                }, reason, n);
+        return false;
+    }
+
+    // 选出接收协程的P: 亲和组只放到一个P上, 否则均分给所有激活态的P(当前P优先)
+    std::vector<Processer*> procs;
+    Processer* cur = Processer::GetCurrentProcesser();
+    if (cur && (!cur->active_ || cur->GetScheduler() != this))
+        cur = nullptr;
+    if (opt.affinityKey_) {
+        Processer* proc = AffinitySlot(opt.affinityKey_).load(std::memory_order_relaxed);
+        if (!proc || !proc->active_ || proc->retired_)
+            proc = cur ? cur : SelectProcesser(nullptr);
+        AffinitySlot(opt.affinityKey_).store(proc, std::memory_order_relaxed);
+        procs.push_back(proc);
+    } else {
+        if (cur)
+            procs.push_back(cur);
+        std::size_t pcount = processers_.size();
+        for (std::size_t i = 0; i < pcount; ++i) {
+            auto p = processers_[i];
+            if (p != cur && p->active_ && !p->retired_)
+                procs.push_back(p);
+        }
+        if (procs.empty())
+            procs.push_back(SelectProcesser(nullptr));
+    }
+
+    // 协程id和计数一次分配
+    unsigned long long id = GetTaskIdFactory().fetch_add(n) + 1;
+    taskCount_ += (uint32_t)n;
+
+    // 分块轮流加入各个P: 每块只加一次锁、唤醒一次,
+    // 先加入的块可以在创建后面的协程时就开始执行, 不必等全部创建完再执行.
+    std::size_t pcount = procs.size();
+    std::size_t chunk = (std::min)((n + pcount - 1) / pcount, kCreateTasksChunk);
+    std::size_t i = 0;
+    for (std::size_t pi = 0; i < n; pi = (pi + 1) % pcount) {
+        SList<Task> slist;
+        for (std::size_t end = (std::min)(i + chunk, n); i < end; ++i) {
+            Task* tk = NewTask(gen(i), opt, id + i);
+            slist.push_back(tk);
+        }
+        // 亲和组可能在创建过程中被整组偷走, 跟着移动
+        Processer* proc = procs[pi];
+        if (opt.affinityKey_) {
+            Processer* owner = AffinitySlot(opt.affinityKey_).load(std::memory_order_relaxed);
+            if (owner && owner->active_ && !owner->retired_)
+                proc = owner;
+        }
+        DebugPrint(dbg_scheduler, "Add task(num=%d) to proc(%d) in batch.", (int)slist.size(), proc->Id());
+        proc->AddTask(std::move(slist));
+    }
+    return true;
+}
+
+bool Scheduler::CreateTasks(std::vector<TaskF> const& fns, TaskOpt const& opt)
+{
+    return CreateTasks(fns.size(), [&](std::size_t i) { return fns[i]; }, opt);
+}
+
+bool Scheduler::CreateTaskOnIdle(TaskF const& fn, TaskOpt const& opt)
+{
+    // 从当前P的下一个开始找, 多个P同时拆分时分散到不同的空闲P上
+    Processer* cur = Processer::GetCurrentProcesser();
+    std::size_t pcount = processers_.size();
+    std::size_t start = (cur && cur->GetScheduler() == this) ? cur->Id() + 1 : 0;
+    Processer* proc = nullptr;
+    for (std::size_t i = 0; i < pcount; ++i) {
+        auto p = processers_[(start + i) % pcount];
+        if (p != cur && p->active_ && !p->retired_ && p->IsWaiting()) {
+            proc = p;
+            break;
+        }
+    }
+    if (!proc)
+        return false;
+
+    eAdmissionReject reason;
+    if (UNLIKELY(!Admit(opt, 1, reason))) {
+        CountReject(reason, 1);
+        return false;
+    }
+
+    Task* tk = NewTask(fn, opt, ++GetTaskIdFactory());
+    ++taskCount_;
+    proc->AddTask(tk);
+    return true;
+}
+
+std::size_t Scheduler::IdleProcesserCount()
+{
+    std::size_t n = 0;
+    std::size_t pcount = processers_.size();
+    for (std::size_t i = 0; i < pcount; ++i) {
+        auto p = processers_[i];
+        if (p->active_ && !p->retired_ && p->IsWaiting())
+            ++n;
+    }
+    return n;
+}
+
+const char* GetAdmissionRejectName(eAdmissionReject reason)
+{
+    switch (reason) {
+        case eAdmissionReject::task_limit: return "task_limit";
+        case eAdmissionReject::group_limit: return "group_limit";
+        case eAdmissionReject::queue_delay: return "queue_delay";
+        default: return "unknown";
+    }
+}
+
+void Scheduler::SetAdmission(AdmissionOpt const& opt)
+{
+    std::unique_lock<LFLock> lock(admissionLock_);
+    onReject_ = opt.onReject_;
+    maxTasks_ = opt.maxTasks_;
+    intervalUs_ = opt.intervalUs_;
+    pauseAccept_ = opt.pauseAccept_;
+    targetDelayUs_ = opt.targetDelayUs_;
+    if (!targetDelayUs_) {
+        delayOverloaded_ = false;
+        delayAboveSince_ = 0;
+    }
+}
+
+bool Scheduler::IsOverloaded()
+{
+    UpdateAdmission();
+    uint32_t maxTasks = maxTasks_;
+    return (maxTasks && taskCount_ >= maxTasks) || delayOverloaded_;
+}
+
+uint32_t Scheduler::QueueDelayUs()
+{
+    uint64_t tsc = FastSteadyClock::rdtsc();
+    uint64_t minCycles = 0;
+    bool found = false;
+    std::size_t pcount = processers_.size();
+    for (std::size_t i = 0; i < pcount; ++i) {
+        auto p = processers_[i];
+        if (p->retired_) continue;
+
+        uint64_t cycles = p->QueueDelayCycles(tsc);
+        if (!found || cycles < minCycles) {
+            minCycles = cycles;
+            found = true;
+        }
+    }
+    return (uint32_t)(minCycles / FastSteadyClock::CyclesPerNanosecond() / 1000);
+}
+
+uint64_t Scheduler::RejectedCount(eAdmissionReject reason)
+{
+    return rejected_[(int)reason];
+}
+
+void Scheduler::WaitAdmission()
+{
+    while (pauseAccept_ && IsOverloaded() && Processer::IsCoroutine() && !Processer::IsCancelled()) {
+        Processer::Suspend(std::chrono::milliseconds(1), eSuspendReason::sleep);
+        Processer::StaticCoYield();
+    }
+}
+
+bool Scheduler::DoAdmit(TaskOpt const& opt, std::size_t n, eAdmissionReject & reason)
+{
+    // 协程数是近似判断, 并发创建时可能略微超出上限
+    uint32_t maxTasks = maxTasks_;
+    if (maxTasks && taskCount_ + n > maxTasks)
+        reason = eAdmissionReject::task_limit;
+    else if (opt.group_ && !opt.group_->AdmitTasks(n))
+        reason = eAdmissionReject::group_limit;
+    else if (targetDelayUs_ && (UpdateAdmission(), delayOverloaded_))
+        reason = eAdmissionReject::queue_delay;
+    else
+        return true;
+    return false;
+}
+
+void Scheduler::Reject(TaskF const& fn, eAdmissionReject reason, std::size_t n)
+{
+    CountReject(reason, n);
+
+    std::function<void(TaskF const&, eAdmissionReject)> onReject;
+    {
+        std::unique_lock<LFLock> lock(admissionLock_);
+        onReject = onReject_;
+    }
+    if (!onReject)
+        ThrowError(eCoErrorCode::ec_overloaded);
+    onReject(fn, reason);
+}
+
+void Scheduler::CountReject(eAdmissionReject reason, std::size_t n)
+{
+    rejected_[(int)reason] += n;
+    DebugPrint(dbg_scheduler, "Reject task(num=%d) by admission control. reason=%s",
+            (int)n, GetAdmissionRejectName(reason));
+}
+
+void Scheduler::UpdateAdmission()
+{
+    uint32_t target = targetDelayUs_;
+    if (!target) return ;
+
+    int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(FastSteadyClock::now().time_since_epoch()).count();
+    if (now - delayUpdateTime_ < 1000) return ;
+    std::unique_lock<LFLock> lock(delayUpdateLock_, std::defer_lock);
+    if (!lock.try_lock()) return ;
+    delayUpdateTime_ = now;
+
+    // 类似CoDel: 排队延迟的最小值持续超过目标才认为过载, 避免对短暂的突发做出反应
+    uint32_t delay = QueueDelayUs();
+    if (delay < target) {
+        delayAboveSince_ = 0;
+        if (delayOverloaded_) {
+            delayOverloaded_ = false;
+            DebugPrint(dbg_scheduler, "Admission reopen. queue delay=%u us", delay);
+        }
+    } else if (!delayAboveSince_) {
+        delayAboveSince_ = now;
+    } else if (!delayOverloaded_ && now - delayAboveSince_ >= (int64_t)intervalUs_) {
+        delayOverloaded_ = true;
+        DebugPrint(dbg_scheduler, "Admission overloaded. queue delay=%u us", delay);
+    }
 }
 
-void Scheduler::CreateTask(TaskF const& fn, TaskOpt const& opt)
+Task* Scheduler::NewTask(TaskF const& fn, TaskOpt const& opt, unsigned long long id)
 {
-    Task* tk = new Task(fn, opt.stack_size_ ? opt.stack_size_ : CoroutineOptions::getInstance().stack_size);
-//    printf("new tk = %p  impl = %p\n", tk, tk->impl_);
+    std::size_t stackSize = opt.light_ ? 0 :
+        (opt.stack_size_ ? opt.stack_size_ : CoroutineOptions::getInstance().stack_size);
+    Task* tk = new Task(fn, stackSize);
+    tk->light_ = opt.light_;
     tk->SetDeleter(Deleter(&Scheduler::DeleteTask, this));
-    tk->id_ = ++GetTaskIdFactory();
+    tk->id_ = id;
+    if (!opt.light_)
+        tk->slot_ = taskTable_.Alloc(tk);     // 轻量任务不会挂起, 不需要槽位
+    tk->priority_ = (uint8_t)(std::min)((std::max)(opt.priority_, (int)priority_high), (int)priority_low);
+    tk->affinityKey_ = opt.affinityKey_;
+    tk->group_ = opt.group_;
+    if (tk->group_)
+        tk->group_->OnTaskCreate();
     TaskRefAffinity(tk) = opt.affinity_;
+    TaskRefDeadline(tk) = opt.deadline_;
+    if (opt.cancel_)
+        opt.cancel_.Attach(tk);
     TaskRefLocation(tk).Init(opt.file_, opt.lineno_);
-    ++taskCount_;
 
     DebugPrint(dbg_task, "task(%s) created in scheduler(%p).", TaskDebugInfo(tk), (void*)this);
+    Tracer::Trace(eTraceEvent::create, tk->id_);
+    Metrics::Inc(eMetric::tasks_created);
 #if ENABLE_DEBUGGER
     if (Listener::GetTaskListener()) {
         Listener::GetTaskListener()->onCreated(tk->id_);
     }
 #endif
-
-    AddTask(tk);
+    return tk;
 }
 
 void Scheduler::DeleteTask(RefObject* tk, void* arg)
 {
     Scheduler* self = (Scheduler*)arg;
+    SchedulingGroup* group = static_cast<Task*>(tk)->group_;
+    if (group)
+        group->OnTaskDelete();
+    self->taskTable_.Free(static_cast<Task*>(tk)->slot_);
     delete tk;
     --self->taskCount_;
 }
@@ -89,6 +459,13 @@ void Scheduler::Start(int minThreadNumber, int maxThreadNumber)
 
     auto mainProc = processers_[0];
 
+    if (CoroutineOptions::getInstance().enable_cpu_affinity || !cpuList_.empty())
+        InitCpuAffinity();
+    ++runningProcessers_;
+    mainProc->cpu_ = CpuOfProcesser(mainProc->id_);
+    if (mainProc->cpu_ >= 0)
+        CpuTopology::BindCurrentThread(mainProc->cpu_);
+
     for (int i = 0; i < minThreadNumber_ - 1; i++) {
         NewProcessThread();
     }
@@ -160,16 +537,147 @@ Scheduler::TimerType & Scheduler::StaticGetTimer() {
     return timer;
 }
 
-void Scheduler::NewProcessThread()
+Processer* Scheduler::NewProcessThread()
 {
-    auto p = new Processer(this, processers_.size());
-    DebugPrint(dbg_scheduler, "---> Create Processer(%d)", p->id_);
+    Processer* p = nullptr;
+    std::size_t pcount = processers_.size();
+    for (std::size_t i = 0; i < pcount; ++i) {
+        auto retired = processers_[i];
+        if (retired->retired_ && !retired->running_) {
+            p = retired;
+            break;
+        }
+    }
+
+    ++runningProcessers_;
+    if (p) {
+        DebugPrint(dbg_scheduler, "---> Restart Processer(%d)", p->id_);
+        p->running_ = true;
+        {
+            std::unique_lock<Processer::TaskQueue::lock_t> lock(p->newQueue_.LockRef());
+            p->retired_ = false;
+        }
+        p->active_ = true;
+        std::thread([this, p]{
+                DebugPrint(dbg_thread, "Restart process(sched=%p) thread id: %lu", (void*)this, NativeThreadID());
+                if (p->cpu_ >= 0)
+                    CpuTopology::BindCurrentThread(p->cpu_);
+                p->Process();
+                }).detach();
+        return p;
+    }
+
+    p = new Processer(this, processers_.size());
+    p->cpu_ = CpuOfProcesser(p->id_);
+    DebugPrint(dbg_scheduler, "---> Create Processer(%d) cpu=%d", p->id_, p->cpu_);
     std::thread t([this, p]{
             DebugPrint(dbg_thread, "Start process(sched=%p) thread id: %lu", (void*)this, NativeThreadID());
+            if (p->cpu_ >= 0 && !CpuTopology::BindCurrentThread(p->cpu_))
+                DebugPrint(dbg_scheduler, "Bind processer(%d) to cpu %d failed", p->id_, p->cpu_);
             p->Process();
             });
     t.detach();
     processers_.push_back(p);
+    return p;
+}
+
+bool Scheduler::TryRetire(Processer* p, int64_t idleUs)
+{
+    uint32_t idleMs = CoroutineOptions::getInstance().processer_idle_retire_ms;
+    if (!idleMs || idleUs < (int64_t)idleMs * 1000 || p->id_ == 0)
+        return false;
+
+    if (p->HasAffinityTasks())
+        return false;
+
+    int n = runningProcessers_;
+    do {
+        if (n <= minThreadNumber_)
+            return false;
+    } while (!runningProcessers_.compare_exchange_weak(n, n - 1));
+
+    p->Retire();
+    return true;
+}
+
+Processer* Scheduler::SelectProcesser(Processer* except)
+{
+    Processer* best = nullptr;
+    std::size_t bestLoad = 0;
+    std::size_t pcount = processers_.size();
+    for (std::size_t i = 0; i < pcount; ++i) {
+        auto p = processers_[i];
+        if (p == except || p->retired_ || !p->active_) continue;
+
+        std::size_t load = p->RunnableSize();
+        if (!best || load < bestLoad) {
+            best = p;
+            bestLoad = load;
+        }
+    }
+
+    // 都阻塞时交给主P, 主P不会退役
+    return best ? best : processers_[0];
+}
+
+void Scheduler::SetCpuList(std::vector<int> const& cpus)
+{
+    cpuList_ = cpus;
+}
+
+void Scheduler::InitCpuAffinity()
+{
+    std::string const& path = CoroutineOptions::getInstance().cpu_topology_path;
+
+    // 模拟的拓扑描述的就是要使用的CPU, 不再按当前进程的cpuset过滤
+    std::vector<int> cpuset = cpuList_;
+    if (cpuset.empty() && path == CpuTopology::SysfsRoot())
+        cpuset = CpuTopology::GetProcessCpuset();
+    topology_ = CpuTopology::Load(path, cpuset);
+
+    DebugPrint(dbg_scheduler, "cpu topology(%s):\n%s", path.c_str(), topology_.ToString().c_str());
+}
+
+int Scheduler::CpuOfProcesser(int id)
+{
+    auto & cpus = topology_.Cpus();
+    if (cpus.empty()) return -1;
+    return cpus[id % cpus.size()].id_;
+}
+
+void Scheduler::StealByTopology(Processer* thief)
+{
+    // 跨NUMA节点偷协程的代价较高, 被偷的P要有足够多的协程
+    static const std::size_t kRemoteMinLoad = 8;
+
+    Processer* victim = nullptr;
+    int victimDistance = CpuTopology::remote + 1;
+    std::size_t victimLoad = 0;
+    std::size_t pcount = processers_.size();
+    for (std::size_t i = 0; i < pcount; ++i) {
+        auto p = processers_[i];
+        if (p == thief || !p->active_) continue;
+
+        std::size_t load = p->RunnableSize();
+        int distance = topology_.Distance(thief->cpu_, p->cpu_);
+        if (load < (distance == CpuTopology::remote ? kRemoteMinLoad : 2))
+            continue;
+
+        if (distance < victimDistance || (distance == victimDistance && load > victimLoad)) {
+            victim = p;
+            victimDistance = distance;
+            victimLoad = load;
+        }
+    }
+
+    if (!victim) return;
+
+    auto tasks = victim->Steal((std::min<std::size_t>)(victimLoad / 2, 1024));
+    if (!tasks.empty()) {
+        DebugPrint(dbg_scheduler, "Processer(%d) steal %d tasks from processer(%d) distance=%d",
+                thief->id_, (int)tasks.size(), victim->id_, victimDistance);
+        thief->AddTask(std::move(tasks));
+    }
 }
 
 void Scheduler::DispatcherThread()
@@ -180,6 +688,8 @@ void Scheduler::DispatcherThread()
         // TODO: 用condition_variable降低cpu使用率
         std::this_thread::sleep_for(std::chrono::microseconds(CoroutineOptions::getInstance().dispatcher_thread_cycle_us));
 
+        UpdateAdmission();
+
         // 1.收集负载值, 收集阻塞状态, 打阻塞标记, 唤醒处于等待状态但是有任务的P
         idx_t pcount = processers_.size();
         std::size_t totalLoadaverage = 0;
@@ -190,12 +700,20 @@ void Scheduler::DispatcherThread()
         int isActiveCount = 0;
         for (std::size_t i = 0; i < pcount; i++) {
             auto p = processers_[i];
+            if (p->retired_)
+                continue;
+
             if (p->IsBlocking()) {
                 blockings[i] = p->RunnableSize();
                 if (p->active_) {
                     p->active_ = false;
                     DebugPrint(dbg_scheduler, "Block processer(%d)", (int)i);
                 }
+
+                if (BlockingWatchdog::IsEnabled() && p->watchdogSwitch_ != p->markSwitch_) {
+                    p->watchdogSwitch_ = p->markSwitch_;
+                    BlockingWatchdog::getInstance().Capture(p);
+                }
             }
 
             if (p->active_)
@@ -207,6 +725,9 @@ void Scheduler::DispatcherThread()
 
         for (std::size_t i = 0; i < pcount; i++) {
             auto p = processers_[i];
+            if (p->retired_)
+                continue;
+
             std::size_t loadaverage = p->RunnableSize();
             totalLoadaverage += loadaverage;
 
@@ -229,11 +750,10 @@ void Scheduler::DispatcherThread()
             }
         }
 
-        if (actives.empty() && (int)pcount < maxThreadNumber_) {
+        if (actives.empty() && runningProcessers_ < maxThreadNumber_) {
             // 全部阻塞, 并且还有协程待执行, 起新线程
-            NewProcessThread();
-            actives.insert(ActiveMap::value_type{0, pcount});
-            ++pcount;
+            Processer* p = NewProcessThread();
+            actives.insert(ActiveMap::value_type{0, (idx_t)p->id_});
         }
 
         // 全部阻塞并且不能起新线程, 无需调度, 等待即可
@@ -249,6 +769,8 @@ void Scheduler::DispatcherThread()
                 tasks.append(p->Steal(0));
             }
             if (!tasks.empty()) {
+                GroupByAffinity(tasks);
+
                 // 任务最少的几个线程平均分
                 auto range = actives.equal_range(actives.begin()->first);
                 std::size_t avg = tasks.size() / std::distance(range.first, range.second);
@@ -262,7 +784,7 @@ void Scheduler::DispatcherThread()
 
 
                 for (auto it = range.first; it != range.second; ++it) {
-                    SList<Task> in = tasks.cut(avg);
+                    SList<Task> in = CutTasks(tasks, avg);
                     if (in.empty())
                         break;
 
@@ -290,18 +812,25 @@ void Scheduler::DispatcherThread()
                 continue;
             }
 
+            if (!topology_.Empty()) {
+                for (auto it = range.first; it != range.second; ++it)
+                    StealByTopology(processers_[it->second]);
+                continue;
+            }
+
             auto maxP = processers_[actives.rbegin()->second];
             std::size_t stealN = std::min(maxP->RunnableSize() / 2, waitN * 1024);
             auto tasks = maxP->Steal(stealN);
             if (tasks.empty())
                 continue;
 
+            GroupByAffinity(tasks);
             std::size_t avg = tasks.size() / waitN;
             if (avg == 0)
                 avg = 1;
 
             for (auto it = range.first; it != range.second; ++it) {
-                SList<Task> in = tasks.cut(avg);
+                SList<Task> in = CutTasks(tasks, avg);
                 if (in.empty())
                     break;
 
@@ -323,21 +852,64 @@ void Scheduler::AddTask(Task* tk)
         return ;
     }
 
+    // 亲和组: 放到同组协程所在的P上
+    if (UNLIKELY(tk->affinityKey_)) {
+        proc = AffinitySlot(tk->affinityKey_).load(std::memory_order_relaxed);
+        if (proc && proc->active_ && !proc->retired_) {
+            proc->AddTask(tk);
+            return ;
+        }
+    }
+
     proc = Processer::GetCurrentProcesser();
-    if (proc && proc->active_ && proc->GetScheduler() == this) {
-        proc->AddTask(tk);
-        return ;
+    if (!proc || !proc->active_ || proc->GetScheduler() != this) {
+        std::size_t pcount = processers_.size();
+        std::size_t idx = lastActive_;
+        for (std::size_t i = 0; i < pcount; ++i, ++idx) {
+            idx = idx % pcount;
+            proc = processers_[idx];
+            if (proc && proc->active_)
+                break;
+        }
     }
 
-    std::size_t pcount = processers_.size();
-    std::size_t idx = lastActive_;
-    for (std::size_t i = 0; i < pcount; ++i, ++idx) {
-        idx = idx % pcount;
-        proc = processers_[idx];
-        if (proc && proc->active_)
+    if (UNLIKELY(tk->affinityKey_))
+        AffinitySlot(tk->affinityKey_).store(proc, std::memory_order_relaxed);
+    proc->AddTask(tk);
+}
+
+void Scheduler::GroupByAffinity(SList<Task> & tasks)
+{
+    // 按亲和槽归类, 没有亲和组的协程放在最后
+    std::map<std::size_t, SList<Task>> groups;
+    SList<Task> others;
+    while (Task* tk = tasks.pop_front()) {
+        if (tk->affinityKey_)
+            groups[AffinitySlotIndex(tk->affinityKey_)].push_back(tk);
+        else
+            others.push_back(tk);
+    }
+
+    for (auto & kv : groups)
+        tasks.append(std::move(kv.second));
+    tasks.append(std::move(others));
+}
+
+SList<Task> Scheduler::CutTasks(SList<Task> & tasks, std::size_t n)
+{
+    SList<Task> in = tasks.cut(n);
+    Task* last = (Task*)in.tail();
+    if (!last || !last->affinityKey_)
+        return in;
+
+    std::size_t slot = AffinitySlotIndex(last->affinityKey_);
+    while (tasks.head()) {
+        Task* tk = (Task*)tasks.head();
+        if (!tk->affinityKey_ || AffinitySlotIndex(tk->affinityKey_) != slot)
             break;
+        in.push_back(tasks.pop_front());
     }
-    proc->AddTask(tk);
+    return in;
 }
 
 uint32_t Scheduler::TaskCount()
@@ -364,6 +936,76 @@ void Scheduler::SetCurrentTaskDebugInfo(std::string const& info)
     TaskRefDebugInfo(tk) = info;
 }
 
+std::vector<TaskCpuInfo> Scheduler::TopTasksByCpu(std::size_t n)
+{
+    std::vector<TaskCpuInfo> result;
+    std::size_t pcount = processers_.size();
+    for (std::size_t i = 0; i < pcount; i++)
+        processers_[i]->CollectTaskCpuInfo(result);
+
+    n = (std::min)(n, result.size());
+    std::partial_sort(result.begin(), result.begin() + n, result.end(),
+            [](TaskCpuInfo const& lhs, TaskCpuInfo const& rhs) {
+                return lhs.cpuNs_ > rhs.cpuNs_;
+            });
+    result.resize(n);
+    return result;
+}
+
+std::size_t Scheduler::RunningProcesserCount()
+{
+    return runningProcessers_;
+}
+
+std::size_t Scheduler::ProcesserCount()
+{
+    return processers_.size();
+}
+
+Histogram Scheduler::GetRunQueueLatency(int procId)
+{
+    Histogram hist;
+    std::size_t pcount = processers_.size();
+    for (std::size_t i = 0; i < pcount; i++)
+        if (procId < 0 || (int)i == procId)
+            hist.Merge(processers_[i]->GetRunQueueLatency());
+    return hist;
+}
+
+Histogram Scheduler::GetWaitTime(eSuspendReason reason, int procId)
+{
+    Histogram hist;
+    if (reason >= eSuspendReason::count)
+        return hist;
+
+    std::size_t pcount = processers_.size();
+    for (std::size_t i = 0; i < pcount; i++)
+        if (procId < 0 || (int)i == procId)
+            hist.Merge(processers_[i]->GetWaitTime(reason));
+    return hist;
+}
+
+std::vector<LocationCpuInfo> Scheduler::TopLocationsByCpu(std::size_t n, bool window)
+{
+    std::map<SourceLocation, LocationCpuInfo> locations;
+    std::size_t pcount = processers_.size();
+    for (std::size_t i = 0; i < pcount; i++)
+        processers_[i]->CollectLocationCpuInfo(locations);
+
+    std::vector<LocationCpuInfo> result;
+    result.reserve(locations.size());
+    for (auto & kv : locations)
+        result.push_back(kv.second);
+
+    n = (std::min)(n, result.size());
+    std::partial_sort(result.begin(), result.begin() + n, result.end(),
+            [=](LocationCpuInfo const& lhs, LocationCpuInfo const& rhs) {
+                return window ? lhs.windowCpuNs_ > rhs.windowCpuNs_ : lhs.cpuNs_ > rhs.cpuNs_;
+            });
+    result.resize(n);
+    return result;
+}
+
 //bool Scheduler::CancelTimer(TimerId timer_id)
 //{
 //    bool ok = timer_mgr_.Cancel(timer_id);
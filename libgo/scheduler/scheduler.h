@@ -6,6 +6,9 @@
 #include "../task/task.h"
 #include "../debug/listener.h"
 #include "processer.h"
+#include "sched_group.h"
+#include "cpu_topology.h"
+#include "cancel_token.h"
 #include <mutex>
 
 namespace co {
@@ -13,17 +16,54 @@ namespace co {
 struct TaskOpt
 {
     bool affinity_ = false;
+    int priority_ = priority_normal;
+    SchedulingGroup* group_ = nullptr;
+    uint64_t affinityKey_ = 0;
+    FastSteadyClock::time_point deadline_{};
+    CancelToken cancel_;
     int lineno_ = 0;
     std::size_t stack_size_ = 0;
+    bool light_ = false;
     const char* file_ = nullptr;
 };
 
+// 准入控制拒绝创建协程的原因
+enum class eAdmissionReject : int
+{
+    task_limit,     // 调度器的协程数达到上限
+    group_limit,    // 调度组的协程数达到上限
+    queue_delay,    // 排队延迟持续超过目标值
+    count,
+};
+
+const char* GetAdmissionRejectName(eAdmissionReject reason);
+
+// 准入控制(过载保护)选项
+// 过载时go直接失败, 不再无限制地创建协程: 设置了onReject_时调用它(可以同步执行、返回错误等),
+// 否则抛出co_exception(ec_overloaded).
+struct AdmissionOpt
+{
+    // 协程数上限, 0表示不限制
+    uint32_t maxTasks_ = 0;
+
+    // 排队延迟目标(类似CoDel): 所有P的排队延迟都超过targetDelayUs_并持续intervalUs_后开始拒绝,
+    // 降到目标以下时恢复. 0表示不限制
+    uint32_t targetDelayUs_ = 0;
+    uint32_t intervalUs_ = 100 * 1000;
+
+    // 过载时hook的accept暂停接收新连接(连接留在内核的backlog中), 恢复后继续
+    bool pauseAccept_ = false;
+
+    std::function<void(TaskF const& fn, eAdmissionReject reason)> onReject_;
+};
+
 // 协程调度器
 // 负责管理1到N个调度线程, 调度从属协程.
 // 可以调用Create接口创建更多额外的调度器
 class Scheduler
 {
     friend class Processer;
+    friend class CoDebugger;
 
 public:
     ALWAYS_INLINE static Scheduler& getInstance();
@@ -31,7 +71,23 @@ public:
     static Scheduler* Create();
 
     // 创建一个协程
-    void CreateTask(TaskF const& fn, TaskOpt const& opt);
+    // 被准入控制拒绝时返回false(没有设置拒绝回调时抛出异常)
+    bool CreateTask(TaskF const& fn, TaskOpt const& opt);
+
+    // 批量创建协程
+    // 按P分区后每个P只加一次锁、唤醒一次, 大量扇出时比逐个创建快.
+    // 准入控制按整批判断: 被拒绝时整批计入拒绝数, 拒绝回调只调用一次,
+    // 参数是依次执行整批协程函数的TaskF.
+    // @gen: 返回第i个协程的执行函数
+    bool CreateTasks(std::size_t n, std::function<TaskF(std::size_t)> const& gen, TaskOpt const& opt);
+    bool CreateTasks(std::vector<TaskF> const& fns, TaskOpt const& opt);
+
+    // 在一个空闲(等待协程)的P上创建协程, 用于把工作拆分给空闲的P.
+    // 没有空闲的P或被准入控制拒绝时不创建, 返回false(计入拒绝数, 但不调用拒绝回调).
+    bool CreateTaskOnIdle(TaskF const& fn, TaskOpt const& opt);
+
+    // 空闲(等待协程)的P的数量
+    std::size_t IdleProcesserCount();
 
     // 当前是否处于协程中
     bool IsCoroutine();
@@ -47,6 +103,13 @@ public:
     void Start(int minThreadNumber = 1, int maxThreadNumber = 0);
     static const int s_ulimitedMaxThreadNumber = 40960;
 
+    // 指定调度线程绑定的CPU列表(在Start前调用), P按CPU拓扑排序后依次绑定.
+    // 不调用时, 开启enable_cpu_affinity则使用当前进程cpuset中的所有CPU.
+    void SetCpuList(std::vector<int> const& cpus);
+
+    // 绑定CPU时使用的拓扑, 未绑定时为空
+    CpuTopology const& GetCpuTopology() { return topology_; }
+
     // 停止调度 
     // 注意: 停止后无法恢复, 仅用于安全退出main函数, 不保证终止所有线程.
     //       如果某个调度线程被协程阻塞, 必须等待阻塞结束才能退出.
@@ -67,6 +130,43 @@ public:
     // 设置当前协程调试信息, 打印调试信息时将回显
     void SetCurrentTaskDebugInfo(std::string const& info);
 
+    // 按累计CPU时间排序的前N个协程(包括正在运行中的这一次)
+    std::vector<TaskCpuInfo> TopTasksByCpu(std::size_t n);
+
+    // 按go语句位置聚合, 按CPU时间排序的前N个位置(需开启enable_coro_stat)
+    // @window: 为true时按最近LocationCpuStat::kWindowMs毫秒内的CPU时间排序,
+    //          否则按累计CPU时间排序.
+    std::vector<LocationCpuInfo> TopLocationsByCpu(std::size_t n, bool window = false);
+
+    // 调度线程(P)的数量(包括已退役的P)
+    std::size_t ProcesserCount();
+
+    // 正在运行的调度线程数量(不包括已退役的P)
+    std::size_t RunningProcesserCount();
+
+    // 调度延迟直方图(从唤醒到切入执行, 单位: 纳秒, 需开启enable_coro_stat)
+    // @procId: 指定P的ID, -1表示汇总整个调度器
+    Histogram GetRunQueueLatency(int procId = -1);
+
+    // 按挂起原因分类的等待时长直方图(从挂起到唤醒, 单位: 纳秒, 需开启enable_coro_stat)
+    // @procId: 指定P的ID, -1表示汇总整个调度器
+    Histogram GetWaitTime(eSuspendReason reason, int procId = -1);
+
+    // 设置准入控制, 默认不限制
+    void SetAdmission(AdmissionOpt const& opt);
+
+    // 是否过载(新创建的协程会被拒绝), 可用于接收新请求的循环暂停接收
+    bool IsOverloaded();
+
+    // 排队延迟的估计值(微秒): 各P最近一轮调度(队列中的协程各执行一次)时长的最小值
+    uint32_t QueueDelayUs();
+
+    // 被准入控制拒绝的协程数
+    uint64_t RejectedCount(eAdmissionReject reason);
+
+    // 开启pauseAccept_时, 过载期间挂起当前协程直到恢复(由hook的accept调用)
+    void WaitAdmission();
+
     typedef Timer<std::function<void()>> TimerType;
 
 public:
@@ -81,8 +181,40 @@ private:
     Scheduler& operator=(Scheduler const&) = delete;
     Scheduler& operator=(Scheduler &&) = delete;
 
+    static const std::size_t kCreateTasksChunk = 256;
+
+    // 准入检查, 拒绝时返回false
+    ALWAYS_INLINE bool Admit(TaskOpt const& opt, std::size_t n, eAdmissionReject & reason)
+    {
+        if (LIKELY(!maxTasks_ && !targetDelayUs_ && !opt.group_))
+            return true;
+        return DoAdmit(opt, n, reason);
+    }
+
+    bool DoAdmit(TaskOpt const& opt, std::size_t n, eAdmissionReject & reason);
+
+    // 拒绝创建协程: 计数后调用拒绝回调或抛出异常
+    void Reject(TaskF const& fn, eAdmissionReject reason, std::size_t n = 1);
+
+    // 记录被拒绝的协程数
+    void CountReject(eAdmissionReject reason, std::size_t n);
+
+    // 更新排队延迟的过载状态(最多每毫秒执行一次)
+    // 由dispatcher线程每个周期调用, 没有dispatcher线程时(单线程调度)由准入检查调用
+    void UpdateAdmission();
+
+    // 创建协程对象, 不加入队列
+    Task* NewTask(TaskF const& fn, TaskOpt const& opt, unsigned long long id);
+
     static void DeleteTask(RefObject* tk, void* arg);
 
+    // 遍历所有已创建的调度器
+    // 遍历期间持有注册表的锁, 调度器析构时要先从注册表中移除, 所以fn中访问调度器是安全的.
+    static void ForeachScheduler(std::function<void(Scheduler*)> const& fn);
+
+    // 向Metrics注册调度器相关的指标(只执行一次)
+    static void RegisterMetrics();
+
     // 将一个协程加入可执行队列中
     void AddTask(Task* tk);
 
@@ -91,7 +223,43 @@ private:
     // 2.侦测到阻塞的P(单个协程运行时间超过阀值), 将P中的其他协程steal给其他P
     void DispatcherThread();
 
-    void NewProcessThread();
+    // 启动一个新的调度线程, 优先重新启用已退役的P
+    Processer* NewProcessThread();
+
+    // 空闲的P请求退役, 线程数不能少于minThreadNumber_, 等待队列中有亲和性协程的P不退役
+    // @idleUs: P已经连续空闲的时长
+    bool TryRetire(Processer* p, int64_t idleUs);
+
+    // 选择一个可以接收协程的P(负载最小的激活态P), 用于转交退役P的协程
+    Processer* SelectProcesser(Processer* except);
+
+    // 亲和组的key映射到亲和槽, 槽中记录同组协程所在的P(key冲突的组视为同一组)
+    static const std::size_t kAffinitySlots = 4096;
+
+    ALWAYS_INLINE static std::size_t AffinitySlotIndex(uint64_t key)
+    {
+        return (std::size_t)((key * 0x9E3779B97F4A7C15ull) >> 52);
+    }
+
+    ALWAYS_INLINE std::atomic<Processer*> & AffinitySlot(uint64_t key)
+    {
+        return affinitySlots_[AffinitySlotIndex(key)];
+    }
+
+    // 把同一亲和组的协程排列在一起
+    static void GroupByAffinity(SList<Task> & tasks);
+
+    // 从tasks头部切出至少n个协程, 不拆开亲和组
+    static SList<Task> CutTasks(SList<Task> & tasks, std::size_t n);
+
+    // 加载CPU拓扑, 决定各个P绑定的CPU
+    void InitCpuAffinity();
+
+    // 第id个P绑定的CPU, 不绑定时返回-1
+    int CpuOfProcesser(int id);
+
+    // 空闲的P按拓扑由近到远选择被偷的P
+    void StealByTopology(Processer* thief);
 
     TimerType & StaticGetTimer();
 
@@ -102,6 +270,9 @@ private:
 
     atomic_t<uint32_t> taskCount_{0};
 
+    // 协程槽位表, 挂起标识通过它唤醒协程
+    TaskTable taskTable_;
+
     volatile uint32_t lastActive_ = 0;
 
     TimerType *timer_ = nullptr;
@@ -109,8 +280,29 @@ private:
     int minThreadNumber_ = 1;
     int maxThreadNumber_ = 1;
 
+    // 正在运行的调度线程数量
+    atomic_t<int> runningProcessers_{0};
+
+    std::atomic<Processer*> affinitySlots_[kAffinitySlots];
+
     std::shared_ptr<bool> stop_;
 
+    std::vector<int> cpuList_;
+    CpuTopology topology_;
+
+    // 准入控制
+    volatile uint32_t maxTasks_ = 0;
+    volatile uint32_t targetDelayUs_ = 0;
+    volatile uint32_t intervalUs_ = 0;
+    volatile bool pauseAccept_ = false;
+    volatile bool delayOverloaded_ = false;
+    int64_t delayAboveSince_ = 0;
+    int64_t delayUpdateTime_ = 0;
+    LFLock delayUpdateLock_;
+    LFLock admissionLock_;
+    std::function<void(TaskF const&, eAdmissionReject)> onReject_;
+    atomic_t<uint64_t> rejected_[(int)eAdmissionReject::count];
+
     // ------------- 兼容旧版架构接口 -------------
 public:
 //    // 调度器调度函数, 内部执行协程、调度协程
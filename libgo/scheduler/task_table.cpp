@@ -0,0 +1,41 @@
+#include "task_table.h"
+
+namespace co
+{
+
+TaskSlot* TaskTable::Alloc(Task* tk)
+{
+    TaskSlot* slot;
+    {
+        std::unique_lock<LFLock> lock(lock_);
+        if (!freeList_) {
+            TaskSlot* chunk = new TaskSlot[kChunkSize];
+            for (std::size_t i = 0; i + 1 < kChunkSize; ++i)
+                chunk[i].nextFree_ = &chunk[i + 1];
+            freeList_ = chunk;
+        }
+        slot = freeList_;
+        freeList_ = slot->nextFree_;
+    }
+
+    slot->nextFree_ = nullptr;
+    slot->tk_ = tk;
+    slot->taskId_.store(tk->id_, std::memory_order_release);
+    return slot;
+}
+
+void TaskTable::Free(TaskSlot* slot)
+{
+    if (!slot) return ;
+
+    // 协程结束时一定不在挂起状态
+    assert((slot->state_ & 1) == 0);
+    slot->taskId_.store(0, std::memory_order_release);
+    slot->tk_ = nullptr;
+
+    std::unique_lock<LFLock> lock(lock_);
+    slot->nextFree_ = freeList_;
+    freeList_ = slot;
+}
+
+} // namespace co
@@ -0,0 +1,47 @@
+#pragma once
+#include "../common/config.h"
+#include "../common/spinlock.h"
+#include "../task/task.h"
+#include <atomic>
+
+namespace co
+{
+
+// 协程槽位
+// 协程创建时从所属调度器的TaskTable分配, 销毁时归还. 槽位的内存从不释放,
+// 挂起标识(SuspendEntry)记录槽位地址和挂起序号, 协程销毁后仍然可以安全地访问槽位.
+struct TaskSlot
+{
+    // 挂起序号: 奇数表示槽位中的协程处于挂起状态. 槽位被后续协程复用时继续递增,
+    // 所以(槽位, 序号)唯一标识一次挂起, 唤醒只需要对它做一次CAS.
+    std::atomic<uint64_t> state_{0};
+
+    // 占用槽位的协程的id(空闲时为0), 用于确认槽位没有被其他协程复用
+    std::atomic<uint64_t> taskId_{0};
+
+    // 占用槽位的协程, 只有挂起序号为奇数(协程一定存活)时才能访问
+    Task* volatile tk_ = nullptr;
+
+    // 最近一次挂起的原因
+    volatile eSuspendReason reason_ = eSuspendReason::user;
+
+    TaskSlot* nextFree_ = nullptr;
+};
+
+// 协程槽位表(每个调度器一个)
+// 槽位按块分配, 不移动也不释放, 归还的槽位通过空闲链表复用.
+class TaskTable
+{
+public:
+    TaskSlot* Alloc(Task* tk);
+
+    void Free(TaskSlot* slot);
+
+private:
+    static const std::size_t kChunkSize = 1024;
+
+    LFLock lock_;
+    TaskSlot* freeList_ = nullptr;
+};
+
+} // namespace co
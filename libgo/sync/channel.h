@@ -130,7 +130,8 @@ private:
 
     public:
         explicit ChannelImpl(std::size_t capacity)
-            : capacity_(capacity), closed_(false), dbg_mask_(dbg_all)
+            : capacity_(capacity), closed_(false), dbg_mask_(dbg_all),
+            wCv_(eSuspendReason::channel), rCv_(eSuspendReason::channel)
         {
             DebugPrint(dbg_mask_ & dbg_channel, "[id=%ld] Channel init. capacity=%lu", this->getId(), capacity);
         }
@@ -165,6 +166,10 @@ private:
                     deadline == FastSteadyClock::time_point{} ? 0 :
                     (long)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - FastSteadyClock::now()).count());
 
+            // 不超过当前协程的截止时间
+            if (bWait)
+                deadline = Processer::ClampDeadline(deadline);
+
             std::unique_lock<LFLock> lock(lock_);
 retry:
             if (closed_) {
@@ -175,6 +180,7 @@ retry:
             if (capacity_ > 0) {
                 if (queue_.size() < capacity_) {
                     queue_.emplace_back(t);
+                    Metrics::Inc(eMetric::channel_sends);
                     bool notified = rCv_.notify_one();
                     DebugPrint(dbg_mask_ & dbg_channel, "[id=%ld] Push return true, with capacity. size=%d, Notify=%d",
                             this->getId(), (int)queue_.size(), (int)notified);
@@ -184,14 +190,17 @@ retry:
                 // 无缓冲
                 if (rCv_.notify_one()) {
                     queue_.emplace_back(t);
+                    Metrics::Inc(eMetric::channel_sends);
                     DebugPrint(dbg_mask_ & dbg_channel, "[id=%ld] Push return true, zero capacity. Notified=1", this->getId());
                     return true;
                 }
             }
                 
-            if (bWait && (deadline == FastSteadyClock::time_point{} || deadline > FastSteadyClock::now())) {
+            if (bWait && !Processer::IsCancelled() &&
+                    (deadline == FastSteadyClock::time_point{} || deadline > FastSteadyClock::now())) {
                 auto fn = [this, t]{
                     queue_.emplace_back(t);
+                    Metrics::Inc(eMetric::channel_sends);
                 };
 
                 if (deadline == FastSteadyClock::time_point{}) {
@@ -218,11 +227,15 @@ retry:
                     deadline == FastSteadyClock::time_point{} ? 0 :
                     (long)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - FastSteadyClock::now()).count());
 
+            if (bWait)
+                deadline = Processer::ClampDeadline(deadline);
+
             std::unique_lock<LFLock> lock(lock_);
 retry:
             if (!queue_.empty()) {
                 t = queue_.front();
                 queue_.pop_front();
+                Metrics::Inc(eMetric::channel_recvs);
                 int notified = wCv_.notify_one();
                 DebugPrint(dbg_mask_ & dbg_channel, "[id=%ld] Pop return true, with capacity. size=%d, Notify=%d",
                         this->getId(), (int)queue_.size() + 1, notified);
@@ -238,11 +251,13 @@ retry:
             if (wCv_.notify_one()) {
                 t = queue_.front();
                 queue_.pop_front();
+                Metrics::Inc(eMetric::channel_recvs);
                 DebugPrint(dbg_mask_ & dbg_channel, "[id=%ld] Pop return true, Zero capacity. Notified=1", this->getId());
                 return true;
             }
 
-            if (bWait && (deadline == FastSteadyClock::time_point{} || deadline > FastSteadyClock::now())) {
+            if (bWait && !Processer::IsCancelled() &&
+                    (deadline == FastSteadyClock::time_point{} || deadline > FastSteadyClock::now())) {
                 if (deadline == FastSteadyClock::time_point{}) {
                     rCv_.wait(lock);
                     goto retry;
@@ -4,7 +4,8 @@
 namespace co
 {
 
-ConditionVariableAny::ConditionVariableAny()
+ConditionVariableAny::ConditionVariableAny(eSuspendReason reason)
+    : reason_(reason)
 {
     checkIter_ = queue_.begin();
 }
@@ -35,8 +35,11 @@ class ConditionVariableAny
     // 兼容原生线程
     std::condition_variable_any cv_;
 
+    // 协程挂起的原因(用于统计)
+    eSuspendReason reason_;
+
 public:
-    ConditionVariableAny();
+    explicit ConditionVariableAny(eSuspendReason reason = eSuspendReason::condvar);
     ~ConditionVariableAny();
 
     bool notify_one();
@@ -51,13 +54,15 @@ public:
 
         if (Processer::IsCoroutine()) {
             // 协程
-            entry.suspendEntry = Processer::Suspend();
+            entry.suspendEntry = Processer::Suspend(reason_);
             AddWaiter(entry);
             lock.unlock();
             Processer::StaticCoYield();
             lock.lock();
         } else {
             // 原生线程
+            if (UNLIKELY(Processer::IsRunningLight()))
+                Processer::OnBlockInLight("condition_variable wait");
             AddWaiter(entry);
             cv_.wait(lock);
         }
@@ -72,13 +77,15 @@ public:
 
         if (Processer::IsCoroutine()) {
             // 协程
-            entry.suspendEntry = Processer::Suspend(duration);
+            entry.suspendEntry = Processer::Suspend(duration, reason_);
             AddWaiter(entry);
             lock.unlock();
             Processer::StaticCoYield();
             lock.lock();
         } else {
             // 原生线程
+            if (UNLIKELY(Processer::IsRunningLight()))
+                Processer::OnBlockInLight("condition_variable wait");
             AddWaiter(entry);
             cv_.wait_for(lock, duration);
         }
@@ -93,13 +100,15 @@ public:
 
         if (Processer::IsCoroutine()) {
             // 协程
-            entry.suspendEntry = Processer::Suspend(timepoint);
+            entry.suspendEntry = Processer::Suspend(timepoint, reason_);
             AddWaiter(entry);
             lock.unlock();
             Processer::StaticCoYield();
             lock.lock();
         } else {
             // 原生线程
+            if (UNLIKELY(Processer::IsRunningLight()))
+                Processer::OnBlockInLight("condition_variable wait");
             AddWaiter(entry);
             cv_.wait_until(lock, timepoint);
         }
@@ -4,7 +4,7 @@
 namespace co
 {
 
-CoMutex::CoMutex() : isLocked_(false)
+CoMutex::CoMutex() : isLocked_(false), cv_(eSuspendReason::mutex)
 {
 }
 
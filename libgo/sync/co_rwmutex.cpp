@@ -5,6 +5,7 @@ namespace co
 {
 
 CoRWMutex::CoRWMutex(bool writePriority)
+    : rCv_(eSuspendReason::mutex), wCv_(eSuspendReason::mutex)
 {
     lockState_ = 0;
     writePriority_ = writePriority;
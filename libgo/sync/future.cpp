@@ -0,0 +1,131 @@
+#include "future.h"
+
+namespace co
+{
+
+namespace
+{
+    // 等待者: 协程通过SuspendEntry唤醒, 原生线程通过条件变量唤醒
+    struct FutureWaiter : public FutureCallback
+    {
+        Processer::SuspendEntry entry_;
+
+        std::mutex mtx_;
+        std::condition_variable cv_;
+        bool notified_ = false;
+
+        // OnReady执行完毕, 之后等待者才能离开(回调节点在等待者的栈上)
+        std::atomic<bool> done_{false};
+
+        void OnReady() override
+        {
+            if (entry_) {
+                Processer::Wakeup(entry_);
+            } else {
+                std::unique_lock<std::mutex> lock(mtx_);
+                notified_ = true;
+                cv_.notify_one();
+            }
+            done_.store(true, std::memory_order_release);
+        }
+    };
+} // namespace
+
+void FutureStateBase::AddCallback(FutureCallback* cb)
+{
+    {
+        std::unique_lock<LFLock> lock(lock_);
+        if (status_.load(std::memory_order_relaxed) == pending) {
+            cb->next_ = callbacks_;
+            callbacks_ = cb;
+            return ;
+        }
+    }
+
+    cb->OnReady();
+}
+
+bool FutureStateBase::RemoveCallback(FutureCallback* cb)
+{
+    std::unique_lock<LFLock> lock(lock_);
+    for (FutureCallback** pos = &callbacks_; *pos; pos = &(*pos)->next_) {
+        if (*pos == cb) {
+            *pos = cb->next_;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FutureStateBase::Wait(FastSteadyClock::time_point deadline)
+{
+    if (IsReady())
+        return true;
+
+    FutureWaiter waiter;
+    if (Processer::IsCoroutine()) {
+        if (deadline == FastSteadyClock::time_point{})
+            waiter.entry_ = Processer::Suspend(eSuspendReason::future);
+        else
+            waiter.entry_ = Processer::Suspend(deadline, eSuspendReason::future);
+        AddCallback(&waiter);
+        Processer::StaticCoYield();
+    } else {
+        if (UNLIKELY(Processer::IsRunningLight()))
+            Processer::OnBlockInLight("future wait");
+        AddCallback(&waiter);
+        std::unique_lock<std::mutex> lock(waiter.mtx_);
+        if (deadline == FastSteadyClock::time_point{})
+            waiter.cv_.wait(lock, [&]{ return waiter.notified_; });
+        else
+            waiter.cv_.wait_until(lock, deadline, [&]{ return waiter.notified_; });
+    }
+
+    // 超时或被打断时注销回调; 回调已经被取走时等它执行完
+    if (!RemoveCallback(&waiter))
+        while (!waiter.done_.load(std::memory_order_acquire)) ;
+
+    return IsReady();
+}
+
+void FutureStateBase::SetException(std::exception_ptr e)
+{
+    Claim();
+    exception_ = e;
+    MarkReady(exception);
+}
+
+void FutureStateBase::Claim()
+{
+    if (satisfied_.exchange(true, std::memory_order_acq_rel))
+        ThrowError(eCoErrorCode::ec_promise_already_satisfied);
+}
+
+void FutureStateBase::MarkReady(eStatus status)
+{
+    FutureCallback* list;
+    {
+        std::unique_lock<LFLock> lock(lock_);
+        status_.store(status, std::memory_order_release);
+        list = callbacks_;
+        callbacks_ = nullptr;
+    }
+
+    // 按注册顺序调用
+    FutureCallback* ordered = nullptr;
+    while (list) {
+        FutureCallback* next = list->next_;
+        list->next_ = ordered;
+        ordered = list;
+        list = next;
+    }
+
+    while (ordered) {
+        // 回调可能释放自身, 先取出后继
+        FutureCallback* next = ordered->next_;
+        ordered->OnReady();
+        ordered = next;
+    }
+}
+
+} //namespace co
@@ -0,0 +1,409 @@
+#pragma once
+#include "../common/config.h"
+#include "../common/error.h"
+#include "../common/spinlock.h"
+#include "../scheduler/processer.h"
+#include <condition_variable>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace co
+{
+
+// 结果就绪时的回调(侵入式链表节点)
+struct FutureCallback
+{
+    FutureCallback* next_ = nullptr;
+
+    virtual ~FutureCallback() {}
+
+    // 结果就绪后调用一次: 在设置结果的线程中执行, 注册时已经就绪则在注册的线程中执行
+    virtual void OnReady() = 0;
+};
+
+/// Promise/Future的共享状态中与结果类型无关的部分
+// 一个Promise/Future对只分配这一个对象: 引用计数、回调链表和结果都在其中.
+class FutureStateBase : public RefObject
+{
+public:
+    enum eStatus : uint8_t
+    {
+        pending,
+        value,
+        exception,
+    };
+
+    bool IsReady() const {
+        return status_.load(std::memory_order_acquire) != pending;
+    }
+
+    bool HasException() const {
+        return status_.load(std::memory_order_acquire) == exception;
+    }
+
+    std::exception_ptr const& GetException() const { return exception_; }
+
+    // 注册回调, 已经就绪时立即调用
+    void AddCallback(FutureCallback* cb);
+
+    // 注销还没有调用的回调, 返回false表示回调已经(或正在)被调用
+    bool RemoveCallback(FutureCallback* cb);
+
+    // 等待就绪: 协程中挂起当前协程, 原生线程中阻塞线程.
+    // @deadline: time_point{}表示不限时
+    // @returns: 是否就绪. 超时, 或协程的截止时间到期、被取消时返回false.
+    bool Wait(FastSteadyClock::time_point deadline = FastSteadyClock::time_point{});
+
+    void SetException(std::exception_ptr e);
+
+    // 结果是否已经(或正在)被设置
+    bool IsSatisfied() const { return satisfied_; }
+
+protected:
+    // 占有写入结果的权利, 只有第一次调用成功, 之后抛出ec_promise_already_satisfied
+    void Claim();
+
+    // 结果已经写入, 发布状态并调用所有回调
+    void MarkReady(eStatus status);
+
+private:
+    LFLock lock_;
+    std::atomic<uint8_t> status_{pending};
+    std::atomic<bool> satisfied_{false};
+    std::exception_ptr exception_;
+
+    // 按注册顺序的逆序链接, 就绪时反转后调用
+    FutureCallback* callbacks_ = nullptr;
+};
+
+// Future<void>的结果
+struct FutureVoid {};
+
+template <typename T>
+struct FutureStorage { typedef T type; };
+
+template <>
+struct FutureStorage<void> { typedef FutureVoid type; };
+
+// 共享状态, 结果直接存放在状态对象内部, 不额外分配
+template <typename T>
+class FutureState : public FutureStateBase
+{
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage_;
+
+public:
+    ~FutureState() {
+        if (IsReady() && !HasException())
+            Value().~T();
+    }
+
+    T& Value() { return *reinterpret_cast<T*>(&storage_); }
+
+    template <typename ... Args>
+    void SetValue(Args && ... args) {
+        Claim();
+        try {
+            new (&storage_) T(std::forward<Args>(args)...);
+        } catch (...) {
+            FutureStateBase::SetException(std::current_exception());
+            return ;
+        }
+        MarkReady(value);
+    }
+};
+
+template <typename T> class Future;
+template <typename T> class Promise;
+
+namespace future_detail
+{
+    template <typename T>
+    struct StateOf { typedef FutureState<typename FutureStorage<T>::type> type; };
+
+    template <typename T, typename R, typename F> struct ThenCallback;
+} // namespace future_detail
+
+/// 轻量级Future
+// 与Channel<R>(1)相比: 只有一次分配(共享状态), 结果存放在状态内部, 没有队列和条件变量.
+// get()在协程中挂起当前协程, 在原生线程中阻塞线程.
+// 与std::future一样, get()只能调用一次, 之后Future变为无效.
+template <typename T>
+class Future
+{
+    friend class Promise<T>;
+    template <typename U, typename R, typename F> friend struct future_detail::ThenCallback;
+    template <typename It> friend Future<void> when_all(It first, It last);
+    template <typename It> friend Future<std::size_t> when_any(It first, It last);
+
+    typedef typename future_detail::StateOf<T>::type State;
+    IncursivePtr<State> state_;
+
+    explicit Future(IncursivePtr<State> const& state) : state_(state) {}
+
+public:
+    typedef T value_type;
+
+    Future() = default;
+    Future(Future && other) = default;
+    Future& operator=(Future && other) = default;
+    Future(Future const&) = delete;
+    Future& operator=(Future const&) = delete;
+
+    bool valid() const { return !!state_; }
+
+    bool is_ready() const { return state_ && state_->IsReady(); }
+
+    // 等待结果就绪. 在协程中被截止时间或取消令牌打断时返回false.
+    bool wait() const { return state_->Wait(); }
+
+    template <typename Rep, typename Period>
+    bool wait_for(std::chrono::duration<Rep, Period> const& dur) const {
+        return state_->Wait(FastSteadyClock::now() +
+                std::chrono::duration_cast<FastSteadyClock::duration>(dur));
+    }
+
+    bool wait_until(FastSteadyClock::time_point timepoint) const {
+        return state_->Wait(timepoint);
+    }
+
+    // 等待并取出结果, Promise设置的异常在这里重新抛出.
+    // 等待被截止时间或取消令牌打断时抛出ec_future_interrupted.
+    // 被打断时Future仍然有效, 可以再次等待.
+    // 栈回退过程中(如析构函数里)调用时无法抛出, 忽略打断一直等到就绪.
+    T get() {
+        if (!state_->Wait()) {
+            ThrowError(eCoErrorCode::ec_future_interrupted);
+            while (!state_->Wait()) ;
+        }
+        IncursivePtr<State> state(std::move(state_));
+        if (state->HasException())
+            std::rethrow_exception(state->GetException());
+        return Take(state);
+    }
+
+    // 注册延续: 结果就绪后以就绪的Future<T>调用f, 返回f的结果的Future.
+    // f在设置结果的线程中执行(已经就绪时立即执行), 不创建协程, 应当短小且不阻塞.
+    template <typename F>
+    Future<typename std::result_of<F(Future<T>)>::type> then(F && f) {
+        typedef typename std::result_of<F(Future<T>)>::type R;
+        auto cb = new future_detail::ThenCallback<T, R, typename std::decay<F>::type>(
+                state_, std::forward<F>(f));
+        Future<R> next = cb->promise_.get_future();
+        IncursivePtr<State> state(std::move(state_));
+        state->AddCallback(cb);
+        return next;
+    }
+
+private:
+    template <typename U = T>
+    static typename std::enable_if<!std::is_void<U>::value, U>::type
+    Take(IncursivePtr<State> const& state) {
+        return std::move(state->Value());
+    }
+
+    template <typename U = T>
+    static typename std::enable_if<std::is_void<U>::value, U>::type
+    Take(IncursivePtr<State> const&) {}
+};
+
+/// 轻量级Promise
+// 只能设置一次结果; 析构时还没有设置结果, 则设置ec_broken_promise异常.
+// set_value/set_exception线程安全, 可以在任意线程中调用.
+template <typename T>
+class Promise
+{
+    typedef typename future_detail::StateOf<T>::type State;
+    IncursivePtr<State> state_;
+    bool retrieved_ = false;
+
+public:
+    Promise() : state_(new State) {
+        // IncursivePtr构造时增加引用计数, 抵消new时的初始计数
+        state_->DecrementRef();
+    }
+
+    Promise(Promise && other) : state_(std::move(other.state_)), retrieved_(other.retrieved_) {}
+
+    Promise& operator=(Promise && other) {
+        if (this != &other) {
+            Abandon();
+            state_ = std::move(other.state_);
+            retrieved_ = other.retrieved_;
+        }
+        return *this;
+    }
+
+    Promise(Promise const&) = delete;
+    Promise& operator=(Promise const&) = delete;
+
+    ~Promise() { Abandon(); }
+
+    Future<T> get_future() {
+        if (retrieved_)
+            ThrowError(eCoErrorCode::ec_future_already_retrieved);
+        retrieved_ = true;
+        return Future<T>(state_);
+    }
+
+    template <typename ... Args>
+    void set_value(Args && ... args) {
+        state_->SetValue(std::forward<Args>(args)...);
+    }
+
+    void set_exception(std::exception_ptr e) {
+        state_->SetException(e);
+    }
+
+private:
+    void Abandon() {
+        if (state_ && !state_->IsSatisfied())
+            state_->SetException(std::make_exception_ptr(
+                        std::system_error(MakeCoErrorCode(eCoErrorCode::ec_broken_promise))));
+    }
+};
+
+namespace future_detail
+{
+    // 用函数的返回值设置Promise, 函数抛出的异常也设置进去
+    template <typename R>
+    struct Setter
+    {
+        template <typename F, typename A>
+        static void Set(Promise<R> & p, F & f, A && a) {
+            try {
+                p.set_value(f(std::forward<A>(a)));
+            } catch (...) {
+                p.set_exception(std::current_exception());
+            }
+        }
+    };
+
+    template <>
+    struct Setter<void>
+    {
+        template <typename F, typename A>
+        static void Set(Promise<void> & p, F & f, A && a) {
+            try {
+                f(std::forward<A>(a));
+                p.set_value();
+            } catch (...) {
+                p.set_exception(std::current_exception());
+            }
+        }
+    };
+
+    template <typename T, typename R, typename F>
+    struct ThenCallback : public FutureCallback
+    {
+        IncursivePtr<typename StateOf<T>::type> src_;
+        Promise<R> promise_;
+        F f_;
+
+        ThenCallback(IncursivePtr<typename StateOf<T>::type> const& src, F && f)
+            : src_(src), f_(std::forward<F>(f)) {}
+
+        void OnReady() override {
+            Setter<R>::Set(promise_, f_, Future<T>(src_));
+            delete this;
+        }
+    };
+
+    // when_all/when_any的汇合点: 每个输入Future一个回调节点, 与汇合状态一起分配.
+    // 所有节点都被调用过之后释放.
+    template <typename R>
+    struct Join
+    {
+        struct Node : public FutureCallback
+        {
+            Join* join_;
+            std::size_t index_;
+
+            void OnReady() override { join_->OnReady(index_); }
+        };
+
+        Promise<R> promise_;
+        std::vector<Node> nodes_;
+        std::atomic<std::size_t> remain_;
+        std::atomic<bool> any_{false};
+
+        explicit Join(std::size_t n) : nodes_(n), remain_{n} {
+            for (std::size_t i = 0; i < n; ++i) {
+                nodes_[i].join_ = this;
+                nodes_[i].index_ = i;
+            }
+        }
+
+        void OnReady(std::size_t index);
+    };
+
+    template <>
+    inline void Join<void>::OnReady(std::size_t)
+    {
+        if (--remain_ == 0) {
+            promise_.set_value();
+            delete this;
+        }
+    }
+
+    template <>
+    inline void Join<std::size_t>::OnReady(std::size_t index)
+    {
+        if (!any_.exchange(true, std::memory_order_acq_rel))
+            promise_.set_value(index);
+        if (--remain_ == 0)
+            delete this;
+    }
+} // namespace future_detail
+
+// 已经就绪的Future
+template <typename T>
+Future<typename std::decay<T>::type> make_ready_future(T && value)
+{
+    Promise<typename std::decay<T>::type> p;
+    p.set_value(std::forward<T>(value));
+    return p.get_future();
+}
+
+inline Future<void> make_ready_future()
+{
+    Promise<void> p;
+    p.set_value();
+    return p.get_future();
+}
+
+// [first, last)中的Future全部就绪(包括设置了异常)时就绪.
+// 不取走输入的Future, 就绪后再逐个get()取结果. 不创建协程, 每个输入只注册一个回调.
+// 输入的Future必须valid, 且在返回的Future就绪之前不能调用它们的get()和then().
+template <typename It>
+Future<void> when_all(It first, It last)
+{
+    std::size_t n = std::distance(first, last);
+    if (n == 0)
+        return make_ready_future();
+
+    auto join = new future_detail::Join<void>(n);
+    Future<void> result = join->promise_.get_future();
+    for (std::size_t i = 0; first != last; ++first, ++i)
+        first->state_->AddCallback(&join->nodes_[i]);
+    return result;
+}
+
+// [first, last)中第一个就绪的Future的下标(不是空范围).
+// 限制与when_all相同, 汇合状态在所有输入都就绪后才释放.
+template <typename It>
+Future<std::size_t> when_any(It first, It last)
+{
+    std::size_t n = std::distance(first, last);
+    assert(n > 0);
+
+    auto join = new future_detail::Join<std::size_t>(n);
+    Future<std::size_t> result = join->promise_.get_future();
+    for (std::size_t i = 0; first != last; ++first, ++i)
+        first->state_->AddCallback(&join->nodes_[i]);
+    return result;
+}
+
+} //namespace co
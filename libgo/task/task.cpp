@@ -25,7 +25,37 @@ const char* GetTaskStateName(TaskState state)
     }
 }
 
+const char* GetSuspendReasonName(eSuspendReason reason)
+{
+    switch (reason) {
+    case eSuspendReason::user:
+        return "user";
+    case eSuspendReason::channel:
+        return "channel";
+    case eSuspendReason::mutex:
+        return "mutex";
+    case eSuspendReason::condvar:
+        return "condvar";
+    case eSuspendReason::io:
+        return "io";
+    case eSuspendReason::sleep:
+        return "sleep";
+    case eSuspendReason::timer:
+        return "timer";
+    case eSuspendReason::future:
+        return "future";
+    default:
+        return "unkown";
+    }
+}
+
 void Task::Run()
+{
+    Execute();
+    Processer::StaticCoYield();
+}
+
+void Task::Execute()
 {
     auto call_fn = [this]() {
 #if ENABLE_DEBUGGER
@@ -70,7 +100,6 @@ void Task::Run()
 #endif
 
     state_ = TaskState::done;
-    Processer::StaticCoYield();
 }
 
 void Task::StaticRun(intptr_t vp)
@@ -87,7 +116,6 @@ Task::Task(TaskF const& fn, std::size_t stack_size)
 
 Task::~Task()
 {
-//    printf("delete Task = %p, impl = %p, weak = %ld\n", this, this->impl_, (long)this->impl_->weak_);
     assert(!this->prev);
     assert(!this->next);
 //    DebugPrint(dbg_task, "task(%s) destruct. this=%p", DebugInfo(), this);
@@ -17,15 +17,41 @@ enum class TaskState
 
 const char* GetTaskStateName(TaskState state);
 
+// 协程挂起的原因
+enum class eSuspendReason : uint8_t
+{
+    user,       // 直接调用Processer::Suspend
+    channel,    // Channel读写
+    mutex,      // CoMutex/CoRWMutex
+    condvar,    // 条件变量
+    io,         // 等待fd的IO事件
+    sleep,      // sleep/usleep/nanosleep等
+    timer,      // 未指定原因的定时唤醒
+    future,     // 等待Future的结果
+    count,
+};
+
+const char* GetSuspendReasonName(eSuspendReason reason);
+
+// 协程优先级(数值越小越优先)
+enum {
+    priority_high = 0,
+    priority_normal = 1,
+    priority_low = 2,
+    priority_count,
+};
+
 typedef std::function<void()> TaskF;
 
 struct TaskGroupKey {};
 typedef Anys<TaskGroupKey> TaskAnys;
 
 class Processer;
+class SchedulingGroup;
+struct TaskSlot;
 
 struct Task
-    : public TSQueueHook, public SharedRefObject, public CoDebugger::DebuggerBase<Task>
+    : public TSQueueHook, public RefObject, public CoDebugger::DebuggerBase<Task>
 {
     TaskState state_ = TaskState::runnable;
     uint64_t id_;
@@ -37,6 +63,29 @@ struct Task
 
     uint64_t yieldCount_ = 0;
 
+    // 累计运行的cpu周期数(rdtsc)
+    uint64_t cpuCycles_ = 0;
+
+    // 最近一次挂起和被唤醒时的rdtsc(开启enable_coro_stat时才记录)
+    uint64_t suspendTsc_ = 0;
+    uint64_t wakeupTsc_ = 0;
+    eSuspendReason suspendReason_ = eSuspendReason::user;
+
+    // 优先级, 决定在P中进入哪个可执行队列
+    uint8_t priority_ = priority_normal;
+
+    // 所属的调度组(没有指定时为nullptr)
+    SchedulingGroup* group_ = nullptr;
+
+    // 亲和组的key(0表示不属于任何亲和组), 同组的协程尽量在同一个P上执行
+    uint64_t affinityKey_ = 0;
+
+    // 所属调度器的协程槽位, 挂起和唤醒通过槽位中的挂起序号进行
+    TaskSlot* slot_ = nullptr;
+
+    // 轻量任务: 没有栈, 由P在自己的线程栈上直接调用, 不能挂起(见co::post)
+    bool light_ = false;
+
     Task(TaskF const& fn, std::size_t stack_size);
     ~Task();
 
@@ -55,6 +104,9 @@ struct Task
 
     const char* DebugInfo();
 
+    // 执行协程函数(含异常处理), 结束后state_为done. 轻量任务由P直接调用.
+    void Execute();
+
 private:
     void Run();
 
@@ -66,6 +118,11 @@ private:
     Task& operator=(Task &&) = delete;
 };
 
+// 协程由创建时的引用计数保活, 执行完后在Processer::GC中释放,
+// 在各个队列之间移动(newQueue_/runnableQueues_/waitQueue_/偷取)时不增减引用计数.
+template <>
+struct TSQueueHoldsRef<Task> : public std::false_type {};
+
 #define TaskInitPtr reinterpret_cast<Task*>(0x1)
 #define TaskRefDefine(type, name) \
     ALWAYS_INLINE type& TaskRef ## name(Task *tk) \
@@ -0,0 +1,124 @@
+#include <iostream>
+#include <unistd.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <event2/event.h>
+#include <event2/util.h>
+#include <libgo/libgo.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+using namespace std;
+using namespace std::chrono;
+
+// 在协程中运行第三方事件循环(libevent)的性能测试
+// libevent的echo服务端 + cClients个协程客户端做乒乓, 统计每秒往返次数.
+// 对比事件循环跑在独立线程上(每次往返都要跨线程唤醒)和跑在协程中(epoll_wait被hook, 只挂起协程).
+
+const int cThreads = 4;
+const int cClients = 64;
+const int cRounds = 2000;
+
+static void OnEcho(evutil_socket_t fd, short, void*)
+{
+    char buf[256];
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n > 0)
+        write(fd, buf, n);
+}
+
+static void OnQuit(evutil_socket_t fd, short, void* arg)
+{
+    char c;
+    read(fd, &c, 1);
+    event_base_loopbreak((event_base*)arg);
+}
+
+struct EchoLoop
+{
+    event_base* base_;
+    std::vector<event*> events_;
+    int quit_[2];
+    std::vector<int> clients_;
+
+    EchoLoop() {
+        base_ = event_base_new();
+        for (int i = 0; i < cClients; ++i) {
+            int sv[2];
+            socketpair(AF_LOCAL, SOCK_STREAM, 0, sv);
+            evutil_make_socket_nonblocking(sv[0]);
+            event* ev = event_new(base_, sv[0], EV_READ | EV_PERSIST, OnEcho, nullptr);
+            event_add(ev, nullptr);
+            events_.push_back(ev);
+            clients_.push_back(sv[1]);
+        }
+        socketpair(AF_LOCAL, SOCK_STREAM, 0, quit_);
+        evutil_make_socket_nonblocking(quit_[0]);
+        event* ev = event_new(base_, quit_[0], EV_READ, OnQuit, base_);
+        event_add(ev, nullptr);
+        events_.push_back(ev);
+    }
+
+    ~EchoLoop() {
+        for (event* ev : events_) {
+            close(event_get_fd(ev));
+            event_free(ev);
+        }
+        for (int fd : clients_) close(fd);
+        close(quit_[1]);
+        event_base_free(base_);
+    }
+
+    void Run() { event_base_dispatch(base_); }
+
+    void Quit() { write(quit_[1], "q", 1); }
+};
+
+// 每个客户端协程做cRounds次1字节的乒乓
+static double PingPong(EchoLoop & loop)
+{
+    std::atomic<int> done{0};
+    auto start = steady_clock::now();
+    for (int fd : loop.clients_) {
+        go [fd, &done]{
+            char c = 'x';
+            for (int i = 0; i < cRounds; ++i) {
+                write(fd, &c, 1);
+                read(fd, &c, 1);
+            }
+            ++done;
+        };
+    }
+    while (done < cClients)
+        usleep(1000);
+    double us = duration_cast<microseconds>(steady_clock::now() - start).count();
+    return (double)cClients * cRounds / (us / 1000000);
+}
+
+int main()
+{
+    std::thread([]{ co_sched.Start(cThreads, cThreads); }).detach();
+    usleep(100 * 1000);
+
+    printf("threads=%d clients=%d rounds=%d\n", cThreads, cClients, cRounds);
+    {
+        EchoLoop loop;
+        std::thread thr([&]{ loop.Run(); });
+        double qps = PingPong(loop);
+        loop.Quit();
+        thr.join();
+        printf("%-28s %8.0f round-trips/s\n", "event loop on a thread:", qps);
+    }
+    {
+        EchoLoop loop;
+        std::atomic<bool> stopped{false};
+        go [&]{ loop.Run(); stopped = true; };
+        double qps = PingPong(loop);
+        loop.Quit();
+        while (!stopped)
+            usleep(1000);
+        printf("%-28s %8.0f round-trips/s\n", "event loop in a coroutine:", qps);
+    }
+    return 0;
+}
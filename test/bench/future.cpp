@@ -0,0 +1,104 @@
+#include <iostream>
+#include <unistd.h>
+#include <stdio.h>
+#include <libgo/libgo.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+using namespace std;
+using namespace std::chrono;
+
+// 异步结果的吞吐量测试
+// 对比Channel<R>(1)(AsyncCoroutinePool::Post的用法)和Promise/Future传递大量结果.
+// 每轮由cProducers个协程生产cResults个结果, 一个协程按顺序等待并取出.
+
+const int cThreads = 4;
+const int cResults = 1000000;
+const int cProducers = 100;
+const int cRounds = 3;
+
+static void RunCase(const char* name, std::function<void(std::atomic<bool> &)> const& run)
+{
+    double best = 0;
+    for (int r = 0; r < cRounds; ++r) {
+        std::atomic<bool> done{false};
+        auto start = steady_clock::now();
+        go [&]{ run(done); };
+        while (!done)
+            usleep(100);
+        auto end = steady_clock::now();
+
+        double totalUs = duration_cast<microseconds>(end - start).count();
+        double perSec = cResults / (totalUs / 1000000);
+        if (perSec > best) best = perSec;
+        printf("%-24s total %8.0f us, %.0f w/s\n", name, totalUs, perSec / 10000);
+    }
+    printf("%-24s best %.0f w/s\n\n", name, best / 10000);
+}
+
+int main()
+{
+    std::thread([]{ co_sched.Start(cThreads, cThreads); }).detach();
+    usleep(100 * 1000);
+
+    printf("threads=%d results=%d\n", cThreads, cResults);
+    RunCase("channel(1):", [](std::atomic<bool> & done){
+            std::vector<co_chan<int>> results;
+            results.reserve(cResults);
+            for (int i = 0; i < cResults; ++i)
+                results.push_back(co_chan<int>(1));
+            for (int p = 0; p < cProducers; ++p) {
+                go [&, p]{
+                    for (int i = p; i < cResults; i += cProducers)
+                        results[i] << i;
+                };
+            }
+            long sum = 0;
+            for (auto & ch : results) {
+                int v;
+                ch >> v;
+                sum += v;
+            }
+            done = true;
+        });
+
+    RunCase("promise/future:", [](std::atomic<bool> & done){
+            std::vector<co::Promise<int>> promises(cResults);
+            std::vector<co::Future<int>> futures;
+            futures.reserve(cResults);
+            for (auto & p : promises)
+                futures.push_back(p.get_future());
+            for (int p = 0; p < cProducers; ++p) {
+                go [&, p]{
+                    for (int i = p; i < cResults; i += cProducers)
+                        promises[i].set_value(i);
+                };
+            }
+            long sum = 0;
+            for (auto & f : futures)
+                sum += f.get();
+            done = true;
+        });
+
+    RunCase("when_all:", [](std::atomic<bool> & done){
+            std::vector<co::Promise<int>> promises(cResults);
+            std::vector<co::Future<int>> futures;
+            futures.reserve(cResults);
+            for (auto & p : promises)
+                futures.push_back(p.get_future());
+            co::Future<void> all = co::when_all(futures.begin(), futures.end());
+            for (int p = 0; p < cProducers; ++p) {
+                go [&, p]{
+                    for (int i = p; i < cResults; i += cProducers)
+                        promises[i].set_value(i);
+                };
+            }
+            all.get();
+            long sum = 0;
+            for (auto & f : futures)
+                sum += f.get();
+            done = true;
+        });
+    return 0;
+}
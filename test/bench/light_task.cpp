@@ -0,0 +1,75 @@
+#include <iostream>
+#include <unistd.h>
+#include <stdio.h>
+#include <libgo/libgo.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+using namespace std;
+using namespace std::chrono;
+
+// 轻量任务的创建和调度速率测试
+// 对比协程(go)和轻量任务(go_fn/co::post)执行大量只有几条指令的小函数.
+// create: 创建cTasks个任务的耗时; total: 从开始创建到全部执行完的耗时.
+
+const int cThreads = 4;
+const int cTasks = 1000000;
+const int cRounds = 5;
+
+static std::atomic<int> gDone{0};
+
+static void WaitDone(int n)
+{
+    while (gDone < n)
+        usleep(100);
+    while (co_sched.TaskCount())
+        usleep(100);
+}
+
+static void RunCase(const char* name, std::function<void()> const& spawn)
+{
+    double bestCreate = 0, bestTotal = 0;
+    for (int r = 0; r < cRounds; ++r) {
+        gDone = 0;
+        auto start = steady_clock::now();
+        spawn();
+        auto created = steady_clock::now();
+        WaitDone(cTasks);
+        auto end = steady_clock::now();
+
+        double createUs = duration_cast<microseconds>(created - start).count();
+        double totalUs = duration_cast<microseconds>(end - start).count();
+        bestCreate = (std::max)(bestCreate, cTasks / (createUs / 1000000));
+        bestTotal = (std::max)(bestTotal, cTasks / (totalUs / 1000000));
+    }
+    printf("%-24s create %6.0f w/s, create+dispatch %6.0f w/s\n", name,
+            bestCreate / 10000, bestTotal / 10000);
+}
+
+int main()
+{
+    co_opt.stack_size = 64 * 1024;
+    std::thread([]{ co_sched.Start(cThreads, cThreads); }).detach();
+    usleep(100 * 1000);
+
+    printf("threads=%d tasks=%d stack=%dKB\n", cThreads, cTasks, (int)co_opt.stack_size / 1024);
+    RunCase("go:", []{
+            for (int i = 0; i < cTasks; ++i)
+                go []{ ++gDone; };
+        });
+    RunCase("go_fn:", []{
+            for (int i = 0; i < cTasks; ++i)
+                go_fn []{ ++gDone; };
+        });
+    RunCase("co::post:", []{
+            for (int i = 0; i < cTasks; ++i)
+                co::post([]{ ++gDone; });
+        });
+    RunCase("go_batch:", []{
+            go_batch(cTasks) [](std::size_t){ ++gDone; };
+        });
+    RunCase("go_batch co_light:", []{
+            go_batch(cTasks) co_light [](std::size_t){ ++gDone; };
+        });
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include <iostream>
+#include <unistd.h>
+#include <stdio.h>
+#include <math.h>
+#include <libgo/libgo.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+using namespace std::chrono;
+
+// 并行算法的性能测试
+// 对比co::parallel_for/parallel_reduce和手写的std::thread线程池(按线程数均分区间).
+// 均匀负载时两者接近; 负载不均时线程池受最慢的一块拖累, 惰性拆分可以把空闲的P用起来.
+
+const int cThreads = 4;
+const int cRounds = 5;
+const std::size_t cN = 200000;
+
+// 固定线程数的线程池, 任务队列+条件变量
+class ThreadPool
+{
+public:
+    explicit ThreadPool(int n) {
+        for (int i = 0; i < n; ++i)
+            threads_.emplace_back([this]{ Work(); });
+    }
+
+    ~ThreadPool() {
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto & t : threads_)
+            t.join();
+    }
+
+    // 把[0, n)均分给每个线程, 等待全部完成
+    void ParallelFor(std::size_t n, std::function<void(std::size_t, std::size_t)> const& body) {
+        std::size_t parts = threads_.size();
+        std::atomic<std::size_t> remain{parts};
+        std::mutex doneMtx;
+        std::condition_variable doneCv;
+        {
+            std::unique_lock<std::mutex> lock(mtx_);
+            for (std::size_t p = 0; p < parts; ++p) {
+                std::size_t begin = n * p / parts, end = n * (p + 1) / parts;
+                queue_.push_back([&, begin, end]{
+                        body(begin, end);
+                        if (--remain == 0) {
+                            std::unique_lock<std::mutex> lock(doneMtx);
+                            doneCv.notify_one();
+                        }
+                    });
+            }
+        }
+        cv_.notify_all();
+        std::unique_lock<std::mutex> lock(doneMtx);
+        doneCv.wait(lock, [&]{ return remain == 0; });
+    }
+
+private:
+    void Work() {
+        for (;;) {
+            std::function<void()> fn;
+            {
+                std::unique_lock<std::mutex> lock(mtx_);
+                cv_.wait(lock, [this]{ return stop_ || !queue_.empty(); });
+                if (queue_.empty()) return ;
+                fn = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            fn();
+        }
+    }
+
+    std::vector<std::thread> threads_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::deque<std::function<void()>> queue_;
+    bool stop_ = false;
+};
+
+// 第i个元素的计算量, skew为true时后1/8的元素计算量是其他的16倍
+static double Work(std::size_t i, bool skew)
+{
+    int loops = (skew && i >= cN / 8 * 7) ? 1600 : 100;
+    double v = (double)i;
+    for (int k = 0; k < loops; ++k)
+        v = sqrt(v + k);
+    return v;
+}
+
+static void RunCase(const char* name, std::function<double()> const& run)
+{
+    double best = 1e30, result = 0;
+    for (int r = 0; r < cRounds; ++r) {
+        auto start = steady_clock::now();
+        result = run();
+        double us = duration_cast<microseconds>(steady_clock::now() - start).count();
+        if (us < best) best = us;
+    }
+    printf("%-36s best %8.0f us (result %.3f)\n", name, best, result);
+}
+
+int main()
+{
+    std::thread([]{ co_sched.Start(cThreads, cThreads); }).detach();
+    usleep(100 * 1000);
+    ThreadPool pool(cThreads);
+
+    const std::size_t n = cN;
+    printf("threads=%d n=%d\n", cThreads, (int)n);
+    for (int skew = 0; skew < 2; ++skew) {
+        printf("---- %s load ----\n", skew ? "skewed" : "uniform");
+        RunCase("serial:", [=]{
+                double sum = 0;
+                for (std::size_t i = 0; i < n; ++i)
+                    sum += Work(i, skew);
+                return sum;
+            });
+        RunCase("std::thread pool:", [&]{
+                std::vector<double> out(n);
+                pool.ParallelFor(n, [&](std::size_t begin, std::size_t end){
+                        for (std::size_t i = begin; i < end; ++i)
+                            out[i] = Work(i, skew);
+                    });
+                double sum = 0;
+                for (double v : out) sum += v;
+                return sum;
+            });
+        RunCase("parallel_for (native thread):", [&]{
+                std::vector<double> out(n);
+                co::parallel_for((std::size_t)0, n, [&](std::size_t i){ out[i] = Work(i, skew); });
+                double sum = 0;
+                for (double v : out) sum += v;
+                return sum;
+            });
+        RunCase("parallel_reduce (coroutine):", [&]{
+                co::Promise<double> p;
+                co::Future<double> f = p.get_future();
+                go [&]{
+                    p.set_value(co::parallel_reduce((std::size_t)0, n, 0.0,
+                            [&](std::size_t i){ return Work(i, skew); },
+                            [](double a, double b){ return a + b; }));
+                };
+                return f.get();
+            });
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include <iostream>
+#include <unistd.h>
+#include <stdio.h>
+#include <poll.h>
+#include <sys/select.h>
+#include <libgo/libgo.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+using namespace std;
+using namespace std::chrono;
+
+// 大量fd上反复poll/select的性能测试
+// 一个协程反复poll全部fd, 另一个协程每轮往其中一个fd写1字节并等待poll方处理完,
+// 统计每秒轮数. 每轮只有一个fd就绪, 开销主要在每次poll对全部fd的注册和检查上.
+
+const int cRounds = 5000;
+
+struct Pipes
+{
+    std::vector<int> rds_, wrs_;
+
+    // 共nfds个fd: nfds/2个pipe的读端和写端都参与poll, 写端的POLLIN永远不会就绪
+    explicit Pipes(int nfds) {
+        for (int i = 0; i < nfds / 2; ++i) {
+            int fds[2];
+            if (pipe(fds) != 0) {
+                perror("pipe");
+                exit(1);
+            }
+            rds_.push_back(fds[0]);
+            wrs_.push_back(fds[1]);
+        }
+    }
+
+    ~Pipes() {
+        for (int fd : rds_) close(fd);
+        for (int fd : wrs_) close(fd);
+    }
+};
+
+template <typename Wait>
+static double PingPong(Pipes & pipes, Wait const& wait)
+{
+    co_chan<int> ready(1), ack(1);
+    std::atomic<int> done{0};
+    auto start = steady_clock::now();
+    go [&]{
+        for (int r = 0; r < cRounds; ++r) {
+            int idx = wait();
+            char c;
+            read(pipes.rds_[idx], &c, 1);
+            ack << idx;
+        }
+        ++done;
+    };
+    go [&]{
+        char c = 'x';
+        for (int r = 0; r < cRounds; ++r) {
+            int idx = (r * 7919) % pipes.rds_.size();
+            write(pipes.wrs_[idx], &c, 1);
+            int got;
+            ack >> got;
+        }
+        ++done;
+    };
+    while (done < 2)
+        usleep(1000);
+    double us = duration_cast<microseconds>(steady_clock::now() - start).count();
+    return cRounds / (us / 1000000);
+}
+
+int main()
+{
+    std::thread([]{ co_sched.Start(1, 1); }).detach();
+    usleep(100 * 1000);
+
+    printf("rounds=%d\n", cRounds);
+    int nfdsList[] = {1000, 2000, 5000, 10000};
+    for (int nfds : nfdsList) {
+        Pipes pipes(nfds);
+        std::vector<pollfd> pfds;
+        for (std::size_t i = 0; i < pipes.rds_.size(); ++i) {
+            pfds.push_back(pollfd{pipes.rds_[i], POLLIN, 0});
+            pfds.push_back(pollfd{pipes.wrs_[i], POLLIN, 0});
+        }
+
+        double rps = PingPong(pipes, [&]{
+                poll(pfds.data(), pfds.size(), -1);
+                for (std::size_t i = 0; i < pfds.size(); i += 2)
+                    if (pfds[i].revents & POLLIN)
+                        return (int)(i / 2);
+                return 0;
+            });
+        printf("poll   nfds=%-6d %8.0f rounds/s\n", nfds, rps);
+    }
+
+    // select受FD_SETSIZE限制
+    {
+        Pipes pipes(900);
+        int maxfd = 0;
+        for (int fd : pipes.wrs_) maxfd = (std::max)(maxfd, fd);
+        double rps = PingPong(pipes, [&]{
+                fd_set rfs;
+                FD_ZERO(&rfs);
+                for (std::size_t i = 0; i < pipes.rds_.size(); ++i) {
+                    FD_SET(pipes.rds_[i], &rfs);
+                    FD_SET(pipes.wrs_[i], &rfs);
+                }
+                select(maxfd + 1, &rfs, nullptr, nullptr, nullptr);
+                for (std::size_t i = 0; i < pipes.rds_.size(); ++i)
+                    if (FD_ISSET(pipes.rds_[i], &rfs))
+                        return (int)i;
+                return 0;
+            });
+        printf("select nfds=%-6d %8.0f rounds/s\n", 900, rps);
+    }
+    return 0;
+}
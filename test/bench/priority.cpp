@@ -0,0 +1,73 @@
+#include <iostream>
+#include <unistd.h>
+#include <stdio.h>
+#include <libgo/libgo.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+using namespace std;
+using namespace std::chrono;
+
+// 优先级调度的延迟测试
+// 批处理协程持续占满CPU, 测量延迟敏感的协程从创建到开始执行的时间(调度延迟).
+
+const int cThreads = 2;
+const int cBatchTasks = 200;
+const int cRequests = 5000;
+
+static void Spin(int us)
+{
+    auto end = steady_clock::now() + microseconds(us);
+    while (steady_clock::now() < end) ;
+}
+
+static void RunCase(const char* name, int batchPriority, int requestPriority)
+{
+    std::atomic<bool> stop{false};
+    for (int i = 0; i < cBatchTasks; ++i)
+        go co_priority(batchPriority) [&]{
+            while (!stop) {
+                Spin(20);
+                co_yield;
+            }
+        };
+
+    // 等批处理协程跑起来
+    usleep(100 * 1000);
+
+    std::mutex mtx;
+    co::Histogram latency;
+    for (int i = 0; i < cRequests; ++i) {
+        auto start = steady_clock::now();
+        go co_priority(requestPriority) [&, start]{
+            uint64_t ns = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                latency.Record(ns);
+            }
+            Spin(5);
+        };
+        usleep(200);
+    }
+
+    stop = true;
+    while (co_sched.TaskCount())
+        usleep(1000);
+
+    printf("%-28s %s\n", name, latency.ToString(1000, "us").c_str());
+}
+
+int main()
+{
+    std::thread([]{ co_sched.Start(cThreads, cThreads); }).detach();
+
+    printf("threads=%d batch=%d requests=%d\n", cThreads, cBatchTasks, cRequests);
+    RunCase("same priority:", co::priority_normal, co::priority_normal);
+    RunCase("request high priority:", co::priority_normal, co::priority_high);
+    RunCase("batch low priority:", co::priority_low, co::priority_normal);
+
+    co_opt.priority_starvation_limit = 0;
+    RunCase("strict, request high:", co::priority_normal, co::priority_high);
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <iostream>
+#include <unistd.h>
+#include <stdio.h>
+#include <libgo/libgo.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+using namespace std;
+using namespace std::chrono;
+
+// 批量创建协程的吞吐量测试
+// 对比逐个go和go_batch创建大量协程(扇出)的耗时.
+
+const int cThreads = 4;
+const int cTasks = 100000;
+const int cRounds = 5;
+
+static std::atomic<int> gDone{0};
+
+static void WaitDone(int n)
+{
+    while (gDone < n)
+        usleep(100);
+    while (co_sched.TaskCount())
+        usleep(100);
+}
+
+static void RunCase(const char* name, std::function<void()> const& spawn)
+{
+    double best = 0;
+    for (int r = 0; r < cRounds; ++r) {
+        gDone = 0;
+        auto start = steady_clock::now();
+        spawn();
+        auto spawned = steady_clock::now();
+        WaitDone(cTasks);
+        auto end = steady_clock::now();
+
+        double spawnUs = duration_cast<microseconds>(spawned - start).count();
+        double totalUs = duration_cast<microseconds>(end - start).count();
+        double perSec = cTasks / (totalUs / 1000000);
+        if (perSec > best) best = perSec;
+        printf("%-24s spawn %8.0f us, total %8.0f us\n", name, spawnUs, totalUs);
+    }
+    printf("%-24s best %.0f w/s\n\n", name, best / 10000);
+}
+
+int main()
+{
+    co_opt.stack_size = 64 * 1024;  // 小栈, 减少栈分配对结果的影响
+    std::thread([]{ co_sched.Start(cThreads, cThreads); }).detach();
+    usleep(100 * 1000);
+
+    printf("threads=%d tasks=%d\n", cThreads, cTasks);
+    RunCase("go (thread):", []{
+            for (int i = 0; i < cTasks; ++i)
+                go []{ ++gDone; };
+        });
+    RunCase("go_batch (thread):", []{
+            go_batch(cTasks) [](std::size_t){ ++gDone; };
+        });
+
+    // 在协程中扇出
+    RunCase("go (coroutine):", []{
+            go []{
+                for (int i = 0; i < cTasks; ++i)
+                    go []{ ++gDone; };
+            };
+        });
+    RunCase("go_batch (coroutine):", []{
+            go []{
+                go_batch(cTasks) [](std::size_t){ ++gDone; };
+            };
+        });
+    return 0;
+}
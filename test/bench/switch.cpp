@@ -0,0 +1,89 @@
+#include <iostream>
+#include <unistd.h>
+#include <stdio.h>
+#include <libgo/libgo.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+using namespace std;
+using namespace std::chrono;
+
+// 调度器的协程切换和挂起/唤醒开销测试
+// yield: cTasks个协程各自反复co_yield, 每次切换都要在可执行队列中前进一个位置.
+// wakeup: cPairs对协程通过channel乒乓, 每次往返包含两次挂起(进入等待队列)和两次唤醒(回到可执行队列).
+
+const int cTasks = 100;
+const int cYields = 100000;
+const int cPairs = 100;
+const int cRounds = 20000;
+const int cRepeat = 5;
+
+static std::atomic<int> gDone{0};
+
+static void WaitDone(int n)
+{
+    while (gDone < n)
+        usleep(1000);
+    while (co_sched.TaskCount())
+        usleep(1000);
+}
+
+static double Yield()
+{
+    gDone = 0;
+    auto start = steady_clock::now();
+    for (int i = 0; i < cTasks; ++i) {
+        go []{
+            for (int j = 0; j < cYields; ++j)
+                co_yield;
+            ++gDone;
+        };
+    }
+    WaitDone(cTasks);
+    double ns = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    return ns / ((double)cTasks * cYields);
+}
+
+static double Wakeup()
+{
+    gDone = 0;
+    auto start = steady_clock::now();
+    for (int i = 0; i < cPairs; ++i) {
+        co_chan<int> ping, pong;
+        go [=]{
+            for (int r = 0; r < cRounds; ++r) {
+                ping << r;
+                int x;
+                pong >> x;
+            }
+            ++gDone;
+        };
+        go [=]{
+            for (int r = 0; r < cRounds; ++r) {
+                int x;
+                ping >> x;
+                pong << x;
+            }
+            ++gDone;
+        };
+    }
+    WaitDone(cPairs * 2);
+    double ns = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    return ns / ((double)cPairs * cRounds * 2);
+}
+
+int main()
+{
+    std::thread([]{ co_sched.Start(1, 1); }).detach();
+    usleep(100 * 1000);
+
+    double bestYield = 0, bestWakeup = 0;
+    for (int i = 0; i < cRepeat; ++i) {
+        double y = Yield(), w = Wakeup();
+        if (!bestYield || y < bestYield) bestYield = y;
+        if (!bestWakeup || w < bestWakeup) bestWakeup = w;
+    }
+    printf("yield:  %6.1f ns/switch\n", bestYield);
+    printf("wakeup: %6.1f ns/suspend+wakeup\n", bestWakeup);
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include "gtest/gtest.h"
+#include "coroutine.h"
+#include "gtest_exit.h"
+#include <atomic>
+#include <chrono>
+using namespace co;
+using namespace std::chrono;
+
+static void Spin(int ms)
+{
+    auto end = steady_clock::now() + milliseconds(ms);
+    while (steady_clock::now() < end) ;
+}
+
+static bool WaitFor(std::function<bool()> const& cond, int timeoutMs)
+{
+    for (int i = 0; i < timeoutMs && !cond(); ++i)
+        usleep(1000);
+    return cond();
+}
+
+TEST(Admission, TaskLimit)
+{
+    Scheduler* sched = Scheduler::Create();
+    std::thread([=]{ sched->Start(1, 1); }).detach();
+
+    std::atomic<int> rejected{0};
+    AdmissionOpt opt;
+    opt.maxTasks_ = 10;
+    opt.onReject_ = [&](TaskF const&, eAdmissionReject reason) {
+        EXPECT_EQ(reason, eAdmissionReject::task_limit);
+        ++rejected;
+    };
+    sched->SetAdmission(opt);
+
+    co_chan<int> ch;
+    for (int i = 0; i < 15; ++i)
+        go co_scheduler(sched) [&]{ int v; ch >> v; };
+    EXPECT_EQ(rejected, 5);
+    EXPECT_EQ(sched->TaskCount(), 10u);
+    EXPECT_TRUE(sched->IsOverloaded());
+    EXPECT_EQ(sched->RejectedCount(eAdmissionReject::task_limit), 5u);
+
+    // 批量创建按整批判断: 整批计数, 回调只调用一次, 回调参数执行整批
+    std::atomic<int> generated{0}, executed{0};
+    opt.onReject_ = [&](TaskF const& fn, eAdmissionReject reason) {
+        EXPECT_EQ(reason, eAdmissionReject::task_limit);
+        ++rejected;
+        EXPECT_EQ(generated, 0);
+        fn();
+    };
+    sched->SetAdmission(opt);
+    EXPECT_FALSE(sched->CreateTasks(3, [&](std::size_t){ ++generated; return TaskF([&]{ ++executed; }); }, TaskOpt()));
+    EXPECT_EQ(rejected, 6);
+    EXPECT_EQ(generated, 3);
+    EXPECT_EQ(executed, 3);
+    EXPECT_EQ(sched->RejectedCount(eAdmissionReject::task_limit), 8u);
+
+    // 拆分到空闲P时被拒绝也计数, 但不调用回调
+    EXPECT_TRUE(WaitFor([=]{ return sched->IdleProcesserCount() == 1; }, 3000));
+    EXPECT_FALSE(sched->CreateTaskOnIdle([]{}, TaskOpt()));
+    EXPECT_EQ(rejected, 6);
+    EXPECT_EQ(sched->RejectedCount(eAdmissionReject::task_limit), 9u);
+
+    // 没有拒绝回调时抛出异常
+    opt.onReject_ = nullptr;
+    sched->SetAdmission(opt);
+    EXPECT_ANY_THROW(go co_scheduler(sched) []{});
+
+    ch.Close();
+    EXPECT_TRUE(WaitFor([=]{ return sched->TaskCount() == 0; }, 3000));
+    EXPECT_FALSE(sched->IsOverloaded());
+    EXPECT_TRUE(sched->CreateTask([]{}, TaskOpt()));
+
+    sched->SetAdmission(AdmissionOpt());
+    sched->Stop();
+}
+
+TEST(Admission, GroupLimit)
+{
+    Scheduler* sched = Scheduler::Create();
+    std::thread([=]{ sched->Start(1, 1); }).detach();
+
+    std::atomic<int> rejected{0};
+    AdmissionOpt opt;
+    opt.onReject_ = [&](TaskF const&, eAdmissionReject reason) {
+        EXPECT_EQ(reason, eAdmissionReject::group_limit);
+        ++rejected;
+    };
+    sched->SetAdmission(opt);
+
+    SchedulingGroup* group = SchedulingGroup::Create("admission_test");
+    group->SetMaxTasks(3);
+    co_chan<int> ch;
+    for (int i = 0; i < 5; ++i)
+        go co_scheduler(sched) co_group(group) [&]{ int v; ch >> v; };
+    EXPECT_EQ(rejected, 2);
+    EXPECT_EQ(group->GetStat().rejected_, 2u);
+
+    // 不属于该组的协程不受影响
+    go co_scheduler(sched) []{};
+    EXPECT_EQ(rejected, 2);
+
+    ch.Close();
+    EXPECT_TRUE(WaitFor([=]{ return sched->TaskCount() == 0; }, 3000));
+    sched->SetAdmission(AdmissionOpt());
+    sched->Stop();
+}
+
+TEST(Admission, QueueDelay)
+{
+    Scheduler* sched = Scheduler::Create();
+    std::thread([=]{ sched->Start(1, 1); }).detach();
+
+    std::atomic<int> rejected{0};
+    AdmissionOpt opt;
+    opt.targetDelayUs_ = 5 * 1000;
+    opt.intervalUs_ = 20 * 1000;
+    opt.onReject_ = [&](TaskF const&, eAdmissionReject reason) {
+        EXPECT_EQ(reason, eAdmissionReject::queue_delay);
+        ++rejected;
+    };
+    sched->SetAdmission(opt);
+
+    // 每轮调度约20ms, 排队延迟持续超过目标
+    std::atomic<bool> stop{false};
+    for (int i = 0; i < 10; ++i)
+        go co_scheduler(sched) [&]{
+            while (!stop) {
+                Spin(2);
+                co_yield;
+            }
+        };
+    EXPECT_TRUE(WaitFor([=]{ return sched->IsOverloaded(); }, 3000)) << sched->QueueDelayUs();
+    EXPECT_GE(sched->QueueDelayUs(), 5000u);
+
+    go co_scheduler(sched) []{};
+    EXPECT_EQ(rejected, 1);
+
+    // 负载下降后恢复
+    stop = true;
+    EXPECT_TRUE(WaitFor([=]{ return !sched->IsOverloaded(); }, 3000)) << sched->QueueDelayUs();
+    EXPECT_TRUE(sched->CreateTask([]{}, TaskOpt()));
+
+    sched->SetAdmission(AdmissionOpt());
+    sched->Stop();
+}
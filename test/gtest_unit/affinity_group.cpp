@@ -0,0 +1,84 @@
+#include "gtest/gtest.h"
+#include "coroutine.h"
+#include "gtest_exit.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+using namespace co;
+using namespace std::chrono;
+
+// 亲和组内的协程互相通信, 记录每次执行时所在的P
+struct GroupRecorder
+{
+    std::mutex mtx;
+    std::set<int> procs;
+
+    void Record() {
+        std::unique_lock<std::mutex> lock(mtx);
+        procs.insert(Processer::GetCurrentProcesser()->Id());
+    }
+};
+
+TEST(AffinityGroup, Placement)
+{
+    Scheduler* sched = Scheduler::Create();
+    std::thread([=]{ sched->Start(4, 4); }).detach();
+    while (sched->ProcesserCount() < 4)
+        usleep(1000);
+
+    // 从外部线程创建的同组协程放到同一个P上
+    GroupRecorder recorders[3];
+    for (int i = 0; i < 60; ++i) {
+        int g = i % 3;
+        go co_scheduler(sched) co_affinity_group(g + 1) [&, g]{
+            for (int j = 0; j < 5; ++j) {
+                recorders[g].Record();
+                co_yield;
+            }
+        };
+    }
+    WaitUntilNoTaskS(*sched);
+    for (auto & r : recorders) {
+        EXPECT_EQ(r.procs.size(), 1u);
+    }
+
+    sched->Stop();
+}
+
+TEST(AffinityGroup, StealTogether)
+{
+    Scheduler* sched = Scheduler::Create();
+    std::thread([=]{ sched->Start(3, 3); }).detach();
+    while (sched->ProcesserCount() < 3)
+        usleep(1000);
+
+    // 一个P上堆积大量协程, 其他P偷协程时整组偷走, 组内的协程始终在同一个P上
+    GroupRecorder recorder;
+    std::atomic<int> done{0};
+    go co_scheduler(sched) [&]{
+        co_chan<int> ch(1);
+        for (int i = 0; i < 10; ++i)
+            go co_scheduler(sched) co_affinity_group(0x1234) [&, ch]{
+                for (int j = 0; j < 50; ++j) {
+                    ch << j;
+                    int v;
+                    ch >> v;
+                    recorder.Record();
+                }
+                ++done;
+            };
+        for (int i = 0; i < 200; ++i)
+            go co_scheduler(sched) []{
+                for (int j = 0; j < 20; ++j)
+                    co_yield;
+            };
+
+        auto end = steady_clock::now() + milliseconds(300);
+        while (steady_clock::now() < end) ;
+    };
+    WaitUntilNoTaskS(*sched);
+    EXPECT_EQ(done, 10);
+    EXPECT_EQ(recorder.procs.size(), 1u);
+
+    sched->Stop();
+}
@@ -0,0 +1,217 @@
+#include "gtest/gtest.h"
+#include "coroutine.h"
+#include "gtest_exit.h"
+#include <atomic>
+#include <chrono>
+#include <sys/socket.h>
+using namespace co;
+using namespace std::chrono;
+
+static int64_t ElapsedMs(steady_clock::time_point start)
+{
+    return duration_cast<milliseconds>(steady_clock::now() - start).count();
+}
+
+TEST(Cancel, Basic)
+{
+    CancelToken empty;
+    EXPECT_FALSE(!!empty);
+    EXPECT_FALSE(empty.IsCancelled());
+    EXPECT_FALSE(!!CancelToken::Current());
+    EXPECT_FALSE(co::cancelled());
+
+    CancelToken token = CancelToken::Create();
+    std::atomic<int> result{0};
+    go co_cancel(token) [&]{
+        EXPECT_TRUE(CancelToken::Current() == token);
+        auto start = steady_clock::now();
+        EXPECT_EQ(usleep(10 * 1000 * 1000), -1);
+        EXPECT_EQ(errno, ECANCELED);
+        EXPECT_LT(ElapsedMs(start), 5000);
+        EXPECT_TRUE(co::cancelled());
+
+        // 取消之后的挂起立即返回
+        start = steady_clock::now();
+        EXPECT_EQ(usleep(10 * 1000 * 1000), -1);
+        EXPECT_LT(ElapsedMs(start), 1000);
+        ++result;
+    };
+
+    usleep(50 * 1000);
+    EXPECT_EQ(result, 0);
+    // 在原生线程中取消
+    std::thread([=]{ token.Cancel(); }).join();
+    token.Cancel();
+    EXPECT_TRUE(token.IsCancelled());
+    WaitUntilNoTask();
+    EXPECT_EQ(result, 1);
+}
+
+TEST(Cancel, Sleep)
+{
+    // sleep/nanosleep被取消时提前返回剩余的时间
+    CancelToken token = CancelToken::Create();
+    std::atomic<int> result{0};
+    go co_cancel(token) [&]{
+        auto start = steady_clock::now();
+        unsigned int left = sleep(10);
+        EXPECT_EQ(errno, ECANCELED);
+        EXPECT_LT(ElapsedMs(start), 5000);
+        EXPECT_GT(left, 5u);
+        EXPECT_LE(left, 10u);
+
+        struct timespec req = {10, 0}, rem = {0, 0};
+        EXPECT_EQ(nanosleep(&req, &rem), -1);
+        EXPECT_EQ(errno, ECANCELED);
+        EXPECT_GT(rem.tv_sec, 5);
+        EXPECT_LE(rem.tv_sec, 10);
+        ++result;
+    };
+
+    usleep(50 * 1000);
+    token.Cancel();
+    WaitUntilNoTask();
+    EXPECT_EQ(result, 1);
+}
+
+TEST(Cancel, Sync)
+{
+    CancelToken token = CancelToken::Create();
+    co_chan<int> ch;
+    co_chan<int> ch1(1);
+    co_mutex mtx;
+    mtx.lock();
+    std::atomic<int> done{0};
+
+    go co_cancel(token) [&]{
+        int v = 0;
+        EXPECT_FALSE(ch.TimedPop(v, seconds(10)));
+        ch >> v;
+        EXPECT_EQ(v, 0);
+        ++done;
+    };
+    go co_cancel(token) [&]{
+        ch1 << 1;
+        EXPECT_FALSE(ch1.TimedPush(2, seconds(10)));
+        ++done;
+    };
+    go co_cancel(token) [&]{
+        ConditionVariableAny cv;
+        LFLock lock;
+        std::unique_lock<LFLock> guard(lock);
+        EXPECT_EQ(cv.wait(guard), std::cv_status::timeout);
+        ++done;
+    };
+    go co_cancel(token) [&]{
+        ConnectionPool<int> pool([]{ return new int(1); }, nullptr, 2);   // 最多1个连接
+        auto conn = pool.Get();
+        EXPECT_TRUE(!!conn);
+        EXPECT_FALSE(!!pool.Get());
+        ++done;
+    };
+
+    // 互斥锁不受取消影响
+    go co_cancel(token) [&]{
+        mtx.lock();
+        EXPECT_TRUE(co::cancelled());
+        mtx.unlock();
+        ++done;
+    };
+
+    usleep(100 * 1000);
+    EXPECT_EQ(done, 0);
+    auto start = steady_clock::now();
+    token.Cancel();
+    while (done < 4 && ElapsedMs(start) < 3000)
+        usleep(1000);
+    EXPECT_EQ(done, 4);
+
+    mtx.unlock();
+    WaitUntilNoTask();
+    EXPECT_EQ(done, 5);
+}
+
+TEST(Cancel, IO)
+{
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+    CancelToken token = CancelToken::Create();
+    std::atomic<int> done{0};
+    go co_cancel(token) [&]{
+        char buf[16];
+        EXPECT_EQ(read(fds[0], buf, sizeof(buf)), -1);
+        EXPECT_EQ(errno, ECANCELED);
+
+        struct pollfd pfd = {fds[0], POLLIN, 0};
+        EXPECT_EQ(poll(&pfd, 1, 10 * 1000), -1);
+        EXPECT_EQ(errno, ECANCELED);
+        ++done;
+    };
+
+    usleep(50 * 1000);
+    token.Cancel();
+    WaitUntilNoTask();
+    EXPECT_EQ(done, 1);
+    close(fds[0]);
+    close(fds[1]);
+}
+
+TEST(Cancel, Propagate)
+{
+    CancelToken parent = CancelToken::Create();
+    CancelToken child = parent.Child();
+    CancelToken other = parent.Child();
+    std::atomic<int> done{0};
+
+    go co_cancel(parent) [&]{
+        // 继承父协程的令牌
+        go co_inherit_cancel [&]{
+            EXPECT_TRUE(CancelToken::Current() == parent);
+            usleep(10 * 1000 * 1000);
+            ++done;
+        };
+        usleep(10 * 1000 * 1000);
+        ++done;
+    };
+    go co_cancel(child) [&]{
+        usleep(10 * 1000 * 1000);
+        ++done;
+    };
+
+    // 取消子令牌不影响父令牌
+    other.Cancel();
+    EXPECT_FALSE(parent.IsCancelled());
+    EXPECT_FALSE(child.IsCancelled());
+
+    usleep(50 * 1000);
+    EXPECT_EQ(done, 0);
+    parent.Cancel();
+    EXPECT_TRUE(child.IsCancelled());
+    EXPECT_TRUE(parent.Child().IsCancelled());
+    WaitUntilNoTask();
+    EXPECT_EQ(done, 3);
+}
+
+TEST(Cancel, Race)
+{
+    // 取消与挂起并发进行, 漏掉唤醒的协程会永远阻塞在channel上
+    for (int round = 0; round < 20; ++round) {
+        CancelToken token = CancelToken::Create();
+        co_chan<int> ch;
+        std::atomic<int> done{0};
+        const int n = 200;
+        for (int i = 0; i < n; ++i)
+            go co_cancel(token) [&, i]{
+                for (int j = 0; j < i % 7; ++j)
+                    co_yield;
+                int v;
+                ch >> v;
+                ++done;
+            };
+        usleep(round * 50);
+        token.Cancel();
+        WaitUntilNoTask();
+        EXPECT_EQ(done, n);
+    }
+}
@@ -0,0 +1,94 @@
+#include "gtest/gtest.h"
+#include "coroutine.h"
+#include "gtest_exit.h"
+#include <atomic>
+#include <string>
+using namespace co;
+
+static volatile uint64_t g_sink = 0;
+
+static void BusyLoop(int ms)
+{
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    while (std::chrono::steady_clock::now() < end)
+        for (int i = 0; i < 1000; ++i)
+            g_sink += i;
+}
+
+TEST(CpuStat, TopTasks)
+{
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> hogId{0};
+    go [&]{
+        hogId = g_Scheduler.GetCurrentTaskID();
+        while (!stop) {
+            BusyLoop(5);
+            co_yield;
+        }
+    };
+    for (int i = 0; i < 10; ++i)
+        go [&]{
+            while (!stop)
+                co_sleep(1);
+        };
+
+    usleep(100 * 1000);
+    auto top = g_Scheduler.TopTasksByCpu(3);
+    ASSERT_EQ(top.size(), 3u);
+    EXPECT_EQ(top[0].id_, hogId);
+    EXPECT_GT(top[0].cpuNs_, 50u * 1000 * 1000);
+    EXPECT_GE(top[0].cpuNs_, top[1].cpuNs_);
+    EXPECT_GE(top[1].cpuNs_, top[2].cpuNs_);
+    EXPECT_STREQ(top[0].location_.file_, __FILE__);
+
+    stop = true;
+    WaitUntilNoTask();
+    EXPECT_TRUE(g_Scheduler.TopTasksByCpu(3).empty());
+}
+
+TEST(CpuStat, RunningTask)
+{
+    std::atomic<bool> stop{false};
+    go [&]{ while (!stop) g_sink += 1; };
+
+    usleep(50 * 1000);
+    auto top = g_Scheduler.TopTasksByCpu(1);
+    ASSERT_EQ(top.size(), 1u);
+    EXPECT_TRUE(top[0].running_);
+    EXPECT_GT(top[0].cpuNs_, 20u * 1000 * 1000);
+
+    stop = true;
+    WaitUntilNoTask();
+}
+
+TEST(CpuStat, TopLocations)
+{
+    co_opt.enable_coro_stat = true;
+
+    int hotLine = __LINE__ + 1;
+    go []{ for (int i = 0; i < 20; ++i) { BusyLoop(5); co_yield; } };
+    for (int i = 0; i < 10; ++i)
+        go []{ co_yield; };
+    WaitUntilNoTask();
+
+    auto top = g_Scheduler.TopLocationsByCpu(2);
+    ASSERT_EQ(top.size(), 2u);
+    EXPECT_EQ(top[0].location_.lineno_, hotLine);
+    EXPECT_GT(top[0].cpuNs_, 80u * 1000 * 1000);
+    EXPECT_GE(top[0].switchCount_, 20u);
+    EXPECT_EQ(top[1].switchCount_, 20u);
+
+    // 滑动窗口
+    auto window = g_Scheduler.TopLocationsByCpu(1, true);
+    ASSERT_EQ(window.size(), 1u);
+    EXPECT_EQ(window[0].location_.lineno_, hotLine);
+    EXPECT_GT(window[0].windowCpuNs_, 0u);
+
+    usleep((LocationCpuStat::kWindowMs + LocationCpuStat::kSlotMs) * 1000);
+    window = g_Scheduler.TopLocationsByCpu(1, true);
+    ASSERT_EQ(window.size(), 1u);
+    EXPECT_EQ(window[0].windowCpuNs_, 0u);
+    EXPECT_GT(window[0].cpuNs_, 0u);
+
+    co_opt.enable_coro_stat = false;
+}
@@ -0,0 +1,128 @@
+#include "gtest/gtest.h"
+#include "coroutine.h"
+#include "gtest_exit.h"
+#include <atomic>
+#include <fstream>
+#include <sched.h>
+using namespace co;
+
+static void WriteFile(std::string const& path, std::string const& content)
+{
+    std::ofstream ofs(path);
+    ofs << content << "\n";
+}
+
+static void MakeDirs(std::string const& path)
+{
+    std::string cmd = "mkdir -p " + path;
+    (void)system(cmd.c_str());
+}
+
+// 模拟双路机器: 2个NUMA节点, 每个节点2个物理核(每核2个超线程)共享一个L3
+//   node0: core0={0,4} core1={1,5}
+//   node1: core2={2,6} core3={3,7}
+static std::string MakeFakeTopology()
+{
+    std::string root = "/tmp/libgo_test_cpu_topology";
+    (void)system(("rm -rf " + root).c_str());
+    MakeDirs(root);
+    WriteFile(root + "/online", "0-7");
+    for (int cpu = 0; cpu < 8; ++cpu) {
+        int core = cpu % 4;
+        int node = core / 2;
+        std::string dir = root + "/cpu" + std::to_string(cpu);
+        MakeDirs(dir + "/topology");
+        MakeDirs(dir + "/node" + std::to_string(node));
+        WriteFile(dir + "/topology/thread_siblings_list", Format("%d,%d", core, core + 4));
+
+        MakeDirs(dir + "/cache/index0");
+        WriteFile(dir + "/cache/index0/level", "1");
+        WriteFile(dir + "/cache/index0/shared_cpu_list", Format("%d,%d", core, core + 4));
+        MakeDirs(dir + "/cache/index1");
+        WriteFile(dir + "/cache/index1/level", "3");
+        WriteFile(dir + "/cache/index1/shared_cpu_list", node ? "2-3,6-7" : "0-1,4-5");
+    }
+    return root;
+}
+
+TEST(CpuTopology, Load)
+{
+    EXPECT_EQ(CpuTopology::ParseCpuList("0-2,5,7-8"), (std::vector<int>{0, 1, 2, 5, 7, 8}));
+
+    std::string root = MakeFakeTopology();
+    CpuTopology topo = CpuTopology::Load(root);
+    ASSERT_EQ(topo.Cpus().size(), 8u) << topo.ToString();
+    EXPECT_EQ(topo.NodeCount(), 2);
+
+    // 按节点、LLC、物理核排序, 超线程相邻
+    std::vector<int> order;
+    for (auto & cpu : topo.Cpus())
+        order.push_back(cpu.id_);
+    EXPECT_EQ(order, (std::vector<int>{0, 4, 1, 5, 2, 6, 3, 7})) << topo.ToString();
+
+    EXPECT_EQ(topo.Distance(0, 0), CpuTopology::same_cpu);
+    EXPECT_EQ(topo.Distance(0, 4), CpuTopology::same_core);
+    EXPECT_EQ(topo.Distance(0, 5), CpuTopology::same_llc);
+    EXPECT_EQ(topo.Distance(1, 7), CpuTopology::remote);
+
+    // cpuset过滤
+    CpuTopology part = CpuTopology::Load(root, {2, 3, 6});
+    EXPECT_EQ(part.Cpus().size(), 3u);
+    EXPECT_EQ(part.NodeCount(), 1);
+
+    // 目录不存在时为空
+    EXPECT_TRUE(CpuTopology::Load("/tmp/libgo_test_cpu_topology_missing").Empty());
+}
+
+TEST(CpuTopology, Bind)
+{
+    std::vector<int> cpuset = CpuTopology::GetProcessCpuset();
+    ASSERT_FALSE(cpuset.empty());
+    int cpu = cpuset.back();
+
+    // 两个P都绑定到同一个CPU
+    Scheduler* sched = Scheduler::Create();
+    sched->SetCpuList({cpu});
+    std::thread([=]{ sched->Start(2, 2); }).detach();
+    while (sched->ProcesserCount() < 2)
+        usleep(1000);
+    EXPECT_EQ(sched->GetCpuTopology().Cpus().size(), 1u);
+
+    std::atomic<int> wrongCpu{0};
+    for (int i = 0; i < 100; ++i)
+        go co_scheduler(sched) [&]{
+            for (int j = 0; j < 10; ++j) {
+                if (sched_getcpu() != cpu)
+                    ++wrongCpu;
+                co_yield;
+            }
+        };
+    while (sched->TaskCount())
+        usleep(1000);
+    EXPECT_EQ(wrongCpu, 0);
+
+    sched->Stop();
+}
+
+TEST(CpuTopology, Simulated)
+{
+    // 按模拟的拓扑绑定, 不存在的CPU绑定失败也能正常调度
+    co_opt.enable_cpu_affinity = true;
+    co_opt.cpu_topology_path = MakeFakeTopology();
+    Scheduler* sched = Scheduler::Create();
+    std::thread([=]{ sched->Start(3, 3); }).detach();
+    while (sched->ProcesserCount() < 3)
+        usleep(1000);
+    EXPECT_EQ(sched->GetCpuTopology().Cpus().size(), 8u);
+
+    std::atomic<int> done{0};
+    for (int i = 0; i < 1000; ++i)
+        go co_scheduler(sched) [&]{ co_yield; ++done; };
+    while (sched->TaskCount())
+        usleep(1000);
+    EXPECT_EQ(done, 1000);
+
+    co_opt.enable_cpu_affinity = false;
+    co_opt.cpu_topology_path = CpuTopology::SysfsRoot();
+    sched->Stop();
+}
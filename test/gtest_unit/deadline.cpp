@@ -0,0 +1,165 @@
+#include "gtest/gtest.h"
+#include "coroutine.h"
+#include "gtest_exit.h"
+#include <atomic>
+#include <chrono>
+#include <sys/socket.h>
+using namespace co;
+using namespace std::chrono;
+
+static int64_t ElapsedMs(steady_clock::time_point start)
+{
+    return duration_cast<milliseconds>(steady_clock::now() - start).count();
+}
+
+TEST(Deadline, Basic)
+{
+    EXPECT_TRUE(co::get_deadline() == FastSteadyClock::time_point{});
+    EXPECT_FALSE(co::deadline_exceeded());
+
+    go [&]{
+        EXPECT_TRUE(co::get_deadline() == FastSteadyClock::time_point{});
+        co::set_timeout(milliseconds(50));
+        EXPECT_FALSE(co::deadline_exceeded());
+
+        // 子协程默认不继承
+        go []{ EXPECT_TRUE(co::get_deadline() == FastSteadyClock::time_point{}); };
+        FastSteadyClock::time_point deadline = co::get_deadline();
+        go co_inherit_deadline [=]{ EXPECT_TRUE(co::get_deadline() == deadline); };
+
+        usleep(100 * 1000);
+        EXPECT_TRUE(co::deadline_exceeded());
+        co::clear_deadline();
+        EXPECT_FALSE(co::deadline_exceeded());
+    };
+    WaitUntilNoTask();
+}
+
+TEST(Deadline, Sleep)
+{
+    // sleep最多睡到截止时间, 返回剩余的秒数
+    std::atomic<int> done{0};
+    go [&]{
+        co::set_timeout(milliseconds(50));
+        auto start = steady_clock::now();
+        EXPECT_EQ(sleep(3), 3u);
+        EXPECT_EQ(errno, ETIMEDOUT);
+        EXPECT_LT(duration_cast<milliseconds>(steady_clock::now() - start).count(), 1000);
+        ++done;
+    };
+    WaitUntilNoTask();
+    EXPECT_EQ(done, 1);
+}
+
+TEST(Deadline, Channel)
+{
+    go [&]{
+        co_chan<int> ch;
+        co::set_timeout(milliseconds(50));
+
+        auto start = steady_clock::now();
+        int v = 0;
+        ch >> v;
+        EXPECT_EQ(v, 0);
+        EXPECT_GE(ElapsedMs(start), 40);
+        EXPECT_LT(ElapsedMs(start), 1000);
+
+        // 已经超时: 不再等待
+        start = steady_clock::now();
+        EXPECT_FALSE(ch.TimedPop(v, seconds(10)));
+        EXPECT_FALSE(ch.TimedPush(1, seconds(10)));
+        EXPECT_LT(ElapsedMs(start), 100);
+
+        // 继承截止时间的子协程也会超时
+        co::set_timeout(milliseconds(50));
+        co_chan<bool> result(1);
+        go co_inherit_deadline [=]{
+            int v;
+            result << ch.TimedPop(v, seconds(10));
+        };
+        co::clear_deadline();
+        bool ok = true;
+        result >> ok;
+        EXPECT_FALSE(ok);
+    };
+    WaitUntilNoTask();
+}
+
+TEST(Deadline, Sync)
+{
+    go [&]{
+        // 条件变量
+        co::set_timeout(milliseconds(50));
+        ConditionVariableAny cv;
+        LFLock lock;
+        std::unique_lock<LFLock> guard(lock);
+        auto start = steady_clock::now();
+        EXPECT_EQ(cv.wait(guard), std::cv_status::timeout);
+        EXPECT_LT(ElapsedMs(start), 1000);
+        guard.unlock();
+
+        // 互斥锁不受截止时间限制
+        co::set_timeout(milliseconds(20));
+        co_mutex mtx;
+        mtx.lock();
+        go [&]{
+            usleep(100 * 1000);
+            mtx.unlock();
+        };
+        mtx.lock();
+        EXPECT_TRUE(co::deadline_exceeded());
+        mtx.unlock();
+
+        // sleep提前返回
+        co::set_timeout(milliseconds(50));
+        start = steady_clock::now();
+        EXPECT_EQ(usleep(1000 * 1000), -1);
+        EXPECT_EQ(errno, ETIMEDOUT);
+        EXPECT_LT(ElapsedMs(start), 500);
+    };
+    WaitUntilNoTask();
+}
+
+TEST(Deadline, IO)
+{
+    go [&]{
+        int fds[2];
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+
+        co::set_timeout(milliseconds(50));
+        auto start = steady_clock::now();
+        char buf[16];
+        EXPECT_EQ(read(fds[0], buf, sizeof(buf)), -1);
+        EXPECT_EQ(errno, ETIMEDOUT);
+        EXPECT_LT(ElapsedMs(start), 1000);
+
+        // 没有超时的读不受影响
+        co::clear_deadline();
+        EXPECT_EQ(write(fds[1], "a", 1), 1);
+        EXPECT_EQ(read(fds[0], buf, sizeof(buf)), 1);
+
+        close(fds[0]);
+        close(fds[1]);
+    };
+    WaitUntilNoTask();
+}
+
+TEST(Deadline, ConnectionPool)
+{
+    go [&]{
+        ConnectionPool<int> pool([]{ return new int(1); }, nullptr, 2);   // 最多1个连接
+        auto conn = pool.Get();
+        ASSERT_TRUE(!!conn);
+
+        co::set_timeout(milliseconds(50));
+        auto start = steady_clock::now();
+        EXPECT_FALSE(!!pool.Get());
+        EXPECT_FALSE(!!pool.Get(seconds(10)));
+        EXPECT_LT(ElapsedMs(start), 1000);
+
+        co::clear_deadline();
+        conn.reset();
+        EXPECT_TRUE(!!pool.Get());
+    };
+    WaitUntilNoTask();
+}
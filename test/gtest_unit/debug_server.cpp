@@ -0,0 +1,118 @@
+#include "gtest/gtest.h"
+#include "coroutine.h"
+#include "gtest_exit.h"
+#include <atomic>
+#include <string>
+#include <sys/un.h>
+using namespace co;
+
+static std::string HttpGet(int fd, std::string const& path)
+{
+    std::string req = "GET " + path + " HTTP/1.0\r\nHost: localhost\r\n\r\n";
+    if (write(fd, req.data(), req.size()) != (ssize_t)req.size()) {
+        close(fd);
+        return "";
+    }
+
+    std::string resp;
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0)
+        resp.append(buf, n);
+    close(fd);
+    return resp;
+}
+
+static std::string TcpGet(int port, std::string const& path)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return "";
+    }
+    return HttpGet(fd, path);
+}
+
+TEST(DebugServer, Snapshot)
+{
+    std::atomic<bool> stop{false};
+    co_chan<int> ch;
+    const int n = 10;
+    int line = __LINE__ + 2;
+    for (int i = 0; i < n; ++i)
+        go [=]{ int v; ch >> v; };
+    go [&]{ while (!stop) co_sleep(1); };
+    usleep(20 * 1000);
+
+    std::string s = CoDebugger::getInstance().GetSnapshot();
+    EXPECT_EQ(s.front(), '{');
+    EXPECT_EQ(s.back(), '}');
+    EXPECT_NE(s.find("\"schedulers\":[{\"id\":0,\"is_default\":true"), std::string::npos) << s;
+    std::string blocked = "{\"state\":\"Block\",\"file\":\"" + std::string(__FILE__) +
+        "\",\"line\":" + std::to_string(line) + ",\"count\":" + std::to_string(n) + "}";
+    EXPECT_NE(s.find(blocked), std::string::npos) << s;
+    EXPECT_NE(s.find("\"processers\":[{\"id\":0,"), std::string::npos);
+    EXPECT_NE(s.find("\"reactors\":["), std::string::npos);
+    EXPECT_NE(s.find("\"fds\":{\"socket\":"), std::string::npos);
+
+    for (int i = 0; i < n; ++i)
+        ch << i;
+    stop = true;
+    WaitUntilNoTask();
+}
+
+TEST(DebugServer, Http)
+{
+    ASSERT_TRUE(DebugServer::getInstance().Start("127.0.0.1:0"));
+    EXPECT_FALSE(DebugServer::getInstance().Start("127.0.0.1:0"));
+    int port = DebugServer::getInstance().Port();
+    ASSERT_GT(port, 0);
+
+    std::string resp = TcpGet(port, "/snapshot");
+    EXPECT_EQ(resp.find("HTTP/1.0 200 OK\r\n"), 0u) << resp;
+    EXPECT_NE(resp.find("Content-Type: application/json"), std::string::npos);
+    EXPECT_NE(resp.find("\r\n\r\n{\"timestamp_us\":"), std::string::npos);
+
+    resp = TcpGet(port, "/not_exists");
+    EXPECT_EQ(resp.find("HTTP/1.0 404 Not Found\r\n"), 0u) << resp;
+
+    DebugServer::getInstance().Handle("/hello", []{ return std::string("world"); }, "text/plain");
+    resp = TcpGet(port, "/hello?x=1");
+    EXPECT_NE(resp.find("\r\n\r\nworld"), std::string::npos) << resp;
+
+    // 业务协程阻塞调度线程时也可以访问
+    std::atomic<bool> stop{false};
+    go [&]{ while (!stop) ; };
+    resp = TcpGet(port, "/snapshot");
+    EXPECT_EQ(resp.find("HTTP/1.0 200 OK\r\n"), 0u);
+    stop = true;
+
+    DebugServer::getInstance().Stop();
+    usleep(20 * 1000);
+    EXPECT_EQ(TcpGet(port, "/snapshot"), "");
+    WaitUntilNoTask();
+}
+
+TEST(DebugServer, UnixSocket)
+{
+    const char* path = "/tmp/libgo_debug_server_test.sock";
+    ASSERT_TRUE(DebugServer::getInstance().Start(std::string("unix:") + path));
+    EXPECT_EQ(DebugServer::getInstance().Port(), 0);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    ASSERT_EQ(connect(fd, (sockaddr*)&addr, sizeof(addr)), 0);
+    std::string resp = HttpGet(fd, "/snapshot");
+    EXPECT_EQ(resp.find("HTTP/1.0 200 OK\r\n"), 0u) << resp;
+
+    DebugServer::getInstance().Stop();
+    EXPECT_NE(access(path, F_OK), 0);
+}
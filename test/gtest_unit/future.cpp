@@ -0,0 +1,183 @@
+#include "gtest/gtest.h"
+#include "coroutine.h"
+#include "gtest_exit.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+using namespace co;
+using namespace std::chrono;
+
+TEST(Future, Basic)
+{
+    // 原生线程中等待
+    Promise<int> p;
+    Future<int> f = p.get_future();
+    EXPECT_TRUE(f.valid());
+    EXPECT_FALSE(f.is_ready());
+    EXPECT_FALSE(f.wait_for(milliseconds(10)));
+    go [&]{ co_sleep(10); p.set_value(42); };
+    EXPECT_EQ(f.get(), 42);
+    EXPECT_FALSE(f.valid());
+
+    // 协程中挂起等待, 在原生线程中设置
+    std::atomic<int> result{0};
+    Promise<std::string> ps;
+    Future<std::string> fs = ps.get_future();
+    go [&]{ result = fs.get() == "hello" ? 1 : -1; };
+    usleep(20 * 1000);
+    EXPECT_EQ(result, 0);
+    ps.set_value("hello");
+    WaitUntilNoTask();
+    EXPECT_EQ(result, 1);
+
+    // void和不可复制的结果
+    Promise<void> pv;
+    Future<void> fv = pv.get_future();
+    pv.set_value();
+    fv.get();
+
+    Promise<std::unique_ptr<int>> pu;
+    Future<std::unique_ptr<int>> fu = pu.get_future();
+    pu.set_value(std::unique_ptr<int>(new int(7)));
+    EXPECT_EQ(*fu.get(), 7);
+
+    EXPECT_EQ(make_ready_future(3).get(), 3);
+}
+
+TEST(Future, Exception)
+{
+    Promise<int> p;
+    Future<int> f = p.get_future();
+    EXPECT_THROW(p.get_future(), std::system_error);
+    p.set_exception(std::make_exception_ptr(std::runtime_error("bad")));
+    EXPECT_THROW(p.set_value(1), std::system_error);
+    EXPECT_THROW(f.get(), std::runtime_error);
+
+    // Promise析构时没有设置结果
+    Future<int> broken;
+    {
+        Promise<int> p2;
+        broken = p2.get_future();
+    }
+    try {
+        broken.get();
+        EXPECT_TRUE(false);
+    } catch (std::system_error & e) {
+        EXPECT_EQ(e.code(), MakeCoErrorCode(eCoErrorCode::ec_broken_promise));
+    }
+}
+
+TEST(Future, Timeout)
+{
+    std::atomic<int> done{0};
+    Promise<int> p;
+    Future<int> f = p.get_future();
+    go [&]{
+        auto start = steady_clock::now();
+        EXPECT_FALSE(f.wait_for(milliseconds(50)));
+        EXPECT_GE(duration_cast<milliseconds>(steady_clock::now() - start).count(), 40);
+
+        // 截止时间打断get, Future仍然有效
+        co::set_timeout(milliseconds(20));
+        EXPECT_THROW(f.get(), std::system_error);
+        EXPECT_TRUE(f.valid());
+        co::clear_deadline();
+        EXPECT_EQ(f.get(), 5);
+        ++done;
+    };
+    usleep(200 * 1000);
+    p.set_value(5);
+    WaitUntilNoTask();
+    EXPECT_EQ(done, 1);
+
+    // 栈回退中get被截止时间打断, 不能抛出也不能读取未设置的结果
+    struct GetOnUnwind {
+        Future<std::string> & f;
+        std::string & result;
+        ~GetOnUnwind() { result = f.get(); }
+    };
+    std::string result;
+    Promise<std::string> ps;
+    Future<std::string> fs = ps.get_future();
+    go [&]{
+        co::set_timeout(milliseconds(20));
+        try {
+            GetOnUnwind g{fs, result};
+            throw std::runtime_error("unwind");
+        } catch (std::runtime_error &) {
+            ++done;
+        }
+        co::clear_deadline();
+    };
+    usleep(100 * 1000);
+    EXPECT_EQ(done, 1);
+    ps.set_value("ready");
+    WaitUntilNoTask();
+    EXPECT_EQ(done, 2);
+    EXPECT_EQ(result, "ready");
+}
+
+TEST(Future, Then)
+{
+    Promise<int> p;
+    Future<std::string> f = p.get_future()
+        .then([](Future<int> f){ return f.get() * 2; })
+        .then([](Future<int> f){ return std::to_string(f.get()); });
+    EXPECT_FALSE(f.is_ready());
+    p.set_value(21);
+    EXPECT_TRUE(f.is_ready());
+    EXPECT_EQ(f.get(), "42");
+
+    // 已经就绪时立即执行, 异常传递给下一个Future
+    Future<void> fv = make_ready_future(1).then([](Future<int>){
+            throw std::runtime_error("then");
+        });
+    EXPECT_THROW(fv.get(), std::runtime_error);
+}
+
+TEST(Future, WhenAll)
+{
+    const int n = 1000;
+    std::vector<Promise<int>> promises(n);
+    std::vector<Future<int>> futures;
+    for (auto & p : promises)
+        futures.push_back(p.get_future());
+
+    Future<void> all = when_all(futures.begin(), futures.end());
+    for (int i = 0; i < n; ++i) {
+        go [&, i]{ promises[i].set_value(i); };
+    }
+
+    std::atomic<long> sum{0};
+    go [&]{
+        all.get();
+        for (auto & f : futures)
+            sum += f.get();
+    };
+    WaitUntilNoTask();
+    EXPECT_EQ(sum, (long)n * (n - 1) / 2);
+
+    std::vector<Future<int>> empty;
+    EXPECT_TRUE(when_all(empty.begin(), empty.end()).is_ready());
+}
+
+TEST(Future, WhenAny)
+{
+    std::vector<Promise<int>> promises(10);
+    std::vector<Future<int>> futures;
+    for (auto & p : promises)
+        futures.push_back(p.get_future());
+
+    Future<std::size_t> any = when_any(futures.begin(), futures.end());
+    EXPECT_FALSE(any.is_ready());
+    promises[7].set_value(7);
+    promises[3].set_value(3);
+    EXPECT_EQ(any.get(), 7u);
+    EXPECT_EQ(futures[7].get(), 7);
+
+    // 其余的Promise析构时设置broken_promise, 汇合状态随之释放
+    promises.clear();
+    EXPECT_THROW(futures[0].get(), std::system_error);
+}
@@ -0,0 +1,61 @@
+#include "gtest/gtest.h"
+#include "coroutine.h"
+#include "gtest_exit.h"
+#include <atomic>
+#include <mutex>
+using namespace co;
+
+TEST(GoBatch, Create)
+{
+    Scheduler* sched = Scheduler::Create();
+    std::thread([=]{ sched->Start(4, 4); }).detach();
+    while (sched->ProcesserCount() < 4)
+        usleep(1000);
+
+    // 每个序号恰好执行一次
+    const int n = 10000;
+    std::vector<std::atomic<int>> hits(n);
+    for (auto & h : hits) h = 0;
+    go_batch(n) co_scheduler(sched) [&](std::size_t i){
+        co_yield;
+        ++hits[i];
+    };
+    WaitUntilNoTaskS(*sched);
+    int wrong = 0;
+    for (auto & h : hits)
+        if (h != 1) ++wrong;
+    EXPECT_EQ(wrong, 0);
+
+    // 在协程中批量创建, 分给多个P执行
+    std::mutex mtx;
+    std::set<int> procs;
+    go co_scheduler(sched) [&]{
+        go_batch(1000) [&](std::size_t){
+            std::unique_lock<std::mutex> lock(mtx);
+            procs.insert(Processer::GetCurrentProcesser()->Id());
+        };
+    };
+    WaitUntilNoTaskS(*sched);
+    EXPECT_GT(procs.size(), 1u);
+
+    // 亲和组的协程放在同一个P上, 被偷时整组移动, 不会分散到所有P上
+    std::map<int, int> counts;
+    go_batch(1000) co_scheduler(sched) co_affinity_group(7) [&](std::size_t){
+        std::unique_lock<std::mutex> lock(mtx);
+        ++counts[Processer::GetCurrentProcesser()->Id()];
+    };
+    WaitUntilNoTaskS(*sched);
+    EXPECT_LE(counts.size(), 2u);
+
+    // 执行函数列表
+    std::atomic<int> sum{0};
+    std::vector<TaskF> fns;
+    for (int i = 1; i <= 100; ++i)
+        fns.push_back([&, i]{ sum += i; });
+    sched->CreateTasks(fns, TaskOpt());
+    sched->CreateTasks(std::vector<TaskF>(), TaskOpt());
+    WaitUntilNoTaskS(*sched);
+    EXPECT_EQ(sum, 5050);
+
+    sched->Stop();
+}
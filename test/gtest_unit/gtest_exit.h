@@ -33,7 +33,7 @@ inline void __WaitUntilNoTask(co::Scheduler & scheduler, int line, std::size_t v
     while (scheduler.TaskCount() > val) {
         usleep(1000);
         if (++i == 9000) {
-            printf("LINE: %d, TaskCount: %d\n", line, (int)g_Scheduler.TaskCount());
+            printf("LINE: %d, TaskCount: %d\n", line, (int)scheduler.TaskCount());
         }
     }
 }
@@ -0,0 +1,80 @@
+#include "gtest/gtest.h"
+#include "coroutine.h"
+#include "gtest_exit.h"
+#include <atomic>
+using namespace co;
+
+TEST(Histogram, Buckets)
+{
+    for (uint64_t v = 0; v < 100000; v += 7) {
+        int idx = Histogram::BucketIndex(v);
+        EXPECT_LE(v, Histogram::BucketUpperBound(idx));
+        if (idx > 0) {
+            EXPECT_GT(v, Histogram::BucketUpperBound(idx - 1));
+        }
+    }
+    EXPECT_EQ(Histogram::BucketIndex(uint64_t(1) << 50), Histogram::kBuckets - 1);
+
+    Histogram h;
+    EXPECT_EQ(h.Count(), 0u);
+    EXPECT_EQ(h.Percentile(99), 0u);
+    for (uint64_t v = 1; v <= 1000; ++v)
+        h.Record(v);
+    EXPECT_EQ(h.Count(), 1000u);
+    EXPECT_EQ(h.Min(), 1u);
+    EXPECT_EQ(h.Max(), 1000u);
+    EXPECT_DOUBLE_EQ(h.Mean(), 500.5);
+    EXPECT_NEAR((double)h.Percentile(50), 500, 500 / Histogram::kSubCount);
+    EXPECT_NEAR((double)h.Percentile(99), 990, 990 / Histogram::kSubCount);
+    EXPECT_EQ(h.Percentile(100), 1000u);
+
+    Histogram h2 = h;
+    h2.Merge(h);
+    EXPECT_EQ(h2.Count(), 2000u);
+    EXPECT_EQ(h2.Max(), 1000u);
+    EXPECT_NEAR((double)h2.Percentile(50), 500, 500 / Histogram::kSubCount);
+}
+
+TEST(Histogram, WaitReason)
+{
+    co_opt.enable_coro_stat = true;
+
+    co_mutex mtx;
+    co_chan<int> ch;
+    const int n = 20;
+    for (int i = 0; i < n; ++i) {
+        go [&]{
+            co_sleep(5);
+            std::unique_lock<co_mutex> lock(mtx);
+            co_sleep(1);
+        };
+        go [&]{ int v; ch >> v; };
+    }
+    go [&]{
+        co_sleep(20);
+        for (int i = 0; i < n; ++i)
+            ch << i;
+    };
+    WaitUntilNoTask();
+
+    Histogram sleep = g_Scheduler.GetWaitTime(eSuspendReason::sleep);
+    EXPECT_GE(sleep.Count(), (uint64_t)n * 2);
+    EXPECT_GE(sleep.Percentile(50), 1000u * 1000);
+
+    Histogram channel = g_Scheduler.GetWaitTime(eSuspendReason::channel);
+    EXPECT_GE(channel.Count(), (uint64_t)n);
+    EXPECT_GE(channel.Max(), 10u * 1000 * 1000);
+
+    EXPECT_GE(g_Scheduler.GetWaitTime(eSuspendReason::mutex).Count(), 1u);
+    EXPECT_EQ(g_Scheduler.GetWaitTime(eSuspendReason::condvar).Count(), 0u);
+
+    Histogram latency = g_Scheduler.GetRunQueueLatency();
+    EXPECT_GE(latency.Count(), sleep.Count() + channel.Count());
+
+    Histogram perProc;
+    for (std::size_t i = 0; i < g_Scheduler.ProcesserCount(); ++i)
+        perProc.Merge(g_Scheduler.GetRunQueueLatency(i));
+    EXPECT_EQ(perProc.Count(), latency.Count());
+
+    co_opt.enable_coro_stat = false;
+}
@@ -0,0 +1,99 @@
+#include <iostream>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include <sys/epoll.h>
+#include <fcntl.h>
+#include "coroutine.h"
+#include "netio/unix/hook.h"
+#include "../gtest_exit.h"
+using namespace std;
+using namespace co;
+
+static void add_in(int epfd, int fd)
+{
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    EXPECT_EQ(0, epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev));
+}
+
+// 协程中的epoll_wait挂起协程而不是阻塞线程
+TEST(Epoll, Wait)
+{
+    go []{
+        int epfd = epoll_create1(0);
+        EXPECT_GE(epfd, 0);
+        // 用户视角与创建时一致, 不是非阻塞的
+        EXPECT_FALSE(!!(fcntl(epfd, F_GETFL) & O_NONBLOCK));
+        int fds[2];
+        EXPECT_EQ(0, pipe(fds));
+        add_in(epfd, fds[0]);
+
+        struct epoll_event evs[8];
+
+        // 超时
+        uint32_t yield_count = g_Scheduler.GetCurrentTaskYieldCount();
+        GTimer gt;
+        EXPECT_EQ(0, epoll_wait(epfd, evs, 8, 100));
+        EXPECT_EQ(g_Scheduler.GetCurrentTaskYieldCount(), yield_count + 1);
+        TIMER_CHECK(gt, 100, 50);
+
+        // 其他协程写入后被唤醒
+        go [=]{ usleep(50 * 1000); write(fds[1], "a", 1); };
+        yield_count = g_Scheduler.GetCurrentTaskYieldCount();
+        gt.reset();
+        int n = epoll_wait(epfd, evs, 8, -1);
+        EXPECT_EQ(1, n);
+        EXPECT_EQ(fds[0], evs[0].data.fd);
+        EXPECT_TRUE(!!(evs[0].events & EPOLLIN));
+        EXPECT_EQ(g_Scheduler.GetCurrentTaskYieldCount(), yield_count + 1);
+        TIMER_CHECK(gt, 50, 30);
+
+        // 已经就绪时立即返回
+        yield_count = g_Scheduler.GetCurrentTaskYieldCount();
+        EXPECT_EQ(1, epoll_pwait(epfd, evs, 8, -1, nullptr));
+        EXPECT_LE(g_Scheduler.GetCurrentTaskYieldCount(), yield_count + 1);
+
+        char c;
+        EXPECT_EQ(1, read(fds[0], &c, 1));
+        EXPECT_EQ(0, epoll_wait(epfd, evs, 8, 0));
+
+        close(fds[0]);
+        close(fds[1]);
+        close(epfd);
+    };
+    WaitUntilNoTask();
+}
+
+// 等待期间同一个线程上的其他协程可以继续执行
+TEST(Epoll, NotBlockThread)
+{
+    Scheduler* sched = Scheduler::Create();
+    std::thread([=]{ sched->Start(1, 1); }).detach();
+
+    int fds[2];
+    EXPECT_EQ(0, pipe(fds));
+    std::atomic<int> done{0};
+    go co_scheduler(sched) [&]{
+        int epfd = epoll_create(16);
+        add_in(epfd, fds[0]);
+        struct epoll_event evs[8];
+        EXPECT_EQ(1, epoll_wait(epfd, evs, 8, 3000));
+        close(epfd);
+        ++done;
+    };
+    go co_scheduler(sched) [&]{
+        usleep(20 * 1000);
+        write(fds[1], "a", 1);
+        ++done;
+    };
+
+    GTimer gt;
+    while (done < 2 && gt.ms() < 5000)
+        usleep(1000);
+    EXPECT_EQ(2, done);
+    EXPECT_LT(gt.ms(), 1000);
+    close(fds[0]);
+    close(fds[1]);
+    sched->Stop();
+}
@@ -0,0 +1,262 @@
+#include <iostream>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <gtest/gtest.h>
+#include "coroutine.h"
+#include "netio/unix/hook.h"
+#include <fcntl.h>
+#include <sys/types.h>
+#include <thread>
+#include "../gtest_exit.h"
+#include "hook.h"
+using namespace std;
+using namespace co;
+
+static bool user_nonblock(int fd)
+{
+    return !!(fcntl(fd, F_GETFL) & O_NONBLOCK);
+}
+
+static bool kernel_nonblock(int fd)
+{
+    return !!(fcntl_f(fd, F_GETFL) & O_NONBLOCK);
+}
+
+// hook创建的socket在内核中是非阻塞的, F_GETFL返回用户视角;
+// 显式清除O_NONBLOCK后内核中恢复阻塞. pipe在内核中与用户视角一致.
+TEST(NonBlocking, Flags)
+{
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    EXPECT_FALSE(user_nonblock(sock));
+    EXPECT_TRUE(kernel_nonblock(sock));
+
+    int flags = fcntl(sock, F_GETFL);
+    EXPECT_EQ(0, fcntl(sock, F_SETFL, flags | O_NONBLOCK));
+    EXPECT_TRUE(user_nonblock(sock));
+    EXPECT_TRUE(kernel_nonblock(sock));
+    EXPECT_EQ(0, fcntl(sock, F_SETFL, flags));
+    EXPECT_FALSE(user_nonblock(sock));
+    EXPECT_FALSE(kernel_nonblock(sock));
+
+    int nonblock = 1;
+    EXPECT_EQ(0, ioctl(sock, FIONBIO, &nonblock));
+    EXPECT_TRUE(user_nonblock(sock));
+    EXPECT_TRUE(kernel_nonblock(sock));
+    nonblock = 0;
+    EXPECT_EQ(0, ioctl(sock, FIONBIO, &nonblock));
+    EXPECT_FALSE(user_nonblock(sock));
+    EXPECT_FALSE(kernel_nonblock(sock));
+
+    // dup出的fd继承用户视角
+    int dupfd = fcntl(sock, F_DUPFD, 100);
+    EXPECT_GE(dupfd, 100);
+    EXPECT_FALSE(user_nonblock(dupfd));
+    close(dupfd);
+    close(sock);
+
+    sock = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    EXPECT_TRUE(user_nonblock(sock));
+    close(sock);
+
+    int fds[2];
+    EXPECT_EQ(0, pipe(fds));
+    EXPECT_FALSE(user_nonblock(fds[0]));
+    EXPECT_FALSE(kernel_nonblock(fds[0]));
+    EXPECT_FALSE(kernel_nonblock(fds[1]));
+    close(fds[0]);
+    close(fds[1]);
+
+    EXPECT_EQ(0, pipe2(fds, O_NONBLOCK));
+    EXPECT_TRUE(user_nonblock(fds[0]));
+    EXPECT_TRUE(kernel_nonblock(fds[0]));
+    close(fds[0]);
+    close(fds[1]);
+
+    EXPECT_EQ(0, socketpair(AF_LOCAL, SOCK_STREAM, 0, fds));
+    EXPECT_FALSE(user_nonblock(fds[1]));
+    EXPECT_TRUE(kernel_nonblock(fds[1]));
+    close(fds[0]);
+    close(fds[1]);
+}
+
+// 用户视角阻塞的fd: 协程和原生线程中都保持阻塞语义
+TEST(NonBlocking, BlockingRead)
+{
+    int fds[2];
+    EXPECT_EQ(0, pipe(fds));
+
+    // 原生线程中阻塞等待, 而不是返回EAGAIN
+    std::thread([=]{ usleep(50 * 1000); write(fds[1], "a", 1); }).detach();
+    char c = 0;
+    GTimer gt;
+    EXPECT_EQ(1, read(fds[0], &c, 1));
+    EXPECT_EQ('a', c);
+    TIMER_CHECK(gt, 50, 30);
+
+    // 协程中: 有数据时不切出, 没数据时挂起一次
+    go [=]{
+        write(fds[1], "b", 1);
+        char c = 0;
+        uint32_t yield_count = g_Scheduler.GetCurrentTaskYieldCount();
+        EXPECT_EQ(1, read(fds[0], &c, 1));
+        EXPECT_EQ('b', c);
+        EXPECT_EQ(g_Scheduler.GetCurrentTaskYieldCount(), yield_count);
+
+        go [=]{ usleep(50 * 1000); write(fds[1], "c", 1); };
+        GTimer gt;
+        EXPECT_EQ(1, read(fds[0], &c, 1));
+        EXPECT_EQ('c', c);
+        EXPECT_EQ(g_Scheduler.GetCurrentTaskYieldCount(), yield_count + 1);
+        TIMER_CHECK(gt, 50, 30);
+
+        // MSG_DONTWAIT不等待
+        int sv[2];
+        EXPECT_EQ(0, socketpair(AF_LOCAL, SOCK_STREAM, 0, sv));
+        yield_count = g_Scheduler.GetCurrentTaskYieldCount();
+        EXPECT_EQ(-1, recv(sv[0], &c, 1, MSG_DONTWAIT));
+        EXPECT_EQ(EAGAIN, errno);
+        EXPECT_EQ(g_Scheduler.GetCurrentTaskYieldCount(), yield_count);
+        close(sv[0]);
+        close(sv[1]);
+    };
+    WaitUntilNoTask();
+    close(fds[0]);
+    close(fds[1]);
+}
+
+// 显式设置为阻塞的socket: 内核中阻塞, 协程中仍然只挂起协程
+TEST(NonBlocking, ExplicitBlocking)
+{
+    int sv[2];
+    EXPECT_EQ(0, socketpair(AF_LOCAL, SOCK_STREAM, 0, sv));
+    int flags = fcntl(sv[0], F_GETFL);
+    EXPECT_EQ(0, fcntl(sv[0], F_SETFL, flags & ~O_NONBLOCK));
+    EXPECT_FALSE(kernel_nonblock(sv[0]));
+
+    std::atomic<int> done{0};
+    go [&]{
+        char c = 0;
+        uint32_t yield_count = g_Scheduler.GetCurrentTaskYieldCount();
+        EXPECT_EQ(1, read(sv[0], &c, 1));
+        EXPECT_EQ('a', c);
+        EXPECT_EQ(g_Scheduler.GetCurrentTaskYieldCount(), yield_count + 1);
+        ++done;
+    };
+    go [&]{
+        usleep(20 * 1000);
+        EXPECT_EQ(1, write(sv[1], "a", 1));
+        ++done;
+    };
+    WaitUntilNoTask();
+    EXPECT_EQ(2, done);
+    close(sv[0]);
+    close(sv[1]);
+}
+
+// dup2到标准输入输出上的socket在内核中恢复阻塞
+TEST(NonBlocking, DupToStdio)
+{
+    int sv[2];
+    EXPECT_EQ(0, socketpair(AF_LOCAL, SOCK_STREAM, 0, sv));
+    EXPECT_TRUE(kernel_nonblock(sv[0]));
+
+    int saved = dup(STDIN_FILENO);
+    EXPECT_EQ(STDIN_FILENO, dup2(sv[0], STDIN_FILENO));
+    EXPECT_FALSE(kernel_nonblock(STDIN_FILENO));
+    EXPECT_FALSE(kernel_nonblock(sv[0]));
+    EXPECT_FALSE(user_nonblock(STDIN_FILENO));
+
+    dup2(saved, STDIN_FILENO);
+    close(saved);
+    close(sv[0]);
+    close(sv[1]);
+}
+
+// 阻塞式connect: 没有O_NONBLOCK的来回切换, 错误码与阻塞式一致
+TEST(NonBlocking, Connect)
+{
+    int listenSock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(0);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    EXPECT_EQ(0, ::bind(listenSock, (sockaddr*)&addr, sizeof(addr)));
+    EXPECT_EQ(0, listen(listenSock, 5));
+    socklen_t addrLen = sizeof(addr);
+    EXPECT_EQ(0, getsockname(listenSock, (sockaddr*)&addr, &addrLen));
+
+    go [=]{
+        int sock = socket(AF_INET, SOCK_STREAM, 0);
+        EXPECT_EQ(0, connect(sock, (sockaddr*)&addr, sizeof(addr)));
+        EXPECT_FALSE(user_nonblock(sock));
+        EXPECT_EQ(1, write(sock, "x", 1));
+        close(sock);
+    };
+
+    go [=]{
+        sockaddr_in peer;
+        socklen_t len = sizeof(peer);
+        int sock = accept(listenSock, (sockaddr*)&peer, &len);
+        EXPECT_GT(sock, 0);
+        EXPECT_FALSE(user_nonblock(sock));
+        EXPECT_TRUE(kernel_nonblock(sock));
+        char c = 0;
+        EXPECT_EQ(1, read(sock, &c, 1));
+        EXPECT_EQ('x', c);
+        close(sock);
+    };
+    WaitUntilNoTask();
+    close(listenSock);
+
+    // 端口上没有监听者
+    go [=]{
+        int sock = socket(AF_INET, SOCK_STREAM, 0);
+        EXPECT_EQ(-1, connect(sock, (sockaddr*)&addr, sizeof(addr)));
+        EXPECT_EQ(ECONNREFUSED, errno);
+        close(sock);
+    };
+    WaitUntilNoTask();
+}
+
+// accept4的SOCK_NONBLOCK/SOCK_CLOEXEC只影响用户视角, 内核中总是非阻塞
+TEST(NonBlocking, Accept4)
+{
+    int listenSock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(0);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    EXPECT_EQ(0, ::bind(listenSock, (sockaddr*)&addr, sizeof(addr)));
+    EXPECT_EQ(0, listen(listenSock, 5));
+    socklen_t addrLen = sizeof(addr);
+    EXPECT_EQ(0, getsockname(listenSock, (sockaddr*)&addr, &addrLen));
+
+    for (int i = 0; i < 2; ++i) {
+        go [=]{
+            int sock = socket(AF_INET, SOCK_STREAM, 0);
+            EXPECT_EQ(0, connect(sock, (sockaddr*)&addr, sizeof(addr)));
+            EXPECT_EQ(1, write(sock, "x", 1));
+            close(sock);
+        };
+    }
+
+    go [=]{
+        int flags[2] = {SOCK_CLOEXEC, SOCK_NONBLOCK | SOCK_CLOEXEC};
+        for (int i = 0; i < 2; ++i) {
+            int sock = accept4(listenSock, nullptr, nullptr, flags[i]);
+            EXPECT_GT(sock, 0);
+            EXPECT_EQ(!!(flags[i] & SOCK_NONBLOCK), user_nonblock(sock));
+            EXPECT_TRUE(kernel_nonblock(sock));
+            EXPECT_TRUE(!!(fcntl_f(sock, F_GETFD) & FD_CLOEXEC));
+            char c = 0;
+            while (read(sock, &c, 1) == -1 && errno == EAGAIN)
+                co_yield;
+            EXPECT_EQ('x', c);
+            close(sock);
+        }
+    };
+    WaitUntilNoTask();
+    close(listenSock);
+}
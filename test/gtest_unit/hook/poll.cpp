@@ -6,6 +6,7 @@
 #include <boost/thread.hpp>
 #include <sys/socket.h>
 #include "coroutine.h"
+#include "netio/unix/reactor.h"
 #include "../gtest_exit.h"
 #include "hook.h"
 using namespace std;
@@ -642,3 +643,116 @@ TEST(Poll, MultiThreads)
         };
     WaitUntilNoTask();
 }
+
+static uint64_t reactorCtls()
+{
+    uint64_t n = 0;
+    for (auto & stat : Reactor::GetStats())
+        n += stat.ctls_;
+    return n;
+}
+
+// 同一个协程连续poll同一组fd: 只有触发过的fd重新注册, 且保持水平触发语义
+TEST(Poll, RepeatedSet)
+{
+    go [] {
+        const int cPipes = 200;
+        std::vector<int> rds, wrs;
+        std::vector<pollfd> pfds;
+        for (int i = 0; i < cPipes; ++i) {
+            int fds[2];
+            EXPECT_EQ(pipe(fds), 0);
+            rds.push_back(fds[0]);
+            wrs.push_back(fds[1]);
+            pfds.push_back(pollfd{fds[0], POLLIN, 0});
+        }
+
+        // 第一次注册全部fd
+        EXPECT_EQ(poll(pfds.data(), pfds.size(), 10), 0);
+
+        char c = 'x';
+        uint64_t ctls = reactorCtls();
+        for (int round = 0; round < 50; ++round) {
+            int idx = round * 7 % cPipes;
+            go [&, idx]{ write(wrs[idx], &c, 1); };
+            int n = poll(pfds.data(), pfds.size(), 1000);
+            EXPECT_EQ(n, 1);
+            EXPECT_EQ(pfds[idx].revents, POLLIN);
+            EXPECT_EQ(read(rds[idx], &c, 1), 1);
+        }
+        // 每轮只有被触发的fd需要epoll_ctl(摘除+重新注册), 与fd总数无关
+        EXPECT_LT(reactorCtls() - ctls, 50u * 4);
+
+        // 没读走的数据下次poll仍然返回
+        write(wrs[3], &c, 1);
+        EXPECT_EQ(poll(pfds.data(), pfds.size(), 1000), 1);
+        EXPECT_EQ(pfds[3].revents, POLLIN);
+        EXPECT_EQ(poll(pfds.data(), pfds.size(), 1000), 1);
+        EXPECT_EQ(pfds[3].revents, POLLIN);
+        EXPECT_EQ(read(rds[3], &c, 1), 1);
+
+        // 两次poll之间到达的数据
+        EXPECT_EQ(poll(pfds.data(), pfds.size(), 10), 0);
+        write(wrs[5], &c, 1);
+        co_sleep(10);
+        EXPECT_EQ(poll(pfds.data(), pfds.size(), 1000), 1);
+        EXPECT_EQ(pfds[5].revents, POLLIN);
+        EXPECT_EQ(read(rds[5], &c, 1), 1);
+
+        // 关闭后重新打开同一个fd
+        close(rds[9]);
+        close(wrs[9]);
+        int fds[2];
+        EXPECT_EQ(pipe(fds), 0);
+        EXPECT_EQ(fds[0], rds[9]);
+        wrs[9] = fds[1];
+        write(wrs[9], &c, 1);
+        EXPECT_EQ(poll(pfds.data(), pfds.size(), 1000), 1);
+        EXPECT_EQ(pfds[9].revents, POLLIN);
+
+        for (int i = 0; i < cPipes; ++i) {
+            close(rds[i]);
+            close(wrs[i]);
+        }
+    };
+    WaitUntilNoTask();
+}
+
+// 进入等待前触发的事件不会丢失: 多线程调度下反复乒乓, 阻塞读不会永远挂起
+TEST(Poll, WakeupRace)
+{
+    Scheduler* sched = Scheduler::Create();
+    std::thread([=]{ sched->Start(4, 4); }).detach();
+
+    const int cPairs = 8;
+    const int cRounds = 2000;
+    std::atomic<int> done{0};
+    for (int p = 0; p < cPairs; ++p) {
+        int sv[2];
+        EXPECT_EQ(0, socketpair(AF_LOCAL, SOCK_STREAM, 0, sv));
+        go co_scheduler(sched) [=, &done]{
+            char c = 'x';
+            for (int i = 0; i < cRounds; ++i) {
+                EXPECT_EQ(1, write(sv[0], &c, 1));
+                EXPECT_EQ(1, read(sv[0], &c, 1));
+            }
+            close(sv[0]);
+            ++done;
+        };
+        go co_scheduler(sched) [=, &done]{
+            char c;
+            for (int i = 0; i < cRounds; ++i) {
+                EXPECT_EQ(1, read(sv[1], &c, 1));
+                EXPECT_EQ(1, write(sv[1], &c, 1));
+            }
+            close(sv[1]);
+            ++done;
+        };
+    }
+
+    for (int i = 0; i < 30000 && done < cPairs * 2; ++i)
+        usleep(1000);
+    EXPECT_EQ(done, cPairs * 2);
+    if (done == cPairs * 2)
+        sched->Stop();
+}
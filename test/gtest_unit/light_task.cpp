@@ -0,0 +1,120 @@
+#include "gtest/gtest.h"
+#include "coroutine.h"
+#include "gtest_exit.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <sys/wait.h>
+using namespace co;
+
+TEST(LightTask, Post)
+{
+    // 在P的线程中执行, 对外表现为原生线程
+    std::atomic<int> done{0};
+    std::atomic<int> inCoroutine{0};
+    for (int i = 0; i < 1000; ++i) {
+        co::post([&]{
+                if (Processer::IsCoroutine()) ++inCoroutine;
+                if (!Processer::GetCurrentProcesser()) ++inCoroutine;
+                co_yield;   // 不能让出, 什么都不做
+                ++done;
+            });
+    }
+    WaitUntilNoTask();
+    EXPECT_EQ(done, 1000);
+    EXPECT_EQ(inCoroutine, 0);
+
+    // go_fn语法, 协程中创建, 与协程混合调度
+    std::atomic<int> light{0}, full{0};
+    go [&]{
+        for (int i = 0; i < 100; ++i) {
+            go_fn [&]{ ++light; };
+            go [&]{ co_yield; ++full; };
+        }
+    };
+    WaitUntilNoTask();
+    EXPECT_EQ(light, 100);
+    EXPECT_EQ(full, 100);
+
+    // 批量创建
+    std::atomic<int> batch{0};
+    go_batch(1000) co_light [&](std::size_t){ ++batch; };
+    WaitUntilNoTask();
+    EXPECT_EQ(batch, 1000);
+}
+
+TEST(LightTask, Priority)
+{
+    // 经过同样的可执行队列: 优先级有效, 与协程按优先级交错执行
+    Scheduler* sched = Scheduler::Create();
+
+    std::mutex mtx;
+    std::string order;
+    auto record = [&](char c) {
+        std::unique_lock<std::mutex> lock(mtx);
+        order += c;
+    };
+
+    // 启动前创建, 都在同一个P的新协程队列中
+    go_fn co_scheduler(sched) co_priority(priority_low) [&]{ record('l'); };
+    go co_scheduler(sched) co_priority(priority_low) [&]{ record('L'); };
+    go_fn co_scheduler(sched) [&]{ record('n'); };
+    go co_scheduler(sched) co_priority(priority_high) [&]{ record('H'); };
+    go_fn co_scheduler(sched) co_priority(priority_high) [&]{ record('h'); };
+
+    std::thread([=]{ sched->Start(1, 1); }).detach();
+    while (sched->TaskCount())
+        usleep(1000);
+    EXPECT_EQ(order, "HhnlL");
+    sched->Stop();
+}
+
+// debug版本断言失败, release版本打印错误后继续执行
+static bool ExitedOrAborted(int status)
+{
+    return (WIFEXITED(status) && WEXITSTATUS(status) == 0) ||
+        (WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT);
+}
+
+TEST(LightTask, Blocking)
+{
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+
+    // 不会阻塞的调用正常执行
+    std::atomic<int> done{0};
+    co_chan<int> ch(1);
+    co::post([&]{
+            usleep(0);
+            ch << 1;
+            int v;
+            ch >> v;
+            ++done;
+        });
+    WaitUntilNoTask();
+    EXPECT_EQ(done, 1);
+
+    // 阻塞操作报错
+    EXPECT_EXIT({
+            co::post([]{ usleep(1000); });
+            WaitUntilNoTask();
+            exit(0);
+        }, ExitedOrAborted, "light task.*calls blocking usleep");
+
+    EXPECT_EXIT({
+            co_chan<int> empty;
+            co::post([=]{ int v; empty.TimedPop(v, std::chrono::milliseconds(1)); });
+            WaitUntilNoTask();
+            exit(0);
+        }, ExitedOrAborted, "light task.*calls blocking condition_variable wait");
+
+    EXPECT_EXIT({
+            int fds[2];
+            pipe(fds);
+            co::post([=]{
+                    struct pollfd pfd = {fds[0], POLLIN, 0};
+                    poll(&pfd, 1, 1);
+                });
+            WaitUntilNoTask();
+            exit(0);
+        }, ExitedOrAborted, "light task.*calls blocking poll");
+}
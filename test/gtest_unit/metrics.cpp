@@ -0,0 +1,85 @@
+#include "gtest/gtest.h"
+#include "coroutine.h"
+#include "gtest_exit.h"
+#include <atomic>
+#include <string>
+#include <thread>
+using namespace co;
+
+TEST(Metrics, Builtin)
+{
+    int64_t created = Metrics::getInstance().GetValue(eMetric::tasks_created);
+    int64_t finished = Metrics::getInstance().GetValue(eMetric::tasks_finished);
+    int64_t sends = Metrics::getInstance().GetValue(eMetric::channel_sends);
+    int64_t recvs = Metrics::getInstance().GetValue(eMetric::channel_recvs);
+
+    co_chan<int> ch(10);
+    for (int i = 0; i < 100; ++i)
+        go [=]{ ch << i; int v; ch >> v; };
+    WaitUntilNoTask();
+
+    EXPECT_EQ(Metrics::getInstance().GetValue(eMetric::tasks_created) - created, 100);
+    EXPECT_EQ(Metrics::getInstance().GetValue(eMetric::tasks_finished) - finished, 100);
+    EXPECT_EQ(Metrics::getInstance().GetValue(eMetric::channel_sends) - sends, 100);
+    EXPECT_EQ(Metrics::getInstance().GetValue(eMetric::channel_recvs) - recvs, 100);
+    EXPECT_GE(Metrics::getInstance().GetValue(eMetric::task_switches), 100);
+}
+
+TEST(Metrics, Sharded)
+{
+    Metrics::Counter counter = Metrics::getInstance().NewCounter(
+            "test_requests_total", "Test requests.", "method=\"get\"");
+    Metrics::Gauge gauge = Metrics::getInstance().NewGauge("test_inflight", "Test inflight.");
+    Metrics::HistogramMetric hist = Metrics::getInstance().NewHistogram(
+            "test_latency_us", "Test latency.");
+
+    // 退出的线程的值不能丢
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back([&]{
+                    for (int i = 0; i < 10000; ++i) {
+                        counter.Inc();
+                        gauge.Add(2);
+                        gauge.Sub(1);
+                        hist.Record(i);
+                    }
+                });
+    for (auto & thr : threads)
+        thr.join();
+
+    EXPECT_EQ(counter.Value(), 40000);
+    EXPECT_EQ(gauge.Value(), 40000);
+    Histogram h = hist.Value();
+    EXPECT_EQ(h.Count(), 40000u);
+    EXPECT_EQ(h.Max(), 9999u);
+
+    counter.Inc(5);
+    EXPECT_EQ(counter.Value(), 40005);
+}
+
+TEST(Metrics, Prometheus)
+{
+    Metrics::getInstance().NewCounter("test_export_total", "Export test.", "code=\"200\"").Inc(3);
+    Metrics::getInstance().NewCounter("test_export_total", "Export test.", "code=\"500\"").Inc(1);
+    Metrics::getInstance().RegisterFunc(eMetricType::gauge, "test_func", "Func gauge.", "",
+            []{ return 42.0; });
+
+    go []{ co_sleep(1); };
+    WaitUntilNoTask();
+
+    std::string s = Metrics::getInstance().ExportPrometheus();
+
+    // 同名指标只输出一次HELP/TYPE
+    std::size_t pos = s.find("# TYPE test_export_total counter\n");
+    ASSERT_NE(pos, std::string::npos) << s;
+    EXPECT_EQ(s.find("# TYPE test_export_total", pos + 1), std::string::npos);
+    EXPECT_NE(s.find("test_export_total{code=\"200\"} 3\n"), std::string::npos) << s;
+    EXPECT_NE(s.find("test_export_total{code=\"500\"} 1\n"), std::string::npos) << s;
+    EXPECT_NE(s.find("test_func 42\n"), std::string::npos) << s;
+
+    EXPECT_NE(s.find("# TYPE libgo_tasks_created_total counter\n"), std::string::npos);
+    EXPECT_NE(s.find("# TYPE libgo_tasks gauge\n"), std::string::npos);
+    EXPECT_NE(s.find("libgo_timers_started_total "), std::string::npos);
+    EXPECT_NE(s.find("libgo_wait_time_ns_bucket{reason=\"io\",le=\"+Inf\"} "), std::string::npos) << s;
+    EXPECT_NE(s.find("test_latency_us_bucket{le=\"15\"} "), std::string::npos) << s;
+}
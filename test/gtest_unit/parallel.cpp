@@ -0,0 +1,118 @@
+#include "gtest/gtest.h"
+#include "coroutine.h"
+#include "gtest_exit.h"
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+using namespace co;
+
+TEST(Parallel, For)
+{
+    while (g_Scheduler.ProcesserCount() < TEST_MIN_THREAD)
+        usleep(1000);
+
+    // 原生线程中调用, 每个下标恰好执行一次, 并拆分到多个P上执行
+    const int n = 100000;
+    std::vector<std::atomic<int>> hits(n);
+    for (auto & h : hits) h = 0;
+    std::mutex mtx;
+    std::set<int> procs;
+    parallel_for(0, n, [&](int i){
+            ++hits[i];
+            if (i % 100 == 0) {
+                usleep(100);
+                std::unique_lock<std::mutex> lock(mtx);
+                procs.insert(Processer::GetCurrentProcesser() ? Processer::GetCurrentProcesser()->Id() : -1);
+            }
+        });
+    int wrong = 0;
+    for (auto & h : hits)
+        if (h != 1) ++wrong;
+    EXPECT_EQ(wrong, 0);
+    EXPECT_GT(procs.size(), 2u);
+
+    // 协程中调用
+    std::atomic<long> sum{0};
+    std::atomic<int> done{0};
+    go [&]{
+        parallel_for(1, 1001, [&](int i){ sum += i; }, 16);
+        ++done;
+    };
+    WaitUntilNoTask();
+    EXPECT_EQ(done, 1);
+    EXPECT_EQ(sum, 500500);
+
+    // 空区间
+    parallel_for(5, 5, [&](int){ ++sum; });
+    EXPECT_EQ(sum, 500500);
+}
+
+TEST(Parallel, Busy)
+{
+    // 所有P都忙时不拆分, 在调用者中顺序执行
+    std::atomic<bool> stop{false};
+    for (int i = 0; i < TEST_MAX_THREAD * 2; ++i)
+        go [&]{ while (!stop) co_yield; };
+    while (g_Scheduler.IdleProcesserCount())
+        usleep(1000);
+
+    uint32_t tasks = g_Scheduler.TaskCount();
+    std::atomic<int> maxTasks{0};
+    parallel_for(0, 1000, [&](int){
+            int cur = g_Scheduler.TaskCount();
+            if (cur > maxTasks) maxTasks = cur;
+        });
+    EXPECT_EQ((uint32_t)maxTasks, tasks);
+
+    stop = true;
+    WaitUntilNoTask();
+}
+
+TEST(Parallel, Transform)
+{
+    std::vector<int> in(50000);
+    for (std::size_t i = 0; i < in.size(); ++i)
+        in[i] = (int)i;
+    std::vector<std::string> out(in.size());
+    auto end = parallel_transform(in.begin(), in.end(), out.begin(),
+            [](int v){ return std::to_string(v * 2); });
+    EXPECT_TRUE(end == out.end());
+    int wrong = 0;
+    for (std::size_t i = 0; i < in.size(); ++i)
+        if (out[i] != std::to_string(i * 2)) ++wrong;
+    EXPECT_EQ(wrong, 0);
+}
+
+TEST(Parallel, Reduce)
+{
+    long sum = parallel_reduce(0, 1000000, 0L,
+            [](int i){ return (long)i; },
+            [](long a, long b){ return a + b; });
+    EXPECT_EQ(sum, 1000000L * 999999 / 2);
+
+    // 只满足结合律: 按区间顺序归约
+    std::string s = parallel_reduce(0, 2000, std::string(),
+            [](int i){ return std::string(1, (char)('a' + i % 26)); },
+            [](std::string a, std::string const& b){ return a + b; }, 7);
+    std::string expect;
+    for (int i = 0; i < 2000; ++i)
+        expect += (char)('a' + i % 26);
+    EXPECT_EQ(s, expect);
+
+    int empty = parallel_reduce(3, 3, 42, [](int i){ return i; }, [](int a, int b){ return a + b; });
+    EXPECT_EQ(empty, 42);
+}
+
+TEST(Parallel, Exception)
+{
+    std::atomic<int> count{0};
+    EXPECT_THROW(parallel_for(0, 100000, [&](int i){
+                ++count;
+                if (i == 500)
+                    throw std::runtime_error("parallel");
+            }, 10), std::runtime_error);
+    EXPECT_LT(count, 100000);
+    WaitUntilNoTask();
+}
@@ -0,0 +1,52 @@
+#include "gtest/gtest.h"
+#include "coroutine.h"
+#include "gtest_exit.h"
+#include <atomic>
+#include <chrono>
+using namespace co;
+using namespace std::chrono;
+
+// 单线程调度器上一个协程长时间计算, 其他协程能否执行
+static int RunWhileSpinning(Scheduler* sched, int spinMs)
+{
+    std::atomic<bool> spinning{true};
+    std::atomic<int> ticks{0};
+    go co_scheduler(sched) [&]{
+        auto end = steady_clock::now() + milliseconds(spinMs);
+        while (steady_clock::now() < end)
+            co::preempt_check();
+        spinning = false;
+    };
+    go co_scheduler(sched) [&]{
+        while (spinning) {
+            ++ticks;
+            co_yield;
+        }
+    };
+    WaitUntilNoTaskS(*sched);
+    return ticks;
+}
+
+TEST(Preempt, Check)
+{
+    EXPECT_FALSE(co::preempt_check());
+
+    Scheduler* sched = Scheduler::Create();
+    std::thread([=]{ sched->Start(1, 1); }).detach();
+
+    int64_t preemptions = Metrics::getInstance().GetValue(eMetric::preemptions);
+    co_opt.preempt_timeslice_us = 5 * 1000;
+    int ticks = RunWhileSpinning(sched, 200);
+    EXPECT_GT(ticks, 10);
+    EXPECT_GT(Metrics::getInstance().GetValue(eMetric::preemptions) - preemptions, 10);
+
+    // 关闭抢占后长时间计算的协程一直占用线程
+    co_opt.preempt_timeslice_us = 0;
+    go co_scheduler(sched) []{};    // 让P开始新一轮调度, 更新时间片
+    WaitUntilNoTaskS(*sched);
+    ticks = RunWhileSpinning(sched, 100);
+    EXPECT_LE(ticks, 1);
+
+    co_opt.preempt_timeslice_us = 10 * 1000;
+    sched->Stop();
+}
@@ -0,0 +1,130 @@
+#include "gtest/gtest.h"
+#include "coroutine.h"
+#include "gtest_exit.h"
+#include <atomic>
+#include <string>
+#include <mutex>
+using namespace co;
+
+TEST(Priority, Order)
+{
+    Scheduler* sched = Scheduler::Create();
+
+    std::mutex mtx;
+    std::string order;
+    auto record = [&](char c) {
+        std::unique_lock<std::mutex> lock(mtx);
+        order += c;
+    };
+
+    // 启动前创建, 都在同一个P的新协程队列中
+    for (int i = 0; i < 3; ++i)
+        go co_scheduler(sched) co_priority(priority_low) [&]{ record('L'); };
+    for (int i = 0; i < 3; ++i)
+        go co_scheduler(sched) [&]{ record('N'); };
+    go co_scheduler(sched) co_priority(priority_high) [&]{ record('H'); };
+
+    std::thread([=]{ sched->Start(1, 1); }).detach();
+    WaitUntilNoTaskS(*sched);
+    EXPECT_EQ(order, "HNNNLLL");
+
+    // 低优先级协程运行中创建高优先级协程, 下一次切换就执行高优先级协程
+    order.clear();
+    go co_scheduler(sched) co_priority(priority_low) [&]{
+        for (int i = 0; i < 3; ++i)
+            go co_scheduler(sched) co_priority(priority_low) [&]{ record('L'); };
+        go co_scheduler(sched) co_priority(priority_high) [&]{ record('H'); };
+        co_yield;
+        record('l');
+    };
+    WaitUntilNoTaskS(*sched);
+    EXPECT_EQ(order[0], 'H') << order;
+    EXPECT_EQ(order.size(), 5u);
+
+    sched->Stop();
+}
+
+TEST(Priority, Starvation)
+{
+    Scheduler* sched = Scheduler::Create();
+    std::thread([=]{ sched->Start(1, 1); }).detach();
+
+    // 高优先级协程一直让出CPU, 低优先级协程仍然可以执行
+    std::atomic<bool> lowDone{false};
+    go co_scheduler(sched) co_priority(priority_high) [&]{
+        while (!lowDone)
+            co_yield;
+    };
+    go co_scheduler(sched) co_priority(priority_low) [&]{
+        for (int i = 0; i < 10; ++i)
+            co_yield;
+        lowDone = true;
+    };
+    WaitUntilNoTaskS(*sched);
+    EXPECT_TRUE(lowDone);
+
+    sched->Stop();
+}
+
+TEST(Priority, StarvationRound)
+{
+    Scheduler* sched = Scheduler::Create();
+    std::thread([=]{ sched->Start(1, 1); }).detach();
+
+    // 高优先级负载从不停止时, 饥饿保护的一轮要执行完整个低优先级队列,
+    // 而不是只执行一个协程就被抢占: 每limit轮高优先级, 每个低优先级协程各执行一次.
+    const int cLow = 8;
+    const uint32_t limit = CoroutineOptions::getInstance().priority_starvation_limit;
+    std::atomic<bool> stop{false};
+    std::atomic<long> high{0}, low{0};
+    go co_scheduler(sched) co_priority(priority_high) [&]{
+        while (!stop) {
+            ++high;
+            co_yield;
+        }
+    };
+    for (int i = 0; i < cLow; ++i)
+        go co_scheduler(sched) co_priority(priority_low) [&]{
+            while (!stop) {
+                ++low;
+                co_yield;
+            }
+        };
+
+    usleep(200 * 1000);
+    stop = true;
+    WaitUntilNoTaskS(*sched);
+
+    long expectLow = high / limit * cLow;
+    EXPECT_GT(high, (long)limit * 10);
+    EXPECT_GE(low, expectLow / 2) << "high=" << high << " low=" << low;
+    EXPECT_LE(low, expectLow * 2 + cLow * 2) << "high=" << high << " low=" << low;
+
+    sched->Stop();
+}
+
+TEST(Priority, Yield)
+{
+    // 同一优先级内仍然轮流执行, 不会因为被抢占而总是从队首开始
+    std::atomic<int> counts[8];
+    for (auto & c : counts) c = 0;
+    std::atomic<bool> stop{false};
+    for (int i = 0; i < 8; ++i)
+        go co_priority(priority_low) [&, i]{
+            while (!stop) {
+                ++counts[i];
+                co_yield;
+            }
+        };
+
+    for (int i = 0; i < 200; ++i) {
+        go co_priority(priority_high) []{ co_yield; };
+        usleep(500);
+    }
+    stop = true;
+    WaitUntilNoTask();
+
+    for (auto & c : counts) {
+        EXPECT_GT(c, 0);
+    }
+}
@@ -0,0 +1,72 @@
+#include "gtest/gtest.h"
+#include "coroutine.h"
+#include "gtest_exit.h"
+#include <atomic>
+#include <string>
+#include <fstream>
+using namespace co;
+
+static volatile uint64_t g_sink = 0;
+
+static void BusyLoop(int ms)
+{
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    while (std::chrono::steady_clock::now() < end) {
+        for (int i = 0; i < 1000; ++i)
+            g_sink += i;
+    }
+}
+
+TEST(Profiler, CallSite)
+{
+    ASSERT_TRUE(Profiler::getInstance().Start(1000));
+    EXPECT_FALSE(Profiler::getInstance().Start(1000));
+
+    int busyLine = __LINE__ + 1;
+    go []{ BusyLoop(300); };
+    WaitUntilNoTask();
+
+    Profiler::getInstance().Stop();
+    EXPECT_FALSE(Profiler::getInstance().IsRunning());
+    EXPECT_GT(Profiler::getInstance().SampleCount(), 0u);
+
+    std::string report = Profiler::getInstance().GetCallSiteReport();
+    std::string site = std::string(__FILE__) + ":" + std::to_string(busyLine);
+    EXPECT_NE(report.find(site), std::string::npos) << report;
+
+    std::string collapsed = Profiler::getInstance().DumpCollapsed();
+    EXPECT_NE(collapsed.find(site + ";"), std::string::npos);
+
+    const char* filename = "/tmp/libgo_profiler_test.prof";
+    ASSERT_TRUE(Profiler::getInstance().DumpPprof(filename));
+    std::ifstream ifs(filename, std::ios::binary);
+    uintptr_t header[5] = {};
+    ifs.read((char*)header, sizeof(header));
+    EXPECT_EQ(header[0], 0u);
+    EXPECT_EQ(header[1], 3u);
+    EXPECT_EQ(header[3], 1000u);
+    unlink(filename);
+
+    Profiler::getInstance().Clear();
+    EXPECT_EQ(Profiler::getInstance().SampleCount(), 0u);
+}
+
+TEST(Profiler, Overwrite)
+{
+    // 缓冲区写满后覆盖最旧的样本, 继续记录最近的样本
+    ASSERT_TRUE(Profiler::getInstance().Start(1000, 4));
+    int oldLine = __LINE__ + 1;
+    go []{ BusyLoop(100); };
+    WaitUntilNoTask();
+    int newLine = __LINE__ + 1;
+    go []{ BusyLoop(100); };
+    WaitUntilNoTask();
+    Profiler::getInstance().Stop();
+    EXPECT_EQ(Profiler::getInstance().SampleCount(), 4u);
+    EXPECT_GT(Profiler::getInstance().DroppedCount(), 0u);
+
+    std::string report = Profiler::getInstance().GetCallSiteReport();
+    EXPECT_EQ(report.find(std::string(__FILE__) + ":" + std::to_string(oldLine)), std::string::npos) << report;
+    EXPECT_NE(report.find(std::string(__FILE__) + ":" + std::to_string(newLine)), std::string::npos) << report;
+    Profiler::getInstance().Clear();
+}
@@ -0,0 +1,74 @@
+#include "gtest/gtest.h"
+#include "coroutine.h"
+#include "gtest_exit.h"
+#include <atomic>
+#include <chrono>
+using namespace co;
+using namespace std::chrono;
+
+static void Spin(int ms)
+{
+    auto end = steady_clock::now() + milliseconds(ms);
+    while (steady_clock::now() < end) ;
+}
+
+static bool WaitFor(std::function<bool()> const& cond, int timeoutMs)
+{
+    for (int i = 0; i < timeoutMs && !cond(); ++i)
+        usleep(1000);
+    return cond();
+}
+
+// 长时间阻塞线程的协程, 迫使调度器扩展线程
+static void BlockingBurst(Scheduler* sched, int n)
+{
+    for (int i = 0; i < n; ++i)
+        go co_scheduler(sched) []{ Spin(300); };
+}
+
+TEST(Retire, Shrink)
+{
+    co_opt.processer_idle_retire_ms = 200;
+    Scheduler* sched = Scheduler::Create();
+    std::thread([=]{ sched->Start(1, 4); }).detach();
+
+    // 挂起在各个P上的协程, 退役后被唤醒时要转交给其他P
+    co_chan<int> ch;
+    std::atomic<int> received{0};
+    for (int i = 0; i < 100; ++i)
+        go co_scheduler(sched) [&]{
+            int v;
+            ch >> v;
+            ++received;
+        };
+
+    BlockingBurst(sched, 6);
+    EXPECT_TRUE(WaitFor([=]{ return sched->RunningProcesserCount() > 1; }, 3000));
+    std::size_t expanded = sched->ProcesserCount();
+
+    // 阻塞结束并空闲一段时间后回落到minThreadNumber
+    EXPECT_TRUE(WaitFor([=]{ return sched->RunningProcesserCount() == 1; }, 10000))
+        << sched->RunningProcesserCount();
+
+    go co_scheduler(sched) [&]{
+        for (int i = 0; i < 100; ++i)
+            ch << i;
+    };
+    EXPECT_TRUE(WaitFor([=]{ return sched->TaskCount() == 0; }, 3000)) << sched->TaskCount();
+    EXPECT_EQ(received, 100);
+
+    // 再次阻塞时重新启用退役的P, 不再创建新的P
+    BlockingBurst(sched, 6);
+    EXPECT_TRUE(WaitFor([=]{ return sched->RunningProcesserCount() > 1; }, 3000));
+    EXPECT_TRUE(WaitFor([=]{ return sched->TaskCount() == 0; }, 5000));
+    EXPECT_LE(sched->ProcesserCount(), (std::max<std::size_t>)(expanded, 4));
+
+    std::atomic<int> done{0};
+    for (int i = 0; i < 1000; ++i)
+        go co_scheduler(sched) [&]{ co_yield; ++done; };
+    EXPECT_TRUE(WaitFor([=]{ return sched->TaskCount() == 0; }, 3000));
+    EXPECT_EQ(done, 1000);
+
+    co_opt.processer_idle_retire_ms = 60 * 1000;
+    sched->Stop();
+}
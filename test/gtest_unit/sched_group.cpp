@@ -0,0 +1,111 @@
+#include "gtest/gtest.h"
+#include "coroutine.h"
+#include "gtest_exit.h"
+#include <atomic>
+#include <chrono>
+using namespace co;
+using namespace std::chrono;
+
+static void Spin(int us)
+{
+    auto end = steady_clock::now() + microseconds(us);
+    while (steady_clock::now() < end) ;
+}
+
+static void SpinTasks(Scheduler* sched, SchedulingGroup* group, int n, std::atomic<bool> & stop)
+{
+    for (int i = 0; i < n; ++i)
+        go co_scheduler(sched) co_group(group) [&]{
+            while (!stop) {
+                Spin(100);
+                co_yield;
+            }
+        };
+}
+
+TEST(SchedGroup, Quota)
+{
+    Scheduler* sched = Scheduler::Create();
+    std::thread([=]{ sched->Start(1, 1); }).detach();
+
+    // 每100ms最多使用20ms
+    SchedulingGroup* group = SchedulingGroup::Create("test_quota", 100, 20 * 1000, 100 * 1000);
+    std::atomic<bool> stop{false};
+    SpinTasks(sched, group, 4, stop);
+
+    // 不属于任何组的协程不受限制
+    std::atomic<int> others{0};
+    go co_scheduler(sched) [&]{
+        while (!stop) {
+            ++others;
+            co_sleep(1);
+        }
+    };
+
+    usleep(500 * 1000);
+    stop = true;
+    WaitUntilNoTaskS(*sched);
+
+    SchedulingGroup::Stat stat = group->GetStat();
+    EXPECT_EQ(stat.name_, "test_quota");
+    EXPECT_EQ(stat.tasks_, 0u);
+    EXPECT_GT(stat.throttledPeriods_, 0u);
+    EXPECT_GT(stat.deferred_, 0u);
+    EXPECT_LT(stat.cpuNs_, 200u * 1000 * 1000) << stat.cpuNs_;
+    EXPECT_GT(stat.cpuNs_, 50u * 1000 * 1000) << stat.cpuNs_;
+    EXPECT_GT(others, 100);
+
+    sched->Stop();
+}
+
+TEST(SchedGroup, Weight)
+{
+    Scheduler* sched = Scheduler::Create();
+    std::thread([=]{ sched->Start(1, 1); }).detach();
+
+    SchedulingGroup* light = SchedulingGroup::Create("test_light", 100);
+    SchedulingGroup* heavy = SchedulingGroup::Create("test_heavy", 300);
+    std::atomic<bool> stop{false};
+
+    // 轻量组的协程更多, 仍然按权重分配CPU
+    SpinTasks(sched, light, 8, stop);
+    SpinTasks(sched, heavy, 2, stop);
+    usleep(50 * 1000);
+    EXPECT_EQ(light->GetStat().tasks_, 8u);
+    EXPECT_EQ(heavy->GetStat().tasks_, 2u);
+
+    uint64_t lightStart = light->GetStat().cpuNs_;
+    uint64_t heavyStart = heavy->GetStat().cpuNs_;
+    usleep(400 * 1000);
+    double lightNs = light->GetStat().cpuNs_ - lightStart;
+    double heavyNs = heavy->GetStat().cpuNs_ - heavyStart;
+    stop = true;
+    WaitUntilNoTaskS(*sched);
+
+    double ratio = heavyNs / lightNs;
+    EXPECT_GT(ratio, 2.0) << "light=" << lightNs << " heavy=" << heavyNs;
+    EXPECT_LT(ratio, 4.5) << "light=" << lightNs << " heavy=" << heavyNs;
+
+    // 只有一个组有协程时不受权重限制
+    stop = false;
+    lightStart = light->GetStat().cpuNs_;
+    SpinTasks(sched, light, 2, stop);
+    usleep(100 * 1000);
+    stop = true;
+    WaitUntilNoTaskS(*sched);
+    EXPECT_GT(light->GetStat().cpuNs_ - lightStart, 50u * 1000 * 1000);
+
+    bool found = false;
+    for (auto & stat : SchedulingGroup::GetAllStats()) {
+        if (stat.name_ == "test_heavy") {
+            found = true;
+            EXPECT_EQ(stat.weight_, 300u);
+        }
+    }
+    EXPECT_TRUE(found);
+
+    std::string s = Metrics::getInstance().ExportPrometheus();
+    EXPECT_NE(s.find("libgo_group_cpu_ns_total{group=\"test_heavy\"} "), std::string::npos) << s;
+
+    sched->Stop();
+}
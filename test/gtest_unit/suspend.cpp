@@ -0,0 +1,86 @@
+#include "gtest/gtest.h"
+#include "coroutine.h"
+#include "gtest_exit.h"
+#include <atomic>
+#include <type_traits>
+using namespace co;
+
+typedef Processer::SuspendEntry SuspendEntry;
+
+// 挂起标识可以直接放进定时器回调的std::function内部存储
+static_assert(std::is_trivially_copyable<SuspendEntry>::value, "SuspendEntry must be trivially copyable");
+
+// 同一个挂起标识只能唤醒一次
+TEST(Suspend, WakeupOnce)
+{
+    SuspendEntry entry;
+    EXPECT_FALSE(!!entry);
+    EXPECT_TRUE(entry.IsExpire());
+    EXPECT_FALSE(Processer::Wakeup(entry));
+
+    std::atomic<int> step{0};
+    go [&]{
+        entry = Processer::Suspend();
+        step = 1;
+        Processer::StaticCoYield();
+        step = 2;
+    };
+    while (step < 1) usleep(1000);
+    EXPECT_TRUE(!!entry);
+    EXPECT_FALSE(entry.IsExpire());
+    EXPECT_TRUE(Processer::Wakeup(entry));
+    EXPECT_TRUE(entry.IsExpire());
+    EXPECT_FALSE(Processer::Wakeup(entry));
+    WaitUntilNoTask();
+    EXPECT_EQ(2, step);
+}
+
+// 协程结束后槽位被复用, 旧的挂起标识不会唤醒新的协程
+TEST(Suspend, StaleEntry)
+{
+    SuspendEntry first, second;
+    std::atomic<int> step{0};
+    go [&]{
+        first = Processer::Suspend();
+        step = 1;
+        Processer::StaticCoYield();
+    };
+    while (step < 1) usleep(1000);
+    EXPECT_TRUE(Processer::Wakeup(first));
+    WaitUntilNoTask();
+    EXPECT_TRUE(first.IsExpire());
+
+    go [&]{
+        second = Processer::Suspend();
+        step = 2;
+        Processer::StaticCoYield();
+        step = 3;
+    };
+    while (step < 2) usleep(1000);
+    EXPECT_EQ(first.slot_, second.slot_);
+    EXPECT_FALSE(first == second);
+    EXPECT_FALSE(Processer::Wakeup(first));
+    usleep(20 * 1000);
+    EXPECT_EQ(2, step);
+    EXPECT_TRUE(Processer::Wakeup(second));
+    WaitUntilNoTask();
+    EXPECT_EQ(3, step);
+}
+
+// 定时唤醒和主动唤醒竞争时只有一方成功
+TEST(Suspend, TimerRace)
+{
+    std::atomic<int> woken{0};
+    for (int i = 0; i < 200; ++i) {
+        go [&woken, i]{
+            SuspendEntry entry = Processer::Suspend(std::chrono::microseconds(i % 50));
+            go [=, &woken]{
+                if (Processer::Wakeup(entry))
+                    ++woken;
+            };
+            Processer::StaticCoYield();
+        };
+    }
+    WaitUntilNoTask();
+    EXPECT_LE(woken, 200);
+}
@@ -0,0 +1,95 @@
+#include "gtest/gtest.h"
+#include "coroutine.h"
+#include "gtest_exit.h"
+#include <atomic>
+#include <string>
+using namespace co;
+
+static std::size_t CountOf(std::string const& s, std::string const& sub)
+{
+    std::size_t n = 0;
+    for (std::size_t pos = s.find(sub); pos != std::string::npos; pos = s.find(sub, pos + 1))
+        ++n;
+    return n;
+}
+
+TEST(Trace, Disabled)
+{
+    Tracer::getInstance().Disable();
+    Tracer::getInstance().Clear();
+
+    go []{ co_yield; };
+    WaitUntilNoTask();
+
+    std::string s = Tracer::getInstance().DumpChromeTrace();
+    EXPECT_EQ(CountOf(s, "\"ph\":\"B\""), 0u);
+}
+
+TEST(Trace, ChromeTrace)
+{
+    Tracer::getInstance().Enable();
+
+    const int n = 100;
+    co_chan<int> ch;
+    for (int i = 0; i < n; ++i)
+        go [=]{
+            co_yield;
+            ch << i;
+        };
+
+    for (int i = 0; i < n; ++i) {
+        int v;
+        ch >> v;
+    }
+    go []{ co_sleep(10); };
+    WaitUntilNoTask();
+
+    Tracer::getInstance().Disable();
+    std::string s = Tracer::getInstance().DumpChromeTrace();
+    Tracer::getInstance().Clear();
+
+    EXPECT_EQ(s.find("{\"traceEvents\":["), 0u);
+    EXPECT_EQ(s.substr(s.size() - 2), "\"}");
+    EXPECT_GE(CountOf(s, "\"name\":\"create\""), (std::size_t)n + 1);
+    EXPECT_GE(CountOf(s, "\"ph\":\"B\""), (std::size_t)n * 2);
+    EXPECT_EQ(CountOf(s, "\"ph\":\"B\""), CountOf(s, "\"ph\":\"E\""));
+    EXPECT_GE(CountOf(s, "\"name\":\"timer_fire\""), 1u);
+    EXPECT_GE(CountOf(s, "Processer("), 1u);
+}
+
+TEST(Trace, Overwrite)
+{
+    Tracer::getInstance().Enable(16);
+    Tracer::getInstance().Clear();
+    std::thread([]{
+        for (int i = 0; i < 1000; ++i)
+            Tracer::Trace(eTraceEvent::wakeup, i);
+    }).join();
+    Tracer::getInstance().Disable();
+
+    std::string s = Tracer::getInstance().DumpChromeTrace();
+    Tracer::getInstance().Clear();
+    EXPECT_EQ(CountOf(s, "\"name\":\"wakeup\""), 16u);
+    EXPECT_EQ(CountOf(s, "\"task\":999,"), 1u);
+    EXPECT_EQ(CountOf(s, "\"task\":983,"), 0u);
+}
+
+TEST(Trace, ReuseBuffer)
+{
+    Tracer::getInstance().Enable(16);
+    std::thread([]{ Tracer::Trace(eTraceEvent::wakeup, 0); }).join();
+    std::size_t threads = CountOf(Tracer::getInstance().DumpChromeTrace(), "\"thread_name\"");
+
+    // 退出的线程归还缓冲区, 之后的线程复用它, 缓冲区数量不增长
+    for (int i = 1; i <= 10; ++i)
+        std::thread([=]{ Tracer::Trace(eTraceEvent::wakeup, 1000 + i); }).join();
+    Tracer::getInstance().Disable();
+
+    std::string s = Tracer::getInstance().DumpChromeTrace();
+    Tracer::getInstance().Clear();
+    EXPECT_EQ(CountOf(s, "\"thread_name\""), threads);
+
+    // 已退出线程的记录在缓冲区被复用前仍然可以导出
+    EXPECT_EQ(CountOf(s, "\"task\":1010,"), 1u);
+    EXPECT_EQ(CountOf(s, "\"task\":1009,"), 0u);
+}
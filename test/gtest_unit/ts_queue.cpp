@@ -213,6 +213,46 @@ TEST(TSQueue, PushPopMulti) {
     q.pop_all();
 }
 
+struct RefElem : public TSQueueHook, public RefObject {};
+struct NoRefElem : public TSQueueHook, public RefObject {};
+namespace co {
+template <> struct TSQueueHoldsRef<NoRefElem> : public std::false_type {};
+}
+
+// 队列默认持有RefObject元素的引用计数, 特化TSQueueHoldsRef后进出队列不增减引用计数
+TEST(TSQueue, HoldsRef) {
+    RefElem* r = new RefElem;
+    NoRefElem* n = new NoRefElem;
+    {
+        TSQueue<RefElem> q;
+        q.push(r);
+        EXPECT_EQ(2, r->use_count());
+        EXPECT_EQ(r, q.pop());
+        EXPECT_EQ(1, r->use_count());
+        q.push(r);
+        SList<RefElem> slist = q.pop_all();
+        EXPECT_EQ(2, r->use_count());
+        q.push(std::move(slist));
+        EXPECT_TRUE(q.erase(r));
+        EXPECT_EQ(1, r->use_count());
+    }
+    {
+        TSQueue<NoRefElem> q;
+        q.push(n);
+        EXPECT_EQ(1, n->use_count());
+        EXPECT_EQ(n, q.pop());
+        q.push(n);
+        SList<NoRefElem> slist = q.pop_all();
+        slist.erase(n);
+        EXPECT_EQ(1, n->use_count());
+        q.push(n);
+        EXPECT_TRUE(q.erase(n));
+        EXPECT_EQ(1, n->use_count());
+    }
+    r->DecrementRef();
+    n->DecrementRef();
+}
+
 TEST(TSQueue, Erase) {
 }
 
@@ -0,0 +1,61 @@
+#include "gtest/gtest.h"
+#include "coroutine.h"
+#include "gtest_exit.h"
+#include <atomic>
+#include <string>
+using namespace co;
+
+static volatile uint64_t g_sink = 0;
+
+// 模拟没有被hook的阻塞调用
+static void BusyLoop(int ms)
+{
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    while (std::chrono::steady_clock::now() < end) {
+        for (int i = 0; i < 1000; ++i)
+            g_sink += i;
+    }
+}
+
+TEST(Watchdog, Capture)
+{
+    ASSERT_TRUE(BlockingWatchdog::getInstance().Enable());
+    EXPECT_FALSE(BlockingWatchdog::getInstance().Enable());
+
+    std::atomic<int> handled{0};
+    std::atomic<uint64_t> handledTaskId{0};
+    BlockingWatchdog::getInstance().SetHandler([&](BlockingWatchdog::Event const& event) {
+                handledTaskId = event.taskId_;
+                ++handled;
+            });
+
+    std::atomic<uint64_t> taskId{0};
+    int blockLine = __LINE__ + 1;
+    go [&]{ taskId = Processer::GetCurrentTask()->id_; BusyLoop(500); };
+    WaitUntilNoTask();
+
+    // 一次阻塞只采集一次
+    EXPECT_EQ(BlockingWatchdog::getInstance().EventCount(), 1u);
+    EXPECT_EQ(handled, 1);
+    EXPECT_EQ(handledTaskId, taskId);
+
+    std::string report = BlockingWatchdog::getInstance().GetReport();
+    std::string site = std::string(__FILE__) + ":" + std::to_string(blockLine);
+    EXPECT_NE(report.find(site), std::string::npos) << report;
+
+    // 没有阻塞的协程不触发
+    BlockingWatchdog::getInstance().Clear();
+    EXPECT_EQ(BlockingWatchdog::getInstance().EventCount(), 0u);
+    for (int i = 0; i < 100; ++i)
+        go []{ co_yield; };
+    WaitUntilNoTask();
+    EXPECT_EQ(BlockingWatchdog::getInstance().EventCount(), 0u);
+
+    BlockingWatchdog::getInstance().SetHandler(nullptr);
+    BlockingWatchdog::getInstance().Disable();
+    EXPECT_FALSE(BlockingWatchdog::IsEnabled());
+
+    go []{ BusyLoop(300); };
+    WaitUntilNoTask();
+    EXPECT_EQ(BlockingWatchdog::getInstance().EventCount(), 0u);
+}
@@ -35,6 +35,16 @@ int main()
         printf("%s\n", co::CoDebugger::getInstance().GetAllInfo().c_str());
     };
 
+    // JSON格式的运行时状态快照(不依赖ENABLE_DEBUGGER)
+    go []{
+        co_sleep(50);
+        printf("%s\n", co::CoDebugger::getInstance().GetSnapshot().c_str());
+    };
+
+    // 也可以开启一个本地查询服务, 在独立的线程中运行:
+    //   co::DebugServer::getInstance().Start("127.0.0.1:9999");
+    //   curl http://127.0.0.1:9999/snapshot
+
     // 200ms后安全退出
     std::thread([]{ co_sleep(200); co_sched.Stop(); }).detach();
 
@@ -0,0 +1,38 @@
+/************************************************
+ * libgo sample16 trace
+*************************************************/
+#include "coroutine.h"
+#include "win_exit.h"
+#include <stdio.h>
+
+int main()
+{
+    //----------------------------------
+    // 开启协程事件追踪
+    // 开启后各线程记录协程的创建/切入/切出/挂起/唤醒/偷取/定时器/IO等待等事件,
+    // 导出的json文件可以用 chrome://tracing 或 https://ui.perfetto.dev 打开查看.
+    co::Tracer::getInstance().Enable();
+
+    co_chan<int> ch;
+    for (int i = 0; i < 4; ++i)
+        go [=]{
+            co_sleep(10 * i);
+            ch << i;
+        };
+
+    go [=]{
+        for (int i = 0; i < 4; ++i) {
+            int v;
+            ch >> v;
+            printf("recv %d\n", v);
+        }
+
+        co::Tracer::getInstance().Disable();
+        if (co::Tracer::getInstance().DumpChromeTrace("libgo_trace.json"))
+            printf("dump trace to libgo_trace.json\n");
+        co_sched.Stop();
+    };
+
+    co_sched.Start();
+    return 0;
+}